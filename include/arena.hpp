@@ -0,0 +1,116 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#pragma once
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <vector>
+
+#include "prelude.hpp"
+
+/** bump allocator: allocations are never freed individually, everything goes
+ * at once with the arena. only for trivially destructible data.
+ */
+struct Arena {
+  static constexpr usize BLOCK_SIZE = 64 * 1024;
+
+  Arena() = default;
+  Arena(const Arena&)            = delete;
+  Arena& operator=(const Arena&) = delete;
+  Arena(Arena&& other) noexcept
+      : blocks(std::move(other.blocks))
+      , cur(other.cur)
+      , end(other.end)
+      , used(other.used) {
+    other.forget();
+  }
+  Arena& operator=(Arena&& other) noexcept {
+    if (this != &other) {
+      this->blocks = std::move(other.blocks);
+      this->cur    = other.cur;
+      this->end    = other.end;
+      this->used   = other.used;
+      other.forget();
+    }
+    return *this;
+  }
+
+  void* alloc(usize size, usize align = alignof(std::max_align_t)) {
+    auto p = (this->cur + (align - 1)) & ~(align - 1);
+    if (p + size > this->end) {
+      grow(size + align);
+      p = (this->cur + (align - 1)) & ~(align - 1);
+    }
+    this->cur = p + size;
+    this->used += size;
+    return reinterpret_cast<void*>(p);
+  }
+
+  template <typename T>
+  T* make(const T& v) {
+    return new (alloc(sizeof(T), alignof(T))) T(v);
+  }
+
+  std::string_view copy(std::string_view s) {
+    auto* p = static_cast<char*>(alloc(s.size(), 1));
+    std::memcpy(p, s.data(), s.size());
+    return std::string_view(p, s.size());
+  }
+
+  /// bytes handed out so far
+  usize bytes() const { return this->used; }
+
+  /// take ownership of `other`'s blocks, keeping pointers into them valid.
+  /// allocation continues in this arena's current block
+  void adopt(Arena&& other) {
+    this->blocks.insert(this->blocks.begin(),
+                        std::make_move_iterator(other.blocks.begin()),
+                        std::make_move_iterator(other.blocks.end()));
+    this->used += other.used;
+    other.forget();
+  }
+
+private:
+  std::vector<std::unique_ptr<char[]>> blocks;
+  uintptr_t cur = 0;
+  uintptr_t end = 0;
+  usize used    = 0;
+
+  /// empty again, once the blocks have been moved out: `cur` and `end`
+  /// would point into blocks this arena no longer owns
+  void forget() {
+    this->blocks.clear();
+    this->cur  = 0;
+    this->end  = 0;
+    this->used = 0;
+  }
+
+  void grow(usize atleast) {
+    auto size = atleast > BLOCK_SIZE ? atleast : BLOCK_SIZE;
+    this->blocks.emplace_back(new char[size]);
+    this->cur = reinterpret_cast<uintptr_t>(this->blocks.back().get());
+    this->end = this->cur + size;
+  }
+};
+
+/// 32-bit index of a `T` in the pool that owns it
+template <typename T>
+struct Ref {
+  static constexpr u32 NONE = ~u32(0);
+  u32 i                     = NONE;
+
+  bool valid() const { return this->i != NONE; }
+  bool operator==(const Ref& other) const { return this->i == other.i; }
+  bool operator!=(const Ref& other) const { return this->i != other.i; }
+};
+
+/// `len` consecutive entries of a list pool, from `start`
+struct Span {
+  u32 start = 0;
+  u32 len   = 0;
+};
+
+#endif
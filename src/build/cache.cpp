@@ -0,0 +1,122 @@
+#include "cache.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+namespace mangekyou::build {
+
+namespace fs = std::filesystem;
+
+static const char* assoc_name(ast::Assoc a) {
+  switch (a) {
+  case ast::Assoc::Left: return "l";
+  case ast::Assoc::Right: return "r";
+  case ast::Assoc::None: return "n";
+  }
+  return "n";
+}
+
+string serialize(const Interface& iface) {
+  auto ops = std::vector<std::pair<string, parse::Fixity>>();
+  for (auto& [op, fix] : iface.fixities.ops)
+    ops.emplace_back(op.string(), fix);
+  std::sort(ops.begin(), ops.end(),
+            [](auto& x, auto& y) { return x.first < y.first; });
+
+  auto s = string(CACHE_FORMAT) + "\nmodule " + iface.module + "\n";
+  for (auto& [op, fix] : ops)
+    s += "fix " + op + " " + assoc_name(fix.assoc) + " "
+         + std::to_string(fix.prec) + "\n";
+  for (auto& id : iface.exports)
+    s += "export " + id.string() + "\n";
+  return s;
+}
+
+option<Interface> deserialize(std::string_view text) {
+  auto lines = std::vector<std::string_view>();
+  while (!text.empty()) {
+    auto nl = text.find('\n');
+    if (nl == std::string_view::npos)
+      return {};
+    lines.push_back(text.substr(0, nl));
+    text.remove_prefix(nl + 1);
+  }
+  if (lines.size() < 2 || lines[0] != CACHE_FORMAT
+      || !lines[1].starts_with("module "))
+    return {};
+
+  auto iface   = Interface();
+  iface.module = string(lines[1].substr(7));
+  for (usize k = 2; k < lines.size(); ++k) {
+    auto line = lines[k];
+    if (line.starts_with("export ")) {
+      iface.exports.push_back(name::Id(line.substr(7)));
+      continue;
+    }
+    // `fix op a prec`
+    if (!line.starts_with("fix "))
+      return {};
+    line.remove_prefix(4);
+    auto sp = line.find(' ');
+    if (sp == std::string_view::npos || line.size() < sp + 4)
+      return {};
+    auto op    = line.substr(0, sp);
+    auto assoc = line[sp + 1];
+    auto prec  = line.substr(sp + 3);
+    auto fix   = parse::Fixity{ast::Assoc::None, 0};
+    if (assoc == 'l')
+      fix.assoc = ast::Assoc::Left;
+    else if (assoc == 'r')
+      fix.assoc = ast::Assoc::Right;
+    else if (assoc != 'n')
+      return {};
+    auto res = std::from_chars(prec.data(), prec.data() + prec.size(),
+                               fix.prec);
+    if (res.ec != std::errc() || res.ptr != prec.data() + prec.size())
+      return {};
+    iface.fixities.declare(name::Id(op), fix);
+  }
+  return iface;
+}
+
+option<Interface> Cache::load(const Digest& key) const {
+  if (this->dir.empty())
+    return {};
+  auto in = std::ifstream(fs::path(this->dir) / key.hex(), std::ios::binary);
+  if (!in)
+    return {};
+  auto text = std::ostringstream();
+  text << in.rdbuf();
+  return deserialize(text.str());
+}
+
+void Cache::store(const Digest& key, const Interface& iface) const {
+  static std::atomic<u64> s_temps = 0;
+  if (this->dir.empty())
+    return;
+  auto ec = std::error_code();
+  fs::create_directories(this->dir, ec);
+  auto path = fs::path(this->dir) / key.hex();
+  auto tmp  = path;
+  tmp += ".tmp" + std::to_string(std::hash<std::thread::id>{}(
+                      std::this_thread::get_id()))
+         + "-" + std::to_string(s_temps++);
+  {
+    auto out = std::ofstream(tmp, std::ios::binary);
+    out << serialize(iface);
+    if (!out.flush()) {
+      fs::remove(tmp, ec);
+      return;
+    }
+  }
+  fs::rename(tmp, path, ec);
+  if (ec)
+    fs::remove(tmp, ec);
+}
+
+} // namespace mangekyou::build
@@ -0,0 +1,38 @@
+#pragma once
+#include <prelude.hpp>
+#include <string_view>
+
+#include "digest.hpp"
+#include "driver.hpp"
+
+/** the on-disk compilation cache, content addressed.
+ * a module's key hashes the cache format, the compiler flags, its name and
+ * source, and the interface digests of its imports. an entry is the
+ * module's interface, which is all its importers need: a hit skips the
+ * module's whole pipeline. keying on interfaces rather than sources means
+ * an edit that leaves a module's interface alone does not invalidate the
+ * modules importing it.
+ */
+namespace mangekyou::build {
+
+/// bumped whenever the entry format or the meaning of a key changes
+inline constexpr std::string_view CACHE_FORMAT = "mki 1";
+
+/// a line per fixity then per export, sorted so equal interfaces are equal
+/// text
+string serialize(const Interface& iface);
+option<Interface> deserialize(std::string_view text);
+
+struct Cache {
+  /// where entries live, one file per key. no caching when empty
+  string dir;
+
+  /// none on a miss or an unreadable entry
+  option<Interface> load(const Digest& key) const;
+  /// best effort: a failed write only costs a later miss. written to a
+  /// temporary file then renamed, so concurrent builds never see half an
+  /// entry
+  void store(const Digest& key, const Interface& iface) const;
+};
+
+} // namespace mangekyou::build
@@ -0,0 +1,64 @@
+#include "digest.hpp"
+
+#include <cstring>
+
+namespace mangekyou::build {
+
+static constexpr u64 K1 = 0x9E3779B97F4A7C15;
+static constexpr u64 K2 = 0xC2B2AE3D27D4EB4F;
+
+static u64 rotl(u64 x, int r) { return (x << r) | (x >> (64 - r)); }
+
+/// the finaliser of splitmix64
+static u64 mix(u64 x) {
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EB;
+  return x ^ (x >> 31);
+}
+
+string Digest::hex() const {
+  static constexpr char DIGITS[] = "0123456789abcdef";
+  auto s = string(32, '0');
+  for (int k = 0; k < 16; ++k) {
+    s[15 - k] = DIGITS[(this->hi >> (4 * k)) & 15];
+    s[31 - k] = DIGITS[(this->lo >> (4 * k)) & 15];
+  }
+  return s;
+}
+
+void Hasher::word(u64 w) {
+  this->a = rotl((this->a ^ w) * K1, 31);
+  this->b = rotl((this->b ^ w) * K2, 29) + this->a;
+  ++this->n;
+}
+
+Hasher& Hasher::add(std::string_view bytes) {
+  word(bytes.size());
+  auto* p   = bytes.data();
+  auto left = bytes.size();
+  for (; left >= 8; p += 8, left -= 8) {
+    u64 w;
+    std::memcpy(&w, p, 8);
+    word(w);
+  }
+  if (left) {
+    u64 w = 0;
+    std::memcpy(&w, p, left);
+    word(w);
+  }
+  return *this;
+}
+
+Hasher& Hasher::add(const Digest& d) {
+  word(d.lo);
+  word(d.hi);
+  return *this;
+}
+
+Digest Hasher::finish() const {
+  auto lo = mix(this->a ^ rotl(this->b, 17) ^ this->n);
+  auto hi = mix(this->b + lo * K1);
+  return Digest{lo, hi};
+}
+
+} // namespace mangekyou::build
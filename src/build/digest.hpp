@@ -0,0 +1,39 @@
+#pragma once
+#include <prelude.hpp>
+#include <string_view>
+
+/** 128-bit content hashes, the keys of the build cache.
+ * two independent multiply-rotate lanes over 8-byte words, mixed at the
+ * end. not cryptographic: it only has to tell apart inputs that are not
+ * built to collide.
+ */
+namespace mangekyou::build {
+
+struct Digest {
+  u64 lo = 0;
+  u64 hi = 0;
+
+  /// 32 lowercase hex digits
+  string hex() const;
+
+  bool operator==(const Digest& other) const {
+    return this->lo == other.lo && this->hi == other.hi;
+  }
+  bool operator!=(const Digest& other) const { return !(*this == other); }
+};
+
+struct Hasher {
+  /// a field, prefixed with its length so that fields never run together
+  Hasher& add(std::string_view bytes);
+  Hasher& add(const Digest& d);
+  Digest finish() const;
+
+private:
+  u64 a = 0x243F6A8885A308D3;
+  u64 b = 0x13198A2E03707344;
+  u64 n = 0;
+
+  void word(u64 w);
+};
+
+} // namespace mangekyou::build
@@ -0,0 +1,113 @@
+#include "driver.hpp"
+
+#include <atomic>
+
+#include "cache.hpp"
+#include "parse/layout.hpp"
+#include "parse/parser.hpp"
+#include "pool.hpp"
+
+namespace mangekyou::build {
+
+Interface Interface::of(const string& module, const ast::Module& m) {
+  auto iface = Interface{module, {}, {}};
+  auto out   = [&](const name::Id& id) {
+    // the clauses of a function are consecutive items
+    if (iface.exports.empty() || iface.exports.back() != id)
+      iface.exports.push_back(id);
+  };
+  for (auto item : m.items)
+    std::visit(overloaded{[&](const ast::OpDecl& d) {
+                            iface.fixities.declare(
+                                d.op, parse::Fixity{d.assoc, d.prec});
+                          },
+                          [](const ast::TypeSig&) {},
+                          [&](const ast::FnDecl& d) { out(d.id); },
+                          [&](const ast::DataDecl& d) {
+                            out(d.id);
+                            for (u32 k = 0; k < d.cons.len; ++k)
+                              out(m[m.at<Ref<ast::DataCon>>(d.cons, k)].id);
+                          },
+                          [&](const ast::TypeSyn& d) { out(d.id); },
+                          [&](const ast::ExternDecl& d) { out(d.id); }},
+               static_cast<const ast::Item::variant&>(m[item]));
+  return iface;
+}
+
+Report compile(const Graph& g, const Options& opts) {
+  auto n      = g.units.size();
+  auto report = Report();
+  report.units.resize(n);
+  auto errors = std::vector<std::vector<string>>(n);
+  // a unit only reads what its imports wrote once it is spawned, after the
+  // last of them released its count
+  auto waiting = std::vector<std::atomic<u32>>(n);
+  auto failed  = std::vector<u8>(n);
+  auto hits    = std::atomic<u32>(0);
+  auto cache   = Cache{opts.cache};
+  for (usize u = 0; u < n; ++u)
+    waiting[u].store(static_cast<u32>(g.units[u].deps.size()));
+
+  auto pool  = Pool(opts.jobs);
+  auto build = [&](u32 u, auto& self) -> void {
+    auto& unit = g.units[u];
+    for (auto d : unit.deps)
+      failed[u] |= failed[d];
+    auto key = Digest();
+    if (!failed[u]) {
+      auto h = Hasher();
+      h.add(CACHE_FORMAT).add(opts.flags).add(unit.name);
+      h.add(unit.source->text());
+      for (auto d : unit.deps)
+        h.add(report.units[d]->digest);
+      key = h.finish();
+      if (auto iface = cache.load(key)) {
+        auto digest     = Hasher().add(serialize(*iface)).finish();
+        report.units[u] = Compiled{{}, std::move(*iface), digest};
+        ++hits;
+      }
+    }
+    if (!failed[u] && !report.units[u]) {
+      auto lexer = parse::Lexer(unit.source->text());
+      auto toks  = parse::Layout::run(lexer);
+      // the file's own declarations win over imported ones
+      auto fixities = parse::FixityTable();
+      for (auto d : unit.deps)
+        for (auto& [op, fix] : report.units[d]->iface.fixities.ops)
+          fixities.declare(op, fix);
+      for (auto& [op, fix] : parse::FixityTable::collect(toks).ops)
+        fixities.declare(op, fix);
+
+      auto parser = parse::Parser(toks, std::move(fixities));
+      parser.base = unit.base;
+      auto m      = parser.parse_module();
+      if (m) {
+        auto iface  = Interface::of(unit.name, *m);
+        auto digest = Hasher().add(serialize(iface)).finish();
+        cache.store(key, iface);
+        report.units[u] = Compiled{std::move(*m), std::move(iface), digest};
+      } else {
+        for (auto& e : parser.errors)
+          errors[u].push_back(
+              g.sources.describe(g.sources.loc(unit.base, e.offset)) + ": "
+              + e.message);
+        failed[u] = true;
+      }
+    }
+    for (auto v : unit.users)
+      if (waiting[v].fetch_sub(1, std::memory_order_acq_rel) == 1)
+        pool.spawn([&, v] { self(v, self); });
+  };
+  for (u32 u = 0; u < n; ++u)
+    if (g.units[u].deps.empty())
+      pool.spawn([&, u] { build(u, build); });
+  pool.wait();
+
+  for (auto& es : errors)
+    for (auto& e : es)
+      report.errors.push_back(std::move(e));
+  report.hits = hits.load();
+  return report;
+}
+
+} // namespace mangekyou::build
@@ -0,0 +1,62 @@
+#pragma once
+#include <prelude.hpp>
+#include <vector>
+
+#include "digest.hpp"
+#include "graph.hpp"
+#include "parse/ast.hpp"
+#include "parse/fixity.hpp"
+
+/** compiling every module of a `Graph`, in parallel.
+ * a module is ready once all of its imports are compiled: it is parsed
+ * with the fixities its imports export, and in turn exports an `Interface`
+ * to the modules importing it. ready modules run on a work-stealing `Pool`,
+ * finishing one spawns the users it was the last import of. with a cache,
+ * a module whose key is found reuses the cached interface instead.
+ */
+namespace mangekyou::build {
+
+/// what a module shows the modules importing it
+struct Interface {
+  string module;
+  /// the operators it declares the fixity of
+  parse::FixityTable fixities;
+  /// its top-level functions, externs, types and constructors
+  std::vector<name::Id> exports;
+
+  static Interface of(const string& module, const ast::Module& m);
+};
+
+struct Compiled {
+  /// none when the interface came from the cache
+  option<ast::Module> module;
+  Interface iface;
+  /// of `serialize(iface)`, what importers' cache keys depend on
+  Digest digest;
+};
+
+struct Options {
+  /// 0: one per core
+  unsigned jobs = 0;
+  /// the cache directory, none when empty
+  string cache = "";
+  /// the flags that change what is compiled, part of every cache key
+  string flags = "";
+};
+
+struct Report {
+  /// indexed like `Graph::units`, none for the modules that failed or whose
+  /// imports failed
+  std::vector<option<Compiled>> units;
+  /// every error of every failed module, `path:line:col: message`
+  std::vector<string> errors;
+  /// modules reused from the cache
+  u32 hits = 0;
+
+  bool ok() const { return this->errors.empty(); }
+};
+
+/// every unit of `g`, which must have no import cycle
+Report compile(const Graph& g, const Options& opts = {});
+
+} // namespace mangekyou::build
@@ -0,0 +1,185 @@
+#include "graph.hpp"
+
+#include <algorithm>
+#include <filesystem>
+
+#include "parse/lexer.hpp"
+
+namespace mangekyou::build {
+
+using parse::TokenKind;
+
+parse::PResult<Header> header(std::string_view src) {
+  auto h     = Header();
+  auto lexer = parse::Lexer(src);
+  auto tok   = lexer.next();
+  auto fail  = [&](const char* msg) {
+    return tl::make_unexpected(parse::ParseError{tok.offset, msg});
+  };
+  // the keyword, a module name and the end of the line: the next token
+  // must start a new line, as the layout rule would end the item there
+  auto line = [&]() -> parse::PResult<string> {
+    tok = lexer.next();
+    if (!tok.is(TokenKind::ConId))
+      return fail("expected a module name");
+    auto s   = string(lexer.text(tok));
+    auto end = tok.offset + tok.length;
+    tok      = lexer.next();
+    while (tok.is(TokenKind::Operator) && lexer.text(tok) == "."
+           && tok.offset == end) {
+      auto next = lexer.next();
+      if (!next.is(TokenKind::ConId) || next.offset != end + 1)
+        return fail("expected a module name after `.`");
+      s   += '.';
+      s   += lexer.text(next);
+      end  = next.offset + next.length;
+      tok  = lexer.next();
+    }
+    if (!tok.is(TokenKind::Eof) && !tok.is(TokenKind::Semi)
+        && src.substr(end, tok.offset - end).find('\n') == string::npos)
+      return fail("expected a new line after the module name");
+    return s;
+  };
+  auto skip = [&] {
+    while (tok.is(TokenKind::Semi))
+      tok = lexer.next();
+  };
+
+  skip();
+  if (tok.is(TokenKind::KwModule)) {
+    auto name = line();
+    if (!name)
+      return tl::make_unexpected(std::move(name.error()));
+    h.name = std::move(*name);
+    skip();
+  }
+  while (tok.is(TokenKind::KwImport)) {
+    auto name = line();
+    if (!name)
+      return tl::make_unexpected(std::move(name.error()));
+    h.imports.push_back(std::move(*name));
+    skip();
+  }
+  return h;
+}
+
+string module_path(std::string_view name) {
+  auto path = string(name);
+  std::replace(path.begin(), path.end(), '.', '/');
+  return path + string(EXT);
+}
+
+tl::expected<Graph, string> Graph::load(const std::vector<string>& roots,
+                                        const std::vector<string>& dirs) {
+  auto g       = Graph();
+  auto imports = std::vector<std::vector<string>>();
+
+  // `expected` is the name `src` is imported as, empty for a root
+  auto add = [&](Rc<parse::Source> src,
+                 const string& expected) -> tl::expected<u32, string> {
+    auto base = g.sources.add(src);
+    if (!base)
+      return tl::make_unexpected(std::move(base.error()));
+    auto h = header(src->text());
+    if (!h)
+      return tl::make_unexpected(
+          g.sources.describe(g.sources.loc(*base, h.error().offset)) + ": "
+          + h.error().message);
+    auto name = h->name;
+    if (name.empty())
+      name = expected.empty()
+                 ? std::filesystem::path(src->path).stem().string()
+                 : expected;
+    else if (!expected.empty() && name != expected)
+      return tl::make_unexpected(src->path + ": declares module `" + name
+                                 + "`, imported as `" + expected + "`");
+    auto id = static_cast<u32>(g.units.size());
+    if (!g.index.emplace(name, id).second)
+      return tl::make_unexpected(
+          "module `" + name + "` is defined by both "
+          + g.units[g.index[name]].source->path + " and " + src->path);
+    g.units.push_back(Unit{name, src, *base, {}, {}});
+    imports.push_back(std::move(h->imports));
+    return id;
+  };
+
+  for (auto& path : roots) {
+    auto src = parse::Source::open(path);
+    if (!src)
+      return tl::make_unexpected(std::move(src.error()));
+    if (auto u = add(*src, ""); !u)
+      return tl::make_unexpected(std::move(u.error()));
+  }
+  // units are appended as they are found, so this reaches all of them
+  for (u32 u = 0; u < g.units.size(); ++u) {
+    for (auto& imp : imports[u]) {
+      auto it = g.index.find(imp);
+      if (it == g.index.end()) {
+        auto found = option<u32>();
+        for (auto& dir : dirs) {
+          auto path = (std::filesystem::path(dir) / module_path(imp)).string();
+          if (!std::filesystem::exists(path))
+            continue;
+          auto src = parse::Source::open(path);
+          if (!src)
+            return tl::make_unexpected(std::move(src.error()));
+          auto v = add(*src, imp);
+          if (!v)
+            return tl::make_unexpected(std::move(v.error()));
+          found = *v;
+          break;
+        }
+        if (!found)
+          return tl::make_unexpected(g.units[u].source->path
+                                     + ": module `" + imp + "` not found");
+        it = g.index.find(imp);
+      }
+      if (std::find(g.units[u].deps.begin(), g.units[u].deps.end(),
+                    it->second)
+          != g.units[u].deps.end())
+        continue;
+      g.units[u].deps.push_back(it->second);
+      g.units[it->second].users.push_back(u);
+    }
+  }
+  return g;
+}
+
+tl::expected<std::vector<u32>, string> Graph::order() const {
+  auto n       = static_cast<u32>(this->units.size());
+  auto missing = std::vector<u32>(n);
+  auto out     = std::vector<u32>();
+  out.reserve(n);
+  for (u32 u = 0; u < n; ++u) {
+    missing[u] = static_cast<u32>(this->units[u].deps.size());
+    if (missing[u] == 0)
+      out.push_back(u);
+  }
+  for (u32 k = 0; k < out.size(); ++k)
+    for (auto v : this->units[out[k]].users)
+      if (--missing[v] == 0)
+        out.push_back(v);
+  if (out.size() == n)
+    return out;
+
+  // every unit left waits on another one left: walk those until one repeats
+  auto u = static_cast<u32>(
+      std::find_if(missing.begin(), missing.end(), [](u32 m) { return m; })
+      - missing.begin());
+  auto path = std::vector<u32>();
+  while (std::find(path.begin(), path.end(), u) == path.end()) {
+    path.push_back(u);
+    for (auto d : this->units[u].deps)
+      if (missing[d]) {
+        u = d;
+        break;
+      }
+  }
+  auto msg = string("import cycle: ");
+  for (auto it = std::find(path.begin(), path.end(), u); it != path.end();
+       ++it)
+    msg += this->units[*it].name + " -> ";
+  return tl::make_unexpected(msg + this->units[u].name);
+}
+
+} // namespace mangekyou::build
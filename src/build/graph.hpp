@@ -0,0 +1,63 @@
+#pragma once
+#include <expected>
+#include <prelude.hpp>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "parse/location.hpp"
+#include "parse/parser.hpp"
+#include "parse/source.hpp"
+
+/** the modules of a program and their imports.
+ * only the header of each file is read to find its imports: tokens are
+ * pulled from the lexer one at a time and scanning stops at the first one
+ * that is not part of a `module` or `import` line, so the body of a file is
+ * never lexed, laid out or parsed. module `A.B` lives in `A/B.mk` under one
+ * of the search directories.
+ */
+namespace mangekyou::build {
+
+/// the extension of source files
+inline constexpr std::string_view EXT = ".mk";
+
+/// the `module` and `import` lines of a file
+struct Header {
+  /// empty when the file has no `module` line
+  string name;
+  std::vector<string> imports;
+};
+
+/// the header at the start of `src`, an error for a malformed one
+parse::PResult<Header> header(std::string_view src);
+
+/// `A.B` -> `A/B.mk`
+string module_path(std::string_view name);
+
+struct Unit {
+  string name;
+  Rc<parse::Source> source;
+  /// first global offset of `source` in `Graph::sources`
+  u32 base;
+  /// the units this one imports, and those importing it
+  std::vector<u32> deps;
+  std::vector<u32> users;
+};
+
+struct Graph {
+  std::vector<Unit> units;
+  std::unordered_map<string, u32> index;
+  parse::SourceManager sources;
+
+  /// the files `roots` and every module they import, directly or not,
+  /// looked up in `dirs` in order. a root without a `module` line is named
+  /// after its file
+  static tl::expected<Graph, string> load(const std::vector<string>& roots,
+                                          const std::vector<string>& dirs);
+
+  /// the units, each after all of its imports, or the error naming an
+  /// import cycle
+  tl::expected<std::vector<u32>, string> order() const;
+};
+
+} // namespace mangekyou::build
@@ -0,0 +1,90 @@
+#include "pool.hpp"
+
+namespace mangekyou::build {
+
+namespace {
+/// the pool the current thread works for, and its index there
+thread_local const Pool* t_pool = nullptr;
+thread_local unsigned t_worker  = 0;
+} // namespace
+
+Pool::Pool(unsigned threads) {
+  if (threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  for (unsigned w = 0; w < threads; ++w)
+    this->workers.push_back(std::make_unique<Worker>());
+  for (unsigned w = 0; w < threads; ++w)
+    this->threads.emplace_back(&Pool::run, this, w);
+}
+
+Pool::~Pool() {
+  wait();
+  {
+    auto lock  = std::unique_lock(this->lock);
+    this->stop = true;
+  }
+  this->idle.notify_all();
+  for (auto& t : this->threads)
+    t.join();
+}
+
+void Pool::spawn(Task t) {
+  {
+    // counted before it is visible, so `take` never decrements first
+    auto lock = std::unique_lock(this->lock);
+    auto w    = t_pool == this ? t_worker : this->next++ % size();
+    ++this->queued;
+    ++this->pending;
+    auto own = std::unique_lock(this->workers[w]->lock);
+    this->workers[w]->tasks.push_back(std::move(t));
+  }
+  this->idle.notify_one();
+}
+
+void Pool::wait() {
+  auto lock = std::unique_lock(this->lock);
+  this->done.wait(lock, [&] { return this->pending == 0; });
+}
+
+option<Pool::Task> Pool::take(unsigned w) {
+  auto task = option<Task>();
+  for (unsigned k = 0; k < size() && !task; ++k) {
+    auto& v   = *this->workers[(w + k) % size()];
+    auto lock = std::unique_lock(v.lock);
+    if (v.tasks.empty())
+      continue;
+    if (k == 0) {
+      task = std::move(v.tasks.back());
+      v.tasks.pop_back();
+    } else {
+      task = std::move(v.tasks.front());
+      v.tasks.pop_front();
+    }
+  }
+  if (task) {
+    auto lock = std::unique_lock(this->lock);
+    --this->queued;
+  }
+  return task;
+}
+
+void Pool::run(unsigned w) {
+  t_pool   = this;
+  t_worker = w;
+  for (;;) {
+    auto task = take(w);
+    if (!task) {
+      auto lock = std::unique_lock(this->lock);
+      this->idle.wait(lock, [&] { return this->stop || this->queued > 0; });
+      if (this->stop && this->queued == 0)
+        return;
+      continue;
+    }
+    (*task)();
+    auto lock = std::unique_lock(this->lock);
+    if (--this->pending == 0)
+      this->done.notify_all();
+  }
+}
+
+} // namespace mangekyou::build
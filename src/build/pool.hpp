@@ -0,0 +1,61 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <prelude.hpp>
+#include <thread>
+#include <vector>
+
+/** a work-stealing thread pool.
+ * every worker owns a deque: it pushes and pops tasks at the back, so the
+ * task it just spawned runs next while its inputs are still in cache, and
+ * steals from the front of another worker's deque when its own is empty.
+ * tasks spawned from outside the pool are dealt round-robin.
+ */
+namespace mangekyou::build {
+
+struct Pool {
+  using Task = std::function<void()>;
+
+  /// 0: one worker per core
+  explicit Pool(unsigned threads = 0);
+  Pool(const Pool&)            = delete;
+  Pool& operator=(const Pool&) = delete;
+  /// waits for every task
+  ~Pool();
+
+  unsigned size() const {
+    return static_cast<unsigned>(this->workers.size());
+  }
+  /// run `t` on some worker, tasks may spawn further tasks
+  void spawn(Task t);
+  /// until every task spawned so far, and every task they spawned, has run.
+  /// not to be called from a task
+  void wait();
+
+private:
+  struct Worker {
+    std::mutex lock;
+    std::deque<Task> tasks;
+  };
+
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::vector<std::thread> threads;
+  /// guards the counters, which the condition variables wait on
+  std::mutex lock;
+  std::condition_variable idle;
+  std::condition_variable done;
+  /// tasks in some deque
+  usize queued = 0;
+  /// tasks spawned and not yet finished
+  usize pending = 0;
+  usize next    = 0;
+  bool stop     = false;
+
+  /// the newest task of worker `w`, else the oldest task of another one
+  option<Task> take(unsigned w);
+  void run(unsigned w);
+};
+
+} // namespace mangekyou::build
@@ -0,0 +1,299 @@
+#include "coverage.hpp"
+
+namespace mangekyou::pat {
+
+u32 TagSet::count() const {
+  u32 n = 0;
+  for (auto w : this->words)
+    n += __builtin_popcountll(w);
+  return n;
+}
+
+u32 TagSet::first_missing(u32 n) const {
+  for (u32 k = 0; k < this->words.size(); ++k)
+    if (~this->words[k])
+      return std::min(n, k * 64 + __builtin_ctzll(~this->words[k]));
+  return n;
+}
+
+namespace {
+/// a row of patterns, an invalid ref is a wildcard
+using Vec    = std::vector<PatRef>;
+using Matrix = std::vector<Vec>;
+
+/// the constructors heading the first column of a matrix
+struct Sig {
+  option<u32> type;
+  bool lits = false;
+  TagSet tags{0};
+};
+
+struct Checker {
+  const ast::Module& m;
+  ConEnv& env;
+  option<MatchError> err;
+
+  void fail(PatRef p, string msg) {
+    if (!this->err)
+      this->err = MatchError{this->m.loc(p), std::move(msg)};
+  }
+
+  /// skip as-patterns, variables are wildcards
+  PatRef strip(PatRef p) const {
+    while (p.valid()) {
+      auto& node = this->m[p];
+      if (auto* as = std::get_if<PAs>(&node))
+        p = as->pat;
+      else if (node.is<PVar>() || node.is<PWildcard>())
+        return PatRef();
+      else
+        return p;
+    }
+    return p;
+  }
+
+  const ConInfo* con(PatRef p) {
+    auto& c    = std::get<PCon>(this->m[p]);
+    auto* info = this->env.lookup(c.con);
+    if (!info)
+      fail(p, "unknown constructor `" + c.con.string() + "`");
+    else if (info->arity != c.args.len)
+      fail(p, "constructor `" + c.con.string() + "` takes "
+                  + std::to_string(info->arity) + " arguments");
+    return this->err ? nullptr : info;
+  }
+
+  u32 width(u32 type) const {
+    return static_cast<u32>(this->env.types[type].cons.size());
+  }
+
+  Sig signature(const Matrix& P) {
+    auto sig = Sig();
+    for (auto& row : P) {
+      auto h = strip(row[0]);
+      if (!h.valid())
+        continue;
+      if (this->m[h].is<PLit>()) {
+        sig.lits = true;
+        if (sig.type)
+          fail(h, "literal pattern among constructor patterns");
+        continue;
+      }
+      auto* info = con(h);
+      if (!info)
+        return sig;
+      if (sig.lits || (sig.type && *sig.type != info->type)) {
+        fail(h, "`" + std::get<PCon>(this->m[h]).con.string()
+                    + "` does not belong to the type of the other patterns");
+        return sig;
+      }
+      if (!sig.type) {
+        sig.type = info->type;
+        sig.tags = TagSet(width(info->type));
+      }
+      sig.tags.set(info->tag);
+    }
+    return sig;
+  }
+
+  /// `row` without its head, after the head's `arity` fields (wildcards if
+  /// the head is one)
+  Vec fields(const Vec& row, PatRef head, u32 arity) const {
+    auto r = Vec(arity);
+    if (head.valid()) {
+      auto& c = std::get<PCon>(this->m[head]);
+      for (u32 f = 0; f < arity; ++f)
+        r[f] = this->m.at<PatRef>(c.args, f);
+    }
+    r.insert(r.end(), row.begin() + 1, row.end());
+    return r;
+  }
+
+  /// the specialised matrices of every constructor of `type`, in one pass
+  std::vector<Matrix> specialize_all(const Matrix& P, u32 type) {
+    auto& data   = this->env.types[type];
+    auto buckets = std::vector<Matrix>(data.cons.size());
+    for (auto& row : P) {
+      auto h = strip(row[0]);
+      if (h.valid()) {
+        auto tag = this->env.lookup(std::get<PCon>(this->m[h]).con)->tag;
+        buckets[tag].push_back(fields(row, h, data.arity[tag]));
+        continue;
+      }
+      for (u32 tag = 0; tag < buckets.size(); ++tag)
+        buckets[tag].push_back(fields(row, h, data.arity[tag]));
+    }
+    return buckets;
+  }
+
+  Matrix specialize(const Matrix& P, u32 tag, u32 arity) {
+    auto out = Matrix();
+    for (auto& row : P) {
+      auto h = strip(row[0]);
+      if (!h.valid() || this->env.lookup(std::get<PCon>(this->m[h]).con)->tag
+                            == tag)
+        out.push_back(fields(row, h, arity));
+    }
+    return out;
+  }
+
+  Matrix specialize(const Matrix& P, const Literal& lit) {
+    auto out = Matrix();
+    for (auto& row : P) {
+      auto h = strip(row[0]);
+      if (!h.valid()) {
+        out.push_back(Vec(row.begin() + 1, row.end()));
+        continue;
+      }
+      // a constructor here is an error reported by the caller
+      auto* l = std::get_if<PLit>(&this->m[h]);
+      if (l && same(this->m[l->lit], lit))
+        out.push_back(Vec(row.begin() + 1, row.end()));
+    }
+    return out;
+  }
+
+  Matrix defaults(const Matrix& P) {
+    auto out = Matrix();
+    for (auto& row : P)
+      if (!strip(row[0]).valid())
+        out.push_back(Vec(row.begin() + 1, row.end()));
+    return out;
+  }
+
+  bool useful(const Matrix& P, const Vec& q);
+  option<std::vector<string>> missing(const Matrix& P, u32 n);
+  string show(u32 type, u32 tag, std::vector<string>& w) const;
+};
+
+bool Checker::useful(const Matrix& P, const Vec& q) {
+  if (this->err)
+    return false;
+  if (q.empty())
+    return P.empty();
+  auto h   = strip(q[0]);
+  auto sig = signature(P);
+  if (this->err)
+    return false;
+  if (!h.valid()) {
+    if (sig.type && sig.tags.count() == width(*sig.type)) {
+      auto buckets = specialize_all(P, *sig.type);
+      auto& data   = this->env.types[*sig.type];
+      for (u32 tag = 0; tag < buckets.size(); ++tag)
+        if (useful(buckets[tag], fields(q, h, data.arity[tag])))
+          return true;
+      return false;
+    }
+    return useful(defaults(P), Vec(q.begin() + 1, q.end()));
+  }
+  if (auto* lit = std::get_if<PLit>(&this->m[h])) {
+    if (sig.type) {
+      fail(h, "literal pattern among constructor patterns");
+      return false;
+    }
+    return useful(specialize(P, this->m[lit->lit]),
+                  Vec(q.begin() + 1, q.end()));
+  }
+  auto* info = con(h);
+  if (!info)
+    return false;
+  if (sig.lits || (sig.type && *sig.type != info->type)) {
+    fail(h, "`" + std::get<PCon>(this->m[h]).con.string()
+                + "` does not belong to the type of the other patterns");
+    return false;
+  }
+  return useful(specialize(P, info->tag, info->arity),
+                fields(q, h, info->arity));
+}
+
+/// `C w1 .. wn` from the first fields of a witness, in place
+string Checker::show(u32 type, u32 tag, std::vector<string>& w) const {
+  auto& data  = this->env.types[type];
+  auto name   = data.cons[tag].string();
+  auto arity  = data.arity[tag];
+  auto s      = string();
+  bool tuple  = name[0] == '(';
+  for (u32 f = 0; f < arity; ++f)
+    s += (tuple ? (f ? ", " : "") : " ") + w[f];
+  w.erase(w.begin(), w.begin() + arity);
+  if (tuple)
+    return "(" + s + ")";
+  return arity ? "(" + name + s + ")" : name;
+}
+
+/// algorithm I: a witness of a row of `n` wildcards being useful
+option<std::vector<string>> Checker::missing(const Matrix& P, u32 n) {
+  if (this->err)
+    return {};
+  if (n == 0) {
+    if (!P.empty())
+      return {};
+    return std::vector<string>();
+  }
+  auto sig = signature(P);
+  if (this->err)
+    return {};
+  if (sig.type && sig.tags.count() == width(*sig.type)) {
+    auto buckets = specialize_all(P, *sig.type);
+    auto& data   = this->env.types[*sig.type];
+    for (u32 tag = 0; tag < buckets.size(); ++tag) {
+      auto w = missing(buckets[tag], data.arity[tag] + n - 1);
+      if (w) {
+        auto head = show(*sig.type, tag, *w);
+        w->insert(w->begin(), head);
+        return w;
+      }
+    }
+    return {};
+  }
+  auto w = missing(defaults(P), n - 1);
+  if (!w)
+    return {};
+  auto head = string("_");
+  if (sig.type) {
+    // any constructor absent from the column will do
+    auto tag   = sig.tags.first_missing(width(*sig.type));
+    auto blank = std::vector<string>(this->env.types[*sig.type].arity[tag],
+                                     "_");
+    head       = show(*sig.type, tag, blank);
+  }
+  w->insert(w->begin(), head);
+  return w;
+}
+
+MResult<Coverage> run(const ast::Module& m, ConEnv& env, const Matrix& rows,
+                      u32 arity) {
+  auto c     = Checker{m, env, {}};
+  auto cover = Coverage();
+  auto above = Matrix();
+  for (u32 k = 0; k < rows.size(); ++k) {
+    if (!c.useful(above, rows[k]))
+      cover.redundant.push_back(k);
+    above.push_back(rows[k]);
+  }
+  if (auto w = c.missing(above, arity))
+    cover.missing = std::move(*w);
+  if (c.err)
+    return tl::make_unexpected(std::move(*c.err));
+  return cover;
+}
+} // namespace
+
+MResult<Coverage> check(const ast::Module& m, ConEnv& env,
+                        const ast::ECase& e) {
+  auto rows = Matrix();
+  for (u32 k = 0; k < e.alts.len; ++k)
+    rows.push_back(Vec{m[m.at<Ref<ast::Alt>>(e.alts, k)].pat});
+  return run(m, env, rows, 1);
+}
+
+MResult<Coverage> check(const ast::Module& m, ConEnv& env,
+                        const std::vector<ast::ItemRef>& items, usize first) {
+  auto rows = clause_rows(m, items, first);
+  if (!rows)
+    return tl::make_unexpected(std::move(rows.error()));
+  auto arity = rows->empty() ? 0 : static_cast<u32>((*rows)[0].size());
+  return run(m, env, *rows, arity);
+}
+
+} // namespace mangekyou::pat
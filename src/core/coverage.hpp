@@ -0,0 +1,56 @@
+#pragma once
+#include <prelude.hpp>
+#include <vector>
+
+#include "match.hpp"
+
+/** exhaustiveness and redundancy of pattern matches, with the usefulness
+ * algorithm of Maranget, "Warnings for pattern matching", 2007.
+ * a row is useful against a matrix if some value matches it and no row of
+ * the matrix: a clause is redundant when it is not useful against the ones
+ * above it, a match is exhaustive when a row of wildcards is not useful
+ * against all of its clauses.
+ *
+ * a wildcard only splits into one branch per constructor when the column's
+ * constructors are a complete signature, otherwise it continues with the
+ * default matrix once. signatures are bitsets over constructor tags, and
+ * rows are bucketed by tag in one pass, so wide data types cost linear work
+ * per column rather than a pass per constructor.
+ */
+namespace mangekyou::pat {
+
+/// a set of constructor tags of one type
+struct TagSet {
+  std::vector<u64> words;
+
+  explicit TagSet(u32 n)
+      : words((n + 63) / 64) {}
+
+  void set(u32 tag) { this->words[tag / 64] |= u64(1) << (tag % 64); }
+  bool has(u32 tag) const {
+    return this->words[tag / 64] >> (tag % 64) & 1;
+  }
+  u32 count() const;
+  /// the smallest tag below `n` not in the set, `n` if there is none
+  u32 first_missing(u32 n) const;
+};
+
+struct Coverage {
+  /// indices of the clauses that can never be selected
+  std::vector<u32> redundant;
+  /// a value no clause matches, one pattern per scrutinee, written as
+  /// patterns with `_` for any value. empty when the match is exhaustive
+  std::vector<string> missing;
+
+  bool exhaustive() const { return this->missing.empty(); }
+};
+
+/// the alternatives of `e`
+MResult<Coverage> check(const ast::Module& m, ConEnv& env,
+                        const ast::ECase& e);
+/// the clauses of the function defined from `items[first]`, as for
+/// `compile`
+MResult<Coverage> check(const ast::Module& m, ConEnv& env,
+                        const std::vector<ast::ItemRef>& items, usize first);
+
+} // namespace mangekyou::pat
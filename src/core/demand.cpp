@@ -0,0 +1,292 @@
+#include "demand.hpp"
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace mangekyou::core {
+
+namespace {
+
+/// the variables certainly evaluated, sorted, or all of them
+struct Demands {
+  bool all = false;
+  std::vector<u32> vars;
+
+  static Demands diverges() { return Demands{true, {}}; }
+
+  bool has(VarRef v) const {
+    return this->all
+           || std::binary_search(this->vars.begin(), this->vars.end(), v.i);
+  }
+  /// both are evaluated
+  Demands& both(const Demands& other) {
+    if (this->all || other.all) {
+      *this = diverges();
+      return *this;
+    }
+    auto out = std::vector<u32>();
+    std::set_union(this->vars.begin(), this->vars.end(), other.vars.begin(),
+                   other.vars.end(), std::back_inserter(out));
+    this->vars = std::move(out);
+    return *this;
+  }
+  /// one of them is evaluated
+  Demands& either(const Demands& other) {
+    if (other.all)
+      return *this;
+    if (this->all) {
+      *this = other;
+      return *this;
+    }
+    auto out = std::vector<u32>();
+    std::set_intersection(this->vars.begin(), this->vars.end(),
+                          other.vars.begin(), other.vars.end(),
+                          std::back_inserter(out));
+    this->vars = std::move(out);
+    return *this;
+  }
+  Demands& drop(VarRef v) {
+    auto it = std::lower_bound(this->vars.begin(), this->vars.end(), v.i);
+    if (it != this->vars.end() && *it == v.i)
+      this->vars.erase(it);
+    return *this;
+  }
+};
+
+/// needs no thunk: a value, or a variable holding one or a thunk already
+bool trivial(const Program& p, ExprRef e) {
+  auto& node = p[e];
+  if (auto* a = std::get_if<EApp>(&node))
+    return p[a->fn].is<ECon>();
+  return node.is<EVar>() || node.is<ELit>() || node.is<ECon>()
+         || node.is<ELam>();
+}
+
+struct Analyser {
+  Program& p;
+  Strictness& stats;
+  /// the lambda each function is bound to, by the function's variable
+  std::unordered_map<u32, ExprRef> lambdas;
+  /// the strict parameters of each of those
+  std::unordered_map<u32, std::vector<bool>> sigs;
+  /// whether the body of each `let` demands its variable, by variable
+  std::vector<u8> demanded;
+
+  const std::vector<bool>* sig(ExprRef fn) const {
+    auto* x = std::get_if<EVar>(&this->p[fn]);
+    if (!x)
+      return nullptr;
+    auto it = this->sigs.find(x->var.i);
+    return it == this->sigs.end() ? nullptr : &it->second;
+  }
+
+  std::vector<bool> signature(ExprRef lam) {
+    auto l   = std::get<ELam>(this->p[lam]);
+    auto d   = eval(l.body);
+    auto out = std::vector<bool>();
+    for (u32 k = 0; k < l.params.len; ++k)
+      out.push_back(d.has(this->p.at<VarRef>(l.params, k)));
+    return out;
+  }
+
+  /// the functions of a recursive group start strict in everything, and
+  /// are weakened until their signatures stop changing
+  void group(const std::vector<Bind>& binds) {
+    for (auto& b : binds)
+      if (auto* l = std::get_if<ELam>(&this->p[b.rhs])) {
+        this->lambdas[b.var.i] = b.rhs;
+        this->sigs[b.var.i]    = std::vector<bool>(l->params.len, true);
+      }
+    for (auto changed = true; changed;) {
+      changed = false;
+      for (auto& b : binds) {
+        if (!this->p[b.rhs].is<ELam>())
+          continue;
+        auto s = signature(b.rhs);
+        if (s != this->sigs[b.var.i]) {
+          this->sigs[b.var.i] = std::move(s);
+          changed             = true;
+        }
+      }
+    }
+    for (auto& b : binds)
+      if (!this->p[b.rhs].is<ELam>())
+        eval(b.rhs);
+  }
+
+  Demands eval(ExprRef e) {
+    auto node = Expr(this->p[e]);
+    return std::visit(
+        overloaded{
+            [&](const EVar& x) { return Demands{false, {x.var.i}}; },
+            [](const ELit&) { return Demands(); },
+            [](const ECon&) { return Demands(); },
+            [](const EFail&) { return Demands::diverges(); },
+            [&](const ELam& x) {
+              eval(x.body);
+              return Demands();
+            },
+            [&](const EApp& x) {
+              auto d = eval(x.fn);
+              auto s = sig(x.fn);
+              if (s && x.args.len < s->size())
+                s = nullptr;
+              for (u32 k = 0; k < x.args.len; ++k) {
+                auto a = eval(this->p.at<ExprRef>(x.args, k));
+                if (s && k < s->size() && (*s)[k])
+                  d.both(a);
+              }
+              return d;
+            },
+            [&](const ECall& x) {
+              auto d = Demands();
+              for (u32 k = 0; k < x.args.len; ++k)
+                d.both(eval(this->p.at<ExprRef>(x.args, k)));
+              return d;
+            },
+            [&](const ELet& x) {
+              auto r = Demands();
+              if (this->p[x.rhs].is<ELam>()) {
+                this->lambdas[x.var.i] = x.rhs;
+                this->sigs[x.var.i]    = signature(x.rhs);
+              } else {
+                r = eval(x.rhs);
+              }
+              auto d = eval(x.body);
+              auto strict =
+                  d.has(x.var) && !d.all && !trivial(this->p, x.rhs);
+              this->demanded[x.var.i] = strict;
+              d.drop(x.var);
+              if (strict)
+                d.both(r);
+              return d;
+            },
+            [&](const ELetRec& x) {
+              auto binds = std::vector<Bind>();
+              for (u32 k = 0; k < x.binds.len; ++k)
+                binds.push_back(this->p[this->p.at<Ref<Bind>>(x.binds, k)]);
+              group(binds);
+              auto d = eval(x.body);
+              for (auto& b : binds)
+                d.drop(b.var);
+              return d;
+            },
+            [&](const ECase& x) {
+              auto d    = eval(x.scrut);
+              auto alts = Demands::diverges();
+              for (u32 k = 0; k < x.alts.len; ++k) {
+                auto alt = this->p[this->p.at<Ref<Alt>>(x.alts, k)];
+                auto a   = eval(alt.rhs);
+                for (u32 v = 0; v < alt.vars.len; ++v)
+                  a.drop(this->p.at<VarRef>(alt.vars, v));
+                if (x.bndr.valid())
+                  a.drop(x.bndr);
+                alts.either(a);
+              }
+              return d.both(alts);
+            }},
+        static_cast<const Expr::variant&>(node));
+  }
+
+  /** applying the results */
+  /// `case rhs as x of { _ -> body }`
+  ExprRef force(ExprRef rhs, VarRef x, ExprRef body) {
+    this->p.vars[x.i].strict = true;
+    auto alt  = this->p.add(Alt{Alt::Default, 0, 0, LitRef(), Span{}, body});
+    auto alts = std::vector<Ref<Alt>>{alt};
+    return this->p.add(ECase{rhs, x, this->p.list(alts)},
+                       this->p.type_of(body));
+  }
+
+  void rewrite(ExprRef e) {
+    auto node = Expr(this->p[e]);
+    auto list = [&](Span s) {
+      for (u32 k = 0; k < s.len; ++k)
+        rewrite(this->p.at<ExprRef>(s, k));
+    };
+    std::visit(
+        overloaded{
+            [](const EVar&) {}, [](const ELit&) {}, [](const ECon&) {},
+            [](const EFail&) {},
+            [&](const ELam& x) { rewrite(x.body); },
+            [&](const ECall& x) { list(x.args); },
+            [&](const EApp& x) {
+              rewrite(x.fn);
+              list(x.args);
+              auto s = sig(x.fn);
+              if (!s || x.args.len < s->size())
+                return;
+              auto lam    = std::get<ELam>(this->p[this->lambdas.at(
+                  std::get<EVar>(this->p[x.fn]).var.i)]);
+              auto args   = std::vector<ExprRef>();
+              auto forced = std::vector<std::pair<VarRef, ExprRef>>();
+              for (u32 k = 0; k < x.args.len; ++k) {
+                auto a = this->p.at<ExprRef>(x.args, k);
+                if (k < s->size() && (*s)[k] && !trivial(this->p, a)) {
+                  auto& param = this->p[this->p.at<VarRef>(lam.params, k)];
+                  auto t = this->p.add(Var{param.name, this->p.type_of(a)});
+                  forced.emplace_back(t, a);
+                  a = this->p.add(EVar{t}, this->p.type_of(a));
+                  ++this->stats.args;
+                }
+                args.push_back(a);
+              }
+              if (forced.empty())
+                return;
+              auto body = this->p.add(EApp{x.fn, this->p.list(args)},
+                                      this->p.type_of(e));
+              for (auto it = forced.rbegin(); it != forced.rend(); ++it)
+                body = force(it->second, it->first, body);
+              this->p.replace(e, body);
+            },
+            [&](const ELet& x) {
+              rewrite(x.rhs);
+              rewrite(x.body);
+              if (!this->demanded[x.var.i])
+                return;
+              ++this->stats.lets;
+              this->p.replace(e, force(x.rhs, x.var, x.body));
+            },
+            [&](const ELetRec& x) {
+              for (u32 k = 0; k < x.binds.len; ++k)
+                rewrite(this->p[this->p.at<Ref<Bind>>(x.binds, k)].rhs);
+              rewrite(x.body);
+            },
+            [&](const ECase& x) {
+              rewrite(x.scrut);
+              if (x.bndr.valid())
+                this->p.vars[x.bndr.i].strict = true;
+              for (u32 k = 0; k < x.alts.len; ++k)
+                rewrite(this->p[this->p.at<Ref<Alt>>(x.alts, k)].rhs);
+            }},
+        static_cast<const Expr::variant&>(node));
+  }
+};
+
+} // namespace
+
+Strictness strictness(Program& p) {
+  auto stats = Strictness();
+  auto a     = Analyser{p, stats, {}, {}, std::vector<u8>(p.vars.size())};
+  auto top   = std::vector<Bind>();
+  for (auto b : p.top)
+    top.push_back(p[b]);
+  a.group(top);
+
+  for (auto& [f, lam] : a.lambdas) {
+    auto& l = std::get<ELam>(p[lam]);
+    auto& s = a.sigs[f];
+    for (u32 k = 0; k < l.params.len; ++k) {
+      auto& v = p.vars[p.at<VarRef>(l.params, k).i];
+      if (s[k] && !v.strict) {
+        v.strict = true;
+        ++stats.params;
+      }
+    }
+  }
+  for (auto& b : top)
+    a.rewrite(b.rhs);
+  return stats;
+}
+
+} // namespace mangekyou::core
@@ -0,0 +1,39 @@
+#pragma once
+#include <prelude.hpp>
+
+#include "ir.hpp"
+
+/** demand analysis: which variables an expression certainly evaluates,
+ * so that what it would evaluate anyway is computed up front rather than
+ * suspended in a thunk.
+ *
+ * the demand of an expression is the set of its free variables evaluating
+ * it to weak head normal form evaluates, every variable when it diverges.
+ * a function's signature is which of its parameters its body demands;
+ * recursive groups start from "strict in everything" and weaken until
+ * nothing changes. constructor fields are lazy, `extern` calls evaluate
+ * their arguments and an alternative demands what all of them demand.
+ *
+ * the results are applied to the program:
+ * - strict parameters are marked `Var::strict`,
+ * - a `let` whose variable is demanded, and which is not a value already,
+ *   becomes `case rhs as x of { _ -> body }`,
+ * - a saturated call of a known function evaluates the arguments it is
+ *   strict in with a `case` before the call, when they are not values or
+ *   variables already.
+ */
+namespace mangekyou::core {
+
+struct Strictness {
+  /// parameters marked strict
+  u32 params = 0;
+  /// `let`s turned into `case`s
+  u32 lets = 0;
+  /// arguments evaluated before their call
+  u32 args = 0;
+};
+
+/// analyse `p` and evaluate what is demanded eagerly, in place
+Strictness strictness(Program& p);
+
+} // namespace mangekyou::core
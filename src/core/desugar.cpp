@@ -0,0 +1,612 @@
+#include "desugar.hpp"
+
+#include <functional>
+#include <unordered_map>
+
+#include "match.hpp"
+
+namespace mangekyou::core {
+
+using parse::SourceLoc;
+
+namespace {
+
+/// `()`, or `(,)`, `(,,)`, ... for `n` elements
+Id tuple(u32 n) {
+  return Id(n == 0 ? string("()") : "(" + string(n - 1, ',') + ")");
+}
+
+/// a name for the variable holding each occurrence: the first pattern
+/// variable bound to it, `x` when there is none
+std::vector<Id> occ_names(const pat::DecisionTree& t) {
+  auto names = std::vector<Id>(t.occs.size(), Id("x"));
+  auto named = std::vector<bool>(t.occs.size());
+  for (auto& b : t.binds)
+    if (!named[b.occ.i]) {
+      names[b.occ.i] = b.id;
+      named[b.occ.i] = true;
+    }
+  return names;
+}
+
+CoreError error(const pat::MatchError& e) { return CoreError{e.at, e.message}; }
+
+struct Desugar {
+  using Body = std::function<CResult<ExprRef>(u32)>;
+
+  const ast::Module& m;
+  Program p;
+  /// local variables and top-level functions, innermost last
+  std::vector<std::pair<Id, VarRef>> scope;
+  /// index in `p.externs`
+  std::unordered_map<Id, u32> externs;
+
+  auto fail(SourceLoc at, string message) {
+    return tl::make_unexpected(CoreError{at, std::move(message)});
+  }
+
+  /** Types */
+  TypeRef con(const char* name) { return this->p.type(TCon{Id(name)}); }
+  TypeRef fun(TypeRef from, TypeRef to) {
+    return this->p.type(TFun{from, to});
+  }
+
+  TypeRef type(ast::TypeRef t) {
+    return std::visit(
+        overloaded{
+            [&](const ast::TCon& x) { return this->p.type(TCon{x.id}); },
+            [&](const ast::TVar& x) { return this->p.type(TVar{x.id}); },
+            [&](const ast::TInfer&) { return this->p.fresh_type(); },
+            [&](const ast::TApp& x) {
+              auto lhs = type(x.lhs);
+              auto rhs = type(x.rhs);
+              return this->p.type(TApp{lhs, rhs});
+            },
+            [&](const ast::TFun& x) {
+              auto from = type(x.from);
+              return fun(from, type(x.to));
+            },
+            [&](const ast::TTuple& x) {
+              if (x.elems.len == 1)
+                return type(this->m.at<ast::TypeRef>(x.elems, 0));
+              auto ty = this->p.type(TCon{tuple(x.elems.len)});
+              for (u32 k = 0; k < x.elems.len; ++k) {
+                auto elem = type(this->m.at<ast::TypeRef>(x.elems, k));
+                ty        = this->p.type(TApp{ty, elem});
+              }
+              return ty;
+            }},
+        static_cast<const ast::Type::variant&>(this->m[t]));
+  }
+
+  TypeRef lit_type(const Literal& l) {
+    return std::visit(
+        overloaded{[&](u64) { return con("Int"); },
+                   [&](const pat::BigInt&) { return con("Integer"); },
+                   [&](double) { return con("Double"); },
+                   [&](char) { return con("Char"); },
+                   [&](std::string_view) { return con("String"); }},
+        static_cast<const Literal::variant&>(l));
+  }
+
+  /// `f1 -> .. -> fn -> T a1 .. am` for constructor `tag` of `data[type]`
+  TypeRef con_type(u32 type, u32 tag) {
+    auto& data = this->p.data[type];
+    auto ty    = this->p.type(TCon{data.name});
+    for (auto& a : data.params)
+      ty = this->p.type(TApp{ty, this->p.type(TVar{a})});
+    auto& fields = data.cons[tag].fields;
+    for (auto k = fields.size(); k-- > 0;)
+      ty = fun(fields[k], ty);
+    return ty;
+  }
+
+  /** Data types */
+  /// declare `d` to the match compiler too, under the same number
+  void declare(DataType d) {
+    auto info = pat::DataInfo{d.name, {}, {}};
+    for (auto& c : d.cons) {
+      info.cons.push_back(c.name);
+      info.arity.push_back(static_cast<u32>(c.fields.size()));
+    }
+    this->p.env.declare(info);
+    this->p.data.push_back(std::move(d));
+  }
+  void datas() {
+    for (auto& item : this->m.decls) {
+      auto* d = std::get_if<ast::DataDecl>(&item);
+      if (!d)
+        continue;
+      auto data = DataType{d->id, {}, {}};
+      for (u32 k = 0; k < d->params.len; ++k)
+        data.params.push_back(this->m[this->m.at<Ref<Id>>(d->params, k)]);
+      for (u32 k = 0; k < d->cons.len; ++k) {
+        auto& c   = this->m[this->m.at<Ref<ast::DataCon>>(d->cons, k)];
+        auto con  = DataCon{c.id, {}};
+        for (u32 a = 0; a < c.args.len; ++a)
+          con.fields.push_back(type(this->m.at<ast::TypeRef>(c.args, a)));
+        data.cons.push_back(std::move(con));
+      }
+      declare(std::move(data));
+    }
+  }
+  /// `data` for the tuple types the match compiler declared on demand
+  void sync() {
+    auto& env = this->p.env;
+    for (auto t = this->p.data.size(); t < env.types.size(); ++t) {
+      auto& info = env.types[t];
+      auto data  = DataType{info.name, {}, {DataCon{info.name, {}}}};
+      for (u32 k = 0; k < info.arity[0]; ++k) {
+        data.params.push_back(Id("t" + std::to_string(k)));
+        data.cons[0].fields.push_back(this->p.type(TVar{data.params.back()}));
+      }
+      this->p.data.push_back(std::move(data));
+    }
+  }
+  const pat::ConInfo* lookup(const Id& id) {
+    auto* c = this->p.env.lookup(id);
+    sync();
+    return c;
+  }
+
+  void declare(const ast::ExternDecl& x) {
+    auto ty    = type(x.ty);
+    auto arity = u32(0);
+    for (auto* f = std::get_if<TFun>(&this->p[ty]); f;
+         f       = std::get_if<TFun>(&this->p[f->to]))
+      ++arity;
+    this->externs[x.id] = static_cast<u32>(this->p.externs.size());
+    this->p.externs.push_back(Extern{x.id, ty, arity});
+  }
+
+  /** Names */
+  option<VarRef> local(const Id& id) const {
+    for (auto it = this->scope.rbegin(); it != this->scope.rend(); ++it)
+      if (it->first == id)
+        return it->second;
+    return {};
+  }
+  VarRef bind(const Id& id, TypeRef ty) {
+    auto v = this->p.add(Var{id, ty});
+    this->scope.emplace_back(id, v);
+    return v;
+  }
+  /// drop the variables bound since `scope` was `mark` long
+  void unwind(usize mark) {
+    this->scope.erase(this->scope.begin() + mark, this->scope.end());
+  }
+  ExprRef var(VarRef v) { return this->p.add(EVar{v}, this->p[v].ty); }
+
+  ExprRef app(ExprRef fn, const std::vector<ExprRef>& args) {
+    if (args.empty())
+      return fn;
+    auto ty = this->p.result(this->p.type_of(fn), args.size());
+    return this->p.add(EApp{fn, this->p.list(args)}, ty);
+  }
+
+  /// `externs[ext]` applied to exactly its arity: the arguments past it
+  /// apply to the call, missing ones are abstracted over
+  ExprRef call(u32 ext, std::vector<ExprRef> args) {
+    auto ext_ty = this->p.externs[ext].ty;
+    auto arity  = this->p.externs[ext].arity;
+    auto given  = static_cast<u32>(args.size());
+    auto params = std::vector<VarRef>();
+    auto ty     = ext_ty;
+    for (u32 k = 0; k < arity; ++k) {
+      auto f = std::get<TFun>(this->p[ty]);
+      if (k >= given) {
+        params.push_back(this->p.add(Var{Id("a"), f.from}));
+        args.push_back(var(params.back()));
+      }
+      ty = f.to;
+    }
+    auto rest = std::vector<ExprRef>(args.begin() + arity, args.end());
+    args.resize(arity);
+    auto e = this->p.add(ECall{ext, this->p.list(args)}, ty);
+    if (!params.empty())
+      return this->p.add(ELam{this->p.list(params), e},
+                         this->p.result(ext_ty, given));
+    return app(e, rest);
+  }
+
+  /// `id args`, `id` a variable, an `extern` or a constructor
+  CResult<ExprRef> apply(const Id& id, SourceLoc at,
+                         std::vector<ExprRef> args) {
+    if (auto v = local(id))
+      return app(var(*v), args);
+    if (auto it = this->externs.find(id); it != this->externs.end())
+      return call(it->second, std::move(args));
+    if (auto* c = lookup(id)) {
+      auto fn = this->p.add(ECon{c->type, c->tag}, con_type(c->type, c->tag));
+      return app(fn, args);
+    }
+    return fail(at, "`" + id.string() + "` is not in scope");
+  }
+
+  /** Expressions */
+  CResult<std::vector<ExprRef>> exprs(const std::vector<ast::ExprRef>& es) {
+    auto out = std::vector<ExprRef>();
+    for (auto e : es) {
+      auto r = expr(e);
+      if (!r)
+        return tl::make_unexpected(std::move(r.error()));
+      out.push_back(*r);
+    }
+    return out;
+  }
+
+  /// the Core for `e`, its outermost node at `e`'s location
+  CResult<ExprRef> expr(ast::ExprRef e) {
+    auto at  = this->m.loc(e);
+    auto out = std::visit(
+        overloaded{
+            [&](const ast::ELit& x) -> CResult<ExprRef> {
+              auto& l = this->m[x.lit];
+              return this->p.add(ELit{this->p.add(l)}, lit_type(l));
+            },
+            [&](const ast::EVar& x) { return apply(x.id, at, {}); },
+            [&](const ast::ECon& x) { return apply(x.id, at, {}); },
+            [&](const ast::EApp&) { return spine(e); },
+            [&](const ast::EOp& x) -> CResult<ExprRef> {
+              auto args = exprs({x.lhs, x.rhs});
+              if (!args)
+                return tl::make_unexpected(std::move(args.error()));
+              return apply(this->m[x.op], at, std::move(*args));
+            },
+            [&](const ast::ELam& x) { return lambda(x); },
+            [&](const ast::ELet& x) -> CResult<ExprRef> {
+              auto items = std::vector<ast::ItemRef>();
+              for (u32 k = 0; k < x.items.len; ++k)
+                items.push_back(this->m.at<ast::ItemRef>(x.items, k));
+              auto mark  = this->scope.size();
+              auto binds = group(items);
+              if (!binds)
+                return tl::make_unexpected(std::move(binds.error()));
+              auto body = expr(x.body);
+              unwind(mark);
+              if (!body || binds->empty())
+                return body;
+              return this->p.add(ELetRec{this->p.list(*binds), *body},
+                                 this->p.type_of(*body));
+            },
+            [&](const ast::ECase& x) -> CResult<ExprRef> {
+              auto scrut = expr(x.scrut);
+              if (!scrut)
+                return scrut;
+              auto tree = pat::compile(this->m, this->p.env, x);
+              sync();
+              if (!tree)
+                return tl::make_unexpected(error(tree.error()));
+              auto v = this->p.add(
+                  Var{occ_names(*tree)[0], this->p.type_of(*scrut)});
+              auto body = match(*tree, {v}, [&](u32 k) {
+                return expr(this->m[this->m.at<Ref<ast::Alt>>(x.alts, k)].body);
+              });
+              if (!body)
+                return body;
+              return this->p.add(ELet{v, *scrut, *body},
+                                 this->p.type_of(*body));
+            },
+            [&](const ast::ETuple& x) -> CResult<ExprRef> {
+              if (x.elems.len == 1)
+                return expr(this->m.at<ast::ExprRef>(x.elems, 0));
+              auto elems = std::vector<ast::ExprRef>();
+              for (u32 k = 0; k < x.elems.len; ++k)
+                elems.push_back(this->m.at<ast::ExprRef>(x.elems, k));
+              auto args = exprs(elems);
+              if (!args)
+                return tl::make_unexpected(std::move(args.error()));
+              return apply(tuple(x.elems.len), at, std::move(*args));
+            },
+            [&](const ast::EAnn& x) -> CResult<ExprRef> {
+              auto r = expr(x.expr);
+              if (r)
+                this->p.expr_types[r->i] = type(x.ty);
+              return r;
+            }},
+        static_cast<const ast::Expr::variant&>(this->m[e]));
+    // an inner node standing for all of `e` keeps its own location
+    if (out && !this->p.loc(*out).valid())
+      this->p.expr_locs[out->i] = at;
+    return out;
+  }
+
+  /// `f a1 .. an` as one application, or one call when `f` names an extern
+  CResult<ExprRef> spine(ast::ExprRef e) {
+    auto args = std::vector<ast::ExprRef>();
+    while (auto* a = std::get_if<ast::EApp>(&this->m[e])) {
+      args.insert(args.begin(), a->arg);
+      e = a->fn;
+    }
+    auto head = option<Id>();
+    if (auto* v = std::get_if<ast::EVar>(&this->m[e]))
+      head = v->id;
+    else if (auto* c = std::get_if<ast::ECon>(&this->m[e]))
+      head = c->id;
+    auto fn = head ? CResult<ExprRef>() : expr(e);
+    if (!fn)
+      return fn;
+    auto xs = exprs(args);
+    if (!xs)
+      return tl::make_unexpected(std::move(xs.error()));
+    if (head)
+      return apply(*head, this->m.loc(e), std::move(*xs));
+    return app(*fn, *xs);
+  }
+
+  CResult<ExprRef> lambda(const ast::ELam& x) {
+    auto ty    = x.ty.valid() ? type(x.ty) : this->p.fresh_type();
+    auto mark  = this->scope.size();
+    auto param = VarRef();
+    auto body  = CResult<ExprRef>();
+    if (auto* v = std::get_if<pat::PVar>(&this->m[x.param])) {
+      param = bind(v->id, ty);
+      body  = expr(x.body);
+    } else {
+      auto tree = pat::compile(this->m, this->p.env, x.param);
+      sync();
+      if (!tree)
+        return tl::make_unexpected(error(tree.error()));
+      param = this->p.add(Var{occ_names(*tree)[0], ty});
+      body  = match(*tree, {param}, [&](u32) { return expr(x.body); });
+    }
+    unwind(mark);
+    if (!body)
+      return body;
+    auto params = std::vector<VarRef>{param};
+    return this->p.add(ELam{this->p.list(params), *body},
+                       fun(ty, this->p.type_of(*body)));
+  }
+
+  /** Pattern matching */
+  CResult<ExprRef> match(const pat::DecisionTree& t,
+                         const std::vector<VarRef>& scruts, const Body& body) {
+    // the variable holding each occurrence on the current path, and the
+    // occurrences of the fields of each occurrence
+    auto vars     = std::vector<VarRef>(t.occs.size());
+    auto children = std::vector<std::vector<pat::OccRef>>(t.occs.size());
+    auto names    = occ_names(t);
+    for (u32 k = 0; k < t.arity; ++k)
+      vars[k] = scruts[k];
+    for (u32 o = 0; o < t.occs.size(); ++o) {
+      auto& occ = t.occs[o];
+      if (!occ.parent.valid())
+        continue;
+      auto& cs = children[occ.parent.i];
+      if (cs.size() <= occ.field)
+        cs.resize(occ.field + 1);
+      cs[occ.field] = pat::OccRef{o};
+    }
+
+    // the first leaf of every clause, and how many there are
+    auto firsts = std::vector<const pat::Leaf*>();
+    auto counts = std::vector<u32>();
+    auto count  = [&](pat::DRef r, auto& self) -> void {
+      std::visit(overloaded{[&](const pat::Leaf& l) {
+                              if (firsts.size() <= l.clause) {
+                                firsts.resize(l.clause + 1);
+                                counts.resize(l.clause + 1);
+                              }
+                              if (!counts[l.clause]++)
+                                firsts[l.clause] = &l;
+                            },
+                            [](const pat::Fail&) {},
+                            [&](const pat::Switch& s) {
+                              for (u32 k = 0; k < s.cases.len; ++k)
+                                self(t.at(s.cases, k).next, self);
+                              if (s.fallback.valid())
+                                self(s.fallback, self);
+                            }},
+                 static_cast<const pat::DNode::variant&>(t[r]));
+    };
+    count(t.root, count);
+
+    // a clause reached more than once is a join point, `\ vars -> body`
+    // bound around the whole match, its leaves jumps to it
+    struct Join {
+      VarRef var;
+      ExprRef rhs;
+      std::vector<Id> ids;
+    };
+    auto joins = std::vector<option<Join>>(counts.size());
+    for (u32 c = 0; c < counts.size(); ++c) {
+      if (counts[c] < 2)
+        continue;
+      auto mark   = this->scope.size();
+      auto join   = Join{};
+      auto params = std::vector<VarRef>();
+      for (u32 k = 0; k < firsts[c]->binds.len; ++k) {
+        auto& b = t.binds[firsts[c]->binds.start + k];
+        join.ids.push_back(b.id);
+        params.push_back(bind(b.id, this->p.fresh_type()));
+      }
+      auto rhs = body(c);
+      unwind(mark);
+      if (!rhs)
+        return rhs;
+      join.rhs = *rhs;
+      if (!params.empty()) {
+        auto ty = this->p.type_of(*rhs);
+        for (auto k = params.size(); k-- > 0;)
+          ty = fun(this->p[params[k]].ty, ty);
+        join.rhs = this->p.add(ELam{this->p.list(params), *rhs}, ty);
+      }
+      join.var = this->p.add(Var{Id("j"), this->p.type_of(join.rhs)});
+      joins[c] = std::move(join);
+    }
+
+    auto node = [&](pat::DRef r, auto& self) -> CResult<ExprRef> {
+      return std::visit(
+          overloaded{
+              [&](const pat::Leaf& l) -> CResult<ExprRef> {
+                auto occ = [&](const Id& id) {
+                  for (u32 k = 0; k < l.binds.len; ++k)
+                    if (t.binds[l.binds.start + k].id == id)
+                      return vars[t.binds[l.binds.start + k].occ.i];
+                  return VarRef();
+                };
+                if (auto& j = joins[l.clause]) {
+                  auto args = std::vector<ExprRef>();
+                  for (auto& id : j->ids)
+                    args.push_back(var(occ(id)));
+                  return app(var(j->var), args);
+                }
+                auto mark = this->scope.size();
+                for (u32 k = 0; k < l.binds.len; ++k) {
+                  auto& b = t.binds[l.binds.start + k];
+                  this->scope.emplace_back(b.id, vars[b.occ.i]);
+                }
+                auto e = body(l.clause);
+                unwind(mark);
+                return e;
+              },
+              [&](const pat::Fail&) -> CResult<ExprRef> {
+                return this->p.add(EFail{}, this->p.fresh_type());
+              },
+              [&](const pat::Switch& s) -> CResult<ExprRef> {
+                auto scrut = vars[s.occ.i];
+                auto alts  = std::vector<Ref<Alt>>();
+                auto ty    = TypeRef();
+                for (u32 k = 0; k < s.cases.len; ++k) {
+                  auto& c   = t.at(s.cases, k);
+                  auto alt  = Alt{Alt::Lit, 0, c.tag, LitRef(), Span{}, {}};
+                  auto args = std::vector<VarRef>();
+                  if (s.type != pat::Switch::NO_TYPE) {
+                    alt.kind  = Alt::Con;
+                    alt.type  = s.type;
+                    auto tys  = this->p.fields(s.type, c.tag,
+                                               this->p[scrut].ty);
+                    auto& sub = children[s.occ.i];
+                    for (u32 f = 0; f < tys.size(); ++f) {
+                      auto o = f < sub.size() ? sub[f] : pat::OccRef();
+                      args.push_back(this->p.add(
+                          Var{o.valid() ? names[o.i] : Id("x"), tys[f]}));
+                      if (o.valid())
+                        vars[o.i] = args.back();
+                    }
+                    alt.vars = this->p.list(args);
+                  } else {
+                    alt.lit = this->p.add(this->m[c.lit]);
+                  }
+                  auto rhs = self(c.next, self);
+                  if (!rhs)
+                    return rhs;
+                  alt.rhs = *rhs;
+                  ty      = ty.valid() ? ty : this->p.type_of(*rhs);
+                  alts.push_back(this->p.add(alt));
+                }
+                if (s.fallback.valid()) {
+                  auto rhs = self(s.fallback, self);
+                  if (!rhs)
+                    return rhs;
+                  ty = ty.valid() ? ty : this->p.type_of(*rhs);
+                  alts.push_back(this->p.add(
+                      Alt{Alt::Default, 0, 0, LitRef(), Span{}, *rhs}));
+                }
+                return this->p.add(
+                    ECase{var(scrut), VarRef(), this->p.list(alts)}, ty);
+              }},
+          static_cast<const pat::DNode::variant&>(t[r]));
+    };
+    auto e = node(t.root, node);
+    if (!e)
+      return e;
+    for (auto k = joins.size(); k-- > 0;)
+      if (joins[k])
+        e = this->p.add(ELet{joins[k]->var, joins[k]->rhs, *e},
+                        this->p.type_of(*e));
+    return e;
+  }
+
+  /** Functions */
+  /// the function defined by the clauses starting at `items[first]`
+  CResult<ExprRef> function(const std::vector<ast::ItemRef>& items,
+                            usize first, TypeRef ty) {
+    auto cs   = pat::clauses(this->m, items, first);
+    auto body = [&](u32 k) {
+      return expr(std::get<ast::FnDecl>(this->m[items[first + k]]).body);
+    };
+    if (cs[0].len == 0) {
+      if (cs.size() > 1) {
+        auto& fn = std::get<ast::FnDecl>(this->m[items[first]]);
+        return fail(this->m.loc(items[first + 1]),
+                    "`" + fn.id.string() + "` is defined more than once");
+      }
+      return body(0);
+    }
+    auto tree = pat::compile(this->m, this->p.env, items, first);
+    sync();
+    if (!tree)
+      return tl::make_unexpected(error(tree.error()));
+    auto names  = occ_names(*tree);
+    auto params = std::vector<VarRef>();
+    for (u32 k = 0; k < tree->arity; ++k) {
+      auto* arrow = std::get_if<TFun>(&this->p[ty]);
+      auto f      = arrow ? *arrow
+                          : TFun{this->p.fresh_type(), this->p.fresh_type()};
+      params.push_back(this->p.add(Var{names[k], f.from}));
+      ty = f.to;
+    }
+    auto e = match(*tree, params, body);
+    if (!e)
+      return e;
+    auto fn_ty = this->p.type_of(*e);
+    for (auto k = params.size(); k-- > 0;)
+      fn_ty = fun(this->p[params[k]].ty, fn_ty);
+    return this->p.add(ELam{this->p.list(params), *e}, fn_ty);
+  }
+
+  /// the functions of `items`, all in scope from here on
+  CResult<std::vector<Ref<Bind>>> group(
+      const std::vector<ast::ItemRef>& items) {
+    auto sigs = std::unordered_map<Id, TypeRef>();
+    for (auto i : items) {
+      if (auto* s = std::get_if<ast::TypeSig>(&this->m[i]))
+        sigs[s->id] = type(s->ty);
+      else if (auto* x = std::get_if<ast::ExternDecl>(&this->m[i]))
+        declare(*x);
+    }
+    struct Fn {
+      usize first;
+      VarRef var;
+      bool typed;
+    };
+    auto fns = std::vector<Fn>();
+    for (usize i = 0; i < items.size(); ++i) {
+      auto* fn = std::get_if<ast::FnDecl>(&this->m[items[i]]);
+      if (!fn)
+        continue;
+      auto* prev = i ? std::get_if<ast::FnDecl>(&this->m[items[i - 1]])
+                     : nullptr;
+      if (prev && prev->id == fn->id)
+        continue;
+      auto sig = sigs.find(fn->id);
+      auto ty  = sig != sigs.end() ? sig->second : this->p.fresh_type();
+      fns.push_back(Fn{i, bind(fn->id, ty), sig != sigs.end()});
+    }
+    auto out = std::vector<Ref<Bind>>();
+    for (auto& fn : fns) {
+      auto rhs = function(items, fn.first, this->p[fn.var].ty);
+      if (!rhs)
+        return tl::make_unexpected(std::move(rhs.error()));
+      if (!fn.typed)
+        this->p.vars[fn.var.i].ty = this->p.type_of(*rhs);
+      out.push_back(this->p.add(Bind{fn.var, *rhs}));
+    }
+    return out;
+  }
+};
+
+} // namespace
+
+CResult<Program> desugar(const ast::Module& m) {
+  auto d = Desugar{m, Program(), {}, {}};
+  d.datas();
+  auto top = d.group(m.items);
+  if (!top)
+    return tl::make_unexpected(std::move(top.error()));
+  d.p.top = std::move(*top);
+  return std::move(d.p);
+}
+
+} // namespace mangekyou::core
@@ -0,0 +1,32 @@
+#pragma once
+#include <expected>
+#include <prelude.hpp>
+
+#include "ir.hpp"
+#include "parse/ast.hpp"
+
+/** the front end's `ast::Module` to Core.
+ * function clauses, lambda patterns and `case` alternatives go through the
+ * match compiler; every `Switch` of its decision tree becomes a `case` on
+ * the variable holding that occurrence. a clause reached from more than one
+ * leaf is bound once as a join point, a function of its pattern variables,
+ * rather than copied. operators and tuples become plain applications,
+ * `extern`s saturated calls.
+ *
+ * there is no type checker yet: types come from signatures, `data` and
+ * `extern` declarations and literals, everything else is a fresh `?n`.
+ */
+namespace mangekyou::core {
+
+struct CoreError {
+  parse::SourceLoc at;
+  string message;
+};
+
+template <typename T>
+using CResult = tl::expected<T, CoreError>;
+
+/// the top-level items of `m`, as one recursive group
+CResult<Program> desugar(const ast::Module& m);
+
+} // namespace mangekyou::core
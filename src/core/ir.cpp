@@ -0,0 +1,329 @@
+#include "ir.hpp"
+
+#include <cstring>
+#include <functional>
+
+namespace mangekyou::core {
+
+/** types */
+
+bool Type::operator==(const Type& other) const {
+  if (this->index() != other.index())
+    return false;
+  return std::visit(
+      overloaded{[&](const TCon& t) {
+                   return t.id == std::get<TCon>(other).id;
+                 },
+                 [&](const TVar& t) {
+                   return t.id == std::get<TVar>(other).id;
+                 },
+                 [&](const TApp& t) {
+                   auto& o = std::get<TApp>(other);
+                   return t.lhs.i == o.lhs.i && t.rhs.i == o.rhs.i;
+                 },
+                 [&](const TFun& t) {
+                   auto& o = std::get<TFun>(other);
+                   return t.from.i == o.from.i && t.to.i == o.to.i;
+                 }},
+      static_cast<const Type::variant&>(*this));
+}
+
+usize TypeHash::operator()(const Type& t) const {
+  // children are already interned, so their refs stand for them
+  auto h = std::visit(
+      overloaded{[](const TCon& t) { return std::hash<void*>{}(t.id.str); },
+                 [](const TVar& t) { return std::hash<void*>{}(t.id.str); },
+                 [](const TApp& t) { return usize(t.lhs.i) << 32 | t.rhs.i; },
+                 [](const TFun& t) { return usize(t.from.i) << 32 | t.to.i; }},
+      static_cast<const Type::variant&>(t));
+  return (h ^ t.index()) * 0x9E3779B97F4A7C15;
+}
+
+TypeRef Program::type(const Type& t) {
+  auto it = this->interned.find(t);
+  if (it != this->interned.end())
+    return it->second;
+  auto r = push(this->types, t);
+  this->interned.emplace(t, r);
+  return r;
+}
+
+TypeRef Program::fresh_type() {
+  return type(TVar{Id("?" + std::to_string(this->metas++))});
+}
+
+TypeRef Program::result(TypeRef ty, u32 n) {
+  for (u32 k = 0; k < n; ++k) {
+    auto* f = std::get_if<TFun>(&(*this)[ty]);
+    if (!f)
+      return fresh_type();
+    ty = f->to;
+  }
+  return ty;
+}
+
+std::vector<TypeRef> Program::fields(u32 type, u32 tag, TypeRef ty) {
+  auto& data = this->data[type];
+  auto& con  = data.cons[tag];
+  // `T a1 .. an`
+  auto args = std::vector<TypeRef>();
+  while (auto* app = std::get_if<TApp>(&(*this)[ty])) {
+    args.insert(args.begin(), app->rhs);
+    ty = app->lhs;
+  }
+  auto* head = std::get_if<TCon>(&(*this)[ty]);
+  if (!head || head->id != data.name || args.size() != data.params.size())
+    return con.fields;
+
+  std::function<TypeRef(TypeRef)> subst = [&](TypeRef t) -> TypeRef {
+    return std::visit(
+        overloaded{[&](const TCon&) { return t; },
+                   [&](const TVar& v) {
+                     for (usize k = 0; k < data.params.size(); ++k)
+                       if (data.params[k] == v.id)
+                         return args[k];
+                     return t;
+                   },
+                   [&](const TApp& a) {
+                     auto lhs = subst(a.lhs);
+                     auto rhs = subst(a.rhs);
+                     return this->type(TApp{lhs, rhs});
+                   },
+                   [&](const TFun& f) {
+                     auto from = subst(f.from);
+                     auto to   = subst(f.to);
+                     return this->type(TFun{from, to});
+                   }},
+        static_cast<const Type::variant&>(Type((*this)[t])));
+  };
+  auto out = std::vector<TypeRef>();
+  for (auto f : con.fields)
+    out.push_back(subst(f));
+  return out;
+}
+
+LitRef Program::add(const Literal& l) {
+  if (auto* s = std::get_if<std::string_view>(&l))
+    return push(this->lits, Literal(this->arena.copy(*s)));
+  if (auto* b = std::get_if<pat::BigInt>(&l)) {
+    auto* limbs = static_cast<u32*>(this->arena.alloc(b->len * 4, 4));
+    std::memcpy(limbs, b->limbs, b->len * 4);
+    return push(this->lits, Literal(pat::BigInt{limbs, b->len}));
+  }
+  return push(this->lits, l);
+}
+
+/** compaction */
+
+namespace {
+/// copies what is reachable in `from` into `to`, keeping sharing
+struct Compactor {
+  const Program& from;
+  Program& to;
+  std::vector<u32> exprs, vars, binds, alts, lits;
+
+  template <typename T>
+  Ref<T> memo(std::vector<u32>& seen, Ref<T> r, auto copy) {
+    if (!r.valid())
+      return r;
+    if (seen[r.i] == Ref<T>::NONE)
+      seen[r.i] = copy().i;
+    return Ref<T>{seen[r.i]};
+  }
+
+  VarRef var(VarRef v) {
+    return memo(this->vars, v, [&] { return this->to.add(this->from[v]); });
+  }
+  LitRef lit(LitRef l) {
+    return memo(this->lits, l, [&] {
+      this->to.lits.push_back(this->from[l]);
+      return LitRef{static_cast<u32>(this->to.lits.size() - 1)};
+    });
+  }
+  template <typename R, typename F>
+  Span list(Span s, F f) {
+    auto out = std::vector<R>();
+    for (u32 k = 0; k < s.len; ++k)
+      out.push_back(f(this->from.at<R>(s, k)));
+    return this->to.list(out);
+  }
+  Ref<Bind> bind(Ref<Bind> b) {
+    return memo(this->binds, b, [&] {
+      auto& old = this->from[b];
+      auto v    = var(old.var);
+      return this->to.add(Bind{v, expr(old.rhs)});
+    });
+  }
+  Ref<Alt> alt(Ref<Alt> a) {
+    return memo(this->alts, a, [&] {
+      auto n    = this->from[a];
+      n.lit     = lit(n.lit);
+      n.vars    = list<VarRef>(n.vars, [&](VarRef v) { return var(v); });
+      n.rhs     = expr(n.rhs);
+      return this->to.add(n);
+    });
+  }
+  ExprRef expr(ExprRef e) {
+    return memo(this->exprs, e, [&] {
+      auto ex = [&](ExprRef r) { return expr(r); };
+      auto n  = std::visit(
+          overloaded{
+              [&](EVar x) -> Expr { return EVar{var(x.var)}; },
+              [&](ELit x) -> Expr { return ELit{lit(x.lit)}; },
+              [&](ECon x) -> Expr { return x; },
+              [&](EApp x) -> Expr {
+                auto fn = expr(x.fn);
+                return EApp{fn, list<ExprRef>(x.args, ex)};
+              },
+              [&](ELam x) -> Expr {
+                auto ps = list<VarRef>(x.params,
+                                       [&](VarRef v) { return var(v); });
+                return ELam{ps, expr(x.body)};
+              },
+              [&](ELet x) -> Expr {
+                auto v   = var(x.var);
+                auto rhs = expr(x.rhs);
+                return ELet{v, rhs, expr(x.body)};
+              },
+              [&](ELetRec x) -> Expr {
+                auto bs = list<Ref<Bind>>(
+                    x.binds, [&](Ref<Bind> b) { return bind(b); });
+                return ELetRec{bs, expr(x.body)};
+              },
+              [&](ECase x) -> Expr {
+                auto scrut = expr(x.scrut);
+                auto b     = var(x.bndr);
+                return ECase{scrut, b, list<Ref<Alt>>(x.alts, [&](Ref<Alt> a) {
+                               return alt(a);
+                             })};
+              },
+              [&](ECall x) -> Expr {
+                return ECall{x.ext, list<ExprRef>(x.args, ex)};
+              },
+              [](EFail x) -> Expr { return x; }},
+          static_cast<const Expr::variant&>(this->from[e]));
+      return this->to.add(n, this->from.type_of(e), this->from.loc(e));
+    });
+  }
+};
+} // namespace
+
+void Program::compact() {
+  auto to = Program();
+  auto c  = Compactor{*this,
+                     to,
+                     std::vector<u32>(this->exprs.size(), ExprRef::NONE),
+                     std::vector<u32>(this->vars.size(), VarRef::NONE),
+                     std::vector<u32>(this->binds.size(), Ref<Bind>::NONE),
+                     std::vector<u32>(this->alts.size(), Ref<Alt>::NONE),
+                     std::vector<u32>(this->lits.size(), LitRef::NONE)};
+  auto top = std::vector<Ref<Bind>>();
+  for (auto b : this->top)
+    top.push_back(c.bind(b));
+  this->top        = std::move(top);
+  this->exprs      = std::move(to.exprs);
+  this->expr_types = std::move(to.expr_types);
+  this->expr_locs  = std::move(to.expr_locs);
+  this->vars       = std::move(to.vars);
+  this->binds      = std::move(to.binds);
+  this->alts       = std::move(to.alts);
+  this->lits       = std::move(to.lits);
+  this->refs       = std::move(to.refs);
+}
+
+/** printing */
+
+string Program::to_string(TypeRef r) const {
+  return std::visit(
+      overloaded{[](const TCon& t) { return t.id.string(); },
+                 [](const TVar& t) { return t.id.string(); },
+                 [this](const TApp& t) {
+                   return "(" + to_string(t.lhs) + " " + to_string(t.rhs) + ")";
+                 },
+                 [this](const TFun& t) {
+                   return "(" + to_string(t.from) + " -> " + to_string(t.to)
+                          + ")";
+                 }},
+      static_cast<const Type::variant&>((*this)[r]));
+}
+
+string Program::to_string(VarRef r) const {
+  return (*this)[r].name.string() + "_" + std::to_string(r.i);
+}
+
+string Program::to_string(ExprRef r) const {
+  auto args = [this](Span s) {
+    auto out = string();
+    for (u32 k = 0; k < s.len; ++k)
+      out += " " + to_string(at<ExprRef>(s, k));
+    return out;
+  };
+  return std::visit(
+      overloaded{
+          [this](const EVar& e) { return to_string(e.var); },
+          [this](const ELit& e) { return (*this)[e.lit].to_string(); },
+          [this](const ECon& e) {
+            return this->data[e.type].cons[e.tag].name.string();
+          },
+          [&](const EApp& e) {
+            return "(" + to_string(e.fn) + args(e.args) + ")";
+          },
+          [this](const ELam& e) {
+            auto s = string("(\\");
+            for (u32 k = 0; k < e.params.len; ++k) {
+              auto v = at<VarRef>(e.params, k);
+              s += (k ? " " : "") + string((*this)[v].strict ? "!" : "")
+                   + to_string(v);
+            }
+            return s + " -> " + to_string(e.body) + ")";
+          },
+          [this](const ELet& e) {
+            return "(let " + to_string(e.var) + " = " + to_string(e.rhs)
+                   + " in " + to_string(e.body) + ")";
+          },
+          [this](const ELetRec& e) {
+            auto s = string("(letrec { ");
+            for (u32 k = 0; k < e.binds.len; ++k) {
+              auto& b = (*this)[at<Ref<Bind>>(e.binds, k)];
+              s += (k ? "; " : "") + to_string(b.var) + " = "
+                   + to_string(b.rhs);
+            }
+            return s + " } in " + to_string(e.body) + ")";
+          },
+          [this](const ECase& e) {
+            auto s = "(case " + to_string(e.scrut);
+            if (e.bndr.valid())
+              s += " as " + to_string(e.bndr);
+            s += " of { ";
+            for (u32 k = 0; k < e.alts.len; ++k) {
+              auto& a = (*this)[at<Ref<Alt>>(e.alts, k)];
+              s += k ? "; " : "";
+              switch (a.kind) {
+              case Alt::Con:
+                s += this->data[a.type].cons[a.tag].name.string();
+                break;
+              case Alt::Lit: s += (*this)[a.lit].to_string(); break;
+              case Alt::Default: s += "_"; break;
+              }
+              for (u32 v = 0; v < a.vars.len; ++v)
+                s += " " + to_string(at<VarRef>(a.vars, v));
+              s += " -> " + to_string(a.rhs);
+            }
+            return s + " })";
+          },
+          [&](const ECall& e) {
+            return "(@" + this->externs[e.ext].name.string() + args(e.args)
+                   + ")";
+          },
+          [](const EFail&) { return string("fail"); }},
+      static_cast<const Expr::variant&>((*this)[r]));
+}
+
+string Program::to_string() const {
+  auto s = string();
+  for (auto b : this->top)
+    s += to_string((*this)[b].var) + " = " + to_string((*this)[b].rhs) + "\n";
+  return s;
+}
+
+} // namespace mangekyou::core
@@ -0,0 +1,280 @@
+#pragma once
+#include <arena.hpp>
+#include <prelude.hpp>
+#include <string_view>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+#include "match.hpp"
+#include "name.hpp"
+#include "pats.hpp"
+
+/** Core, the typed intermediate language every pass after the front end
+ * works on: variables, literals, constructors, applications, lambdas,
+ * `let`/`letrec`, `case` with flat alternatives and saturated `extern`
+ * calls. patterns are gone, compiled to nested `case`s.
+ *
+ * like the AST, nodes live in the pools of their `Program` and refer to
+ * each other with 32-bit `Ref`s, children lists are `Span`s of
+ * `Program::refs`. a rewrite adds new nodes and leaves the old ones
+ * unreachable, `compact` drops those once a pass is done. types are
+ * hash-consed: equal types have equal `TypeRef`s.
+ *
+ * every variable is bound once: no two binders share a `VarRef`, so a
+ * variable can be substituted without checking for capture.
+ *
+ * `Int`, `Char`, `Float` and `Double` are primitive type constructors out
+ * of the desugarer; `represent` (prim.hpp) makes them boxes around the
+ * unboxed machine types `Int#`, `Char#`, `Float#` and `Double#`.
+ */
+namespace mangekyou::core {
+
+using name::Id;
+using pat::Literal;
+
+struct Type;
+struct Var;
+struct Expr;
+struct Bind;
+struct Alt;
+using TypeRef = Ref<Type>;
+using VarRef  = Ref<Var>;
+using ExprRef = Ref<Expr>;
+using LitRef  = Ref<Literal>;
+
+/** Types */
+/// a named type: a data type, a primitive or a tuple `(,)`
+struct TCon {
+  Id id;
+};
+/// a type variable of a signature, or `?n` when not known yet
+struct TVar {
+  Id id;
+};
+struct TApp {
+  TypeRef lhs;
+  TypeRef rhs;
+};
+struct TFun {
+  TypeRef from;
+  TypeRef to;
+};
+
+struct Type : std::variant<TCon, TVar, TApp, TFun> {
+  using variant::variant;
+
+  template <typename T>
+  bool is() const {
+    return std::holds_alternative<T>(*this);
+  }
+  bool operator==(const Type& other) const;
+};
+
+struct TypeHash {
+  usize operator()(const Type& t) const;
+};
+
+/** Variables */
+struct Var {
+  /// the source name, for printing; `VarRef`s tell variables apart
+  Id name;
+  TypeRef ty;
+  /// certainly evaluated: a parameter by its function's body, a `case`
+  /// binder always. strict parameters print as `!x_3`
+  bool strict = false;
+};
+
+/** Expressions */
+struct EVar {
+  VarRef var;
+};
+struct ELit {
+  LitRef lit;
+};
+/// constructor `tag` of `Program::data[type]`, applied with `EApp`
+struct ECon {
+  u32 type;
+  u32 tag;
+};
+/// `args` are `ExprRef`s, never empty
+struct EApp {
+  ExprRef fn;
+  Span args;
+};
+/// `params` are `VarRef`s, never empty
+struct ELam {
+  Span params;
+  ExprRef body;
+};
+/// non-recursive: `var` is not in scope in `rhs`
+struct ELet {
+  VarRef var;
+  ExprRef rhs;
+  ExprRef body;
+};
+/// `binds` are `Ref<Bind>`s, all in scope in every right-hand side
+struct ELetRec {
+  Span binds;
+  ExprRef body;
+};
+/// evaluate `scrut`, name its value `bndr` (may be invalid) and continue
+/// with the first matching alternative, `alts` are `Ref<Alt>`s
+struct ECase {
+  ExprRef scrut;
+  VarRef bndr;
+  Span alts;
+};
+/// `Program::externs[ext]` applied to exactly its arity of `args`
+struct ECall {
+  u32 ext;
+  Span args;
+};
+/// no pattern matched
+struct EFail {};
+
+struct Expr : std::variant<EVar, ELit, ECon, EApp, ELam, ELet, ELetRec, ECase,
+                           ECall, EFail> {
+  using variant::variant;
+
+  template <typename T>
+  bool is() const {
+    return std::holds_alternative<T>(*this);
+  }
+};
+
+struct Bind {
+  VarRef var;
+  ExprRef rhs;
+};
+
+/// `Con v1 .. vn -> rhs`, `lit -> rhs` or `_ -> rhs`, `vars` are `VarRef`s.
+/// `type` and `tag` name the constructor as in `ECon`
+struct Alt {
+  enum Kind : u8 { Con, Lit, Default };
+
+  Kind kind;
+  u32 type;
+  u32 tag;
+  LitRef lit;
+  Span vars;
+  ExprRef rhs;
+};
+
+struct DataCon {
+  Id name;
+  /// in terms of `DataType::params`
+  std::vector<TypeRef> fields;
+};
+struct DataType {
+  Id name;
+  std::vector<Id> params;
+  std::vector<DataCon> cons;
+};
+
+struct Extern {
+  Id name;
+  TypeRef ty;
+  /// the number of arrows of `ty`
+  u32 arity;
+};
+
+struct Program {
+  /// top-level bindings, one recursive group
+  std::vector<Ref<Bind>> top;
+  std::vector<DataType> data;
+  std::vector<Extern> externs;
+  /// the same types as `data`, numbered the same, for the match compiler
+  pat::ConEnv env;
+
+  std::vector<Expr> exprs;
+  /// the type of each expression, parallel to `exprs`
+  std::vector<TypeRef> expr_types;
+  /// where each expression comes from, parallel to `exprs`: set by the
+  /// desugarer, invalid for the nodes a later pass builds
+  std::vector<parse::SourceLoc> expr_locs;
+  std::vector<Type> types;
+  std::vector<Var> vars;
+  std::vector<Bind> binds;
+  std::vector<Alt> alts;
+  std::vector<Literal> lits;
+  std::vector<u32> refs;
+  /// string literals and big integer limbs
+  Arena arena;
+
+  Program() = default;
+  Program(Program&&) = default;
+  Program& operator=(Program&&) = default;
+
+  ExprRef add(const Expr& e, TypeRef ty, parse::SourceLoc at = {}) {
+    this->expr_types.push_back(ty);
+    this->expr_locs.push_back(at);
+    return push(this->exprs, e);
+  }
+  VarRef add(const Var& v) { return push(this->vars, v); }
+  Ref<Bind> add(const Bind& b) { return push(this->binds, b); }
+  Ref<Alt> add(const Alt& a) { return push(this->alts, a); }
+  /// copies the literal's string or limbs into `arena`
+  LitRef add(const Literal& l);
+  /// the one ref of `t`
+  TypeRef type(const Type& t);
+  /// a type not known yet, `?n`
+  TypeRef fresh_type();
+  /// `e` becomes what `by` is, keeping its type: a rewrite in place
+  void replace(ExprRef e, ExprRef by) {
+    this->exprs[e.i] = Expr(this->exprs[by.i]);
+  }
+  /// a new variable named like `v`, of the same type
+  VarRef clone(VarRef v) { return add(Var(this->vars[v.i])); }
+
+  /// copy `refs` into the list pool
+  template <typename R>
+  Span list(const std::vector<R>& refs) {
+    auto s = Span{static_cast<u32>(this->refs.size()),
+                  static_cast<u32>(refs.size())};
+    for (auto r : refs)
+      this->refs.push_back(r.i);
+    return s;
+  }
+  template <typename R>
+  R at(Span s, u32 k) const {
+    return R{this->refs[s.start + k]};
+  }
+
+  const Expr& operator[](ExprRef r) const { return this->exprs[r.i]; }
+  const Type& operator[](TypeRef r) const { return this->types[r.i]; }
+  const Var& operator[](VarRef r) const { return this->vars[r.i]; }
+  const Bind& operator[](Ref<Bind> r) const { return this->binds[r.i]; }
+  const Alt& operator[](Ref<Alt> r) const { return this->alts[r.i]; }
+  const Literal& operator[](LitRef r) const { return this->lits[r.i]; }
+  TypeRef type_of(ExprRef r) const { return this->expr_types[r.i]; }
+  parse::SourceLoc loc(ExprRef r) const { return this->expr_locs[r.i]; }
+
+  /// `ty` after `n` arguments, a fresh type past its arrows
+  TypeRef result(TypeRef ty, u32 n);
+  /// the field types of constructor `tag` of `data[type]` at the type `ty`
+  /// of a value of it, substituting the data type's parameters
+  std::vector<TypeRef> fields(u32 type, u32 tag, TypeRef ty);
+
+  /// keep only the nodes reachable from `top`, renumbered in one copy
+  void compact();
+
+  string to_string(TypeRef r) const;
+  /// `x_3` for variable 3 named `x`
+  string to_string(VarRef r) const;
+  string to_string(ExprRef r) const;
+  /// `f_0 = ...` for every top-level binding, one per line
+  string to_string() const;
+
+private:
+  std::unordered_map<Type, TypeRef, TypeHash> interned;
+  u32 metas = 0;
+
+  template <typename T>
+  static Ref<T> push(std::vector<T>& pool, const T& v) {
+    pool.push_back(v);
+    return Ref<T>{static_cast<u32>(pool.size() - 1)};
+  }
+};
+
+} // namespace mangekyou::core
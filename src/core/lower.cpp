@@ -0,0 +1,100 @@
+#include "lower.hpp"
+
+#include <algorithm>
+
+namespace mangekyou::pat {
+
+option<u64> key(const ast::Module& m, const Case& c) {
+  if (c.tag != Case::NO_TAG)
+    return c.tag;
+  auto& lit = m[c.lit];
+  if (auto* n = std::get_if<u64>(&lit))
+    return *n;
+  if (auto* ch = std::get_if<char>(&lit))
+    return static_cast<u8>(*ch);
+  return {};
+}
+
+/// where the key of `c` comes from: tags, or one kind of literal
+static usize key_space(const ast::Module& m, const Case& c) {
+  return c.tag != Case::NO_TAG ? 0 : m[c.lit].index() + 1;
+}
+
+Dispatch lower(const DecisionTree& t, const ast::Module& m, const Switch& sw) {
+  auto d = Dispatch();
+  for (u32 k = 0; k < sw.cases.len; ++k) {
+    auto& c = t.at(sw.cases, k);
+    auto n  = key(m, c);
+    // `'a'` and `97` have the same key
+    if (!n || key_space(m, c) != key_space(m, t.at(sw.cases, 0))) {
+      d.keys.clear();
+      return d;
+    }
+    d.keys.push_back(*n);
+  }
+  if (sw.cases.len <= Dispatch::MAX_CHAIN)
+    return d;
+
+  // the cases of a switch have distinct keys
+  auto lo    = *std::min_element(d.keys.begin(), d.keys.end());
+  auto hi    = *std::max_element(d.keys.begin(), d.keys.end());
+  // `hi - lo + 1` wraps when the keys span every u64
+  if (hi - lo < Dispatch::MAX_TABLE
+      && sw.cases.len * 100 >= (hi - lo + 1) * Dispatch::MIN_DENSITY) {
+    auto slots = hi - lo + 1;
+    d.kind  = Dispatch::Table;
+    d.lo    = lo;
+    d.table = std::vector<u32>(slots, Dispatch::NO_CASE);
+    for (u32 k = 0; k < sw.cases.len; ++k)
+      d.table[d.keys[k] - lo] = k;
+    d.keys.clear();
+    return d;
+  }
+
+  d.kind  = Dispatch::Search;
+  d.cases = std::vector<u32>(sw.cases.len);
+  for (u32 k = 0; k < sw.cases.len; ++k)
+    d.cases[k] = k;
+  std::sort(d.cases.begin(), d.cases.end(),
+            [&](u32 a, u32 b) { return d.keys[a] < d.keys[b]; });
+  auto sorted = std::vector<u64>(sw.cases.len);
+  for (u32 k = 0; k < sw.cases.len; ++k)
+    sorted[k] = d.keys[d.cases[k]];
+  d.keys = std::move(sorted);
+  return d;
+}
+
+std::vector<Dispatch> lower(const DecisionTree& t, const ast::Module& m) {
+  auto out = std::vector<Dispatch>();
+  out.reserve(t.nodes.size());
+  for (auto& node : t.nodes) {
+    auto* sw = std::get_if<Switch>(&node);
+    out.push_back(sw ? lower(t, m, *sw) : Dispatch());
+  }
+  return out;
+}
+
+DRef Dispatch::target(const DecisionTree& t, const Switch& sw,
+                      u64 key) const {
+  auto k = NO_CASE;
+  switch (this->kind) {
+  case Chain:
+    for (u32 i = 0; i < this->keys.size() && k == NO_CASE; ++i)
+      if (this->keys[i] == key)
+        k = i;
+    break;
+  case Table:
+    if (key >= this->lo && key - this->lo < this->table.size())
+      k = this->table[key - this->lo];
+    break;
+  case Search: {
+    auto it = std::lower_bound(this->keys.begin(), this->keys.end(), key);
+    if (it != this->keys.end() && *it == key)
+      k = this->cases[it - this->keys.begin()];
+    break;
+  }
+  }
+  return k == NO_CASE ? sw.fallback : t.at(sw.cases, k).next;
+}
+
+} // namespace mangekyou::pat
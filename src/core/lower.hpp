@@ -0,0 +1,57 @@
+#pragma once
+#include <prelude.hpp>
+#include <vector>
+
+#include "match.hpp"
+
+/** how the `Switch`es of a decision tree dispatch, chosen by the density of
+ * their keys. constructor switches are keyed by tag, literal switches by the
+ * value of their `Integer` or `Char` literals; other literals (strings,
+ * floats, big integers) always compare one after the other, and so do the
+ * cases of a switch mixing integers and characters, whose keys overlap.
+ *
+ * few cases compare in order, dense keys index a jump table and sparse ones
+ * are found by binary search over the sorted keys.
+ */
+namespace mangekyou::pat {
+
+struct Dispatch {
+  enum Kind : u8 {
+    /// compare against each case in turn, `keys` are in case order when
+    /// the switch has keys
+    Chain,
+    /// `table[key - lo]` is the case, `NO_CASE` for the fallback
+    Table,
+    /// binary search of `keys`, `cases[k]` goes with `keys[k]`
+    Search,
+  };
+  static constexpr u32 NO_CASE = ~u32(0);
+  /// at most this many cases are compared in turn
+  static constexpr u32 MAX_CHAIN = 3;
+  /// a table needs at least this many cases per 100 slots...
+  static constexpr u32 MIN_DENSITY = 40;
+  /// ...and at most this many slots
+  static constexpr u32 MAX_TABLE = 4096;
+
+  Kind kind = Chain;
+  u64 lo = 0;
+  std::vector<u32> table;
+  std::vector<u64> keys;
+  std::vector<u32> cases;
+
+  /// the node `sw` continues with when its occurrence has key `key`, for
+  /// switches with keys
+  DRef target(const DecisionTree& t, const Switch& sw, u64 key) const;
+};
+
+/// the key of case `c` of a switch, none when it is not an integer, a
+/// character or a constructor
+option<u64> key(const ast::Module& m, const Case& c);
+
+Dispatch lower(const DecisionTree& t, const ast::Module& m, const Switch& sw);
+
+/// the dispatch of every node of `t`, indexed like `t.nodes`: nodes other
+/// than switches get an empty `Chain`
+std::vector<Dispatch> lower(const DecisionTree& t, const ast::Module& m);
+
+} // namespace mangekyou::pat
@@ -0,0 +1,405 @@
+#include "match.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace mangekyou::pat {
+
+/** constructors */
+
+void ConEnv::declare(const DataInfo& d) {
+  auto type = static_cast<u32>(this->types.size());
+  this->types.push_back(d);
+  for (u32 tag = 0; tag < d.cons.size(); ++tag)
+    this->cons.insert_or_assign(d.cons[tag], ConInfo{type, tag, d.arity[tag]});
+}
+
+ConEnv ConEnv::collect(const ast::Module& m) {
+  auto env = ConEnv();
+  for (auto& item : m.decls) {
+    auto* data = std::get_if<ast::DataDecl>(&item);
+    if (!data)
+      continue;
+    auto info = DataInfo{data->id, {}, {}};
+    for (u32 k = 0; k < data->cons.len; ++k) {
+      auto& con = m[m.at<Ref<ast::DataCon>>(data->cons, k)];
+      info.cons.push_back(con.id);
+      info.arity.push_back(con.args.len);
+    }
+    env.declare(info);
+  }
+  return env;
+}
+
+const ConInfo* ConEnv::lookup(const Id& con) {
+  auto it = this->cons.find(con);
+  if (it != this->cons.end())
+    return &it->second;
+  // `()`, `(,)`, `(,,)`, ...
+  auto s = con.string();
+  if (s.size() < 2 || s.front() != '(' || s.back() != ')'
+      || s.find_first_not_of(',', 1) != s.size() - 1)
+    return nullptr;
+  auto arity = s.size() == 2 ? 0u : static_cast<u32>(s.size() - 1);
+  declare(DataInfo{con, {con}, {arity}});
+  return &this->cons.at(con);
+}
+
+bool same(const Literal& a, const Literal& b) {
+  if (a.index() != b.index())
+    return false;
+  return std::visit(
+      overloaded{[&](const BigInt& x) {
+                   auto& y = std::get<BigInt>(b);
+                   return x.len == y.len
+                          && std::memcmp(x.limbs, y.limbs, x.len * 4) == 0;
+                 },
+                 [&](const auto& x) {
+                   return x == std::get<std::decay_t<decltype(x)>>(b);
+                 }},
+      static_cast<const Literal::variant&>(a));
+}
+
+/** compilation */
+
+namespace {
+/// a clause being matched: `cols[j]` is matched against occurrence `j` of
+/// the current matrix, an invalid ref is a wildcard
+struct Row {
+  std::vector<PatRef> cols;
+  u32 clause;
+  std::vector<Binding> binds;
+};
+
+struct Compiler {
+  const ast::Module& m;
+  ConEnv& env;
+  DecisionTree& out;
+  DRef fail;
+  /// (parent, field) to occurrence, so both sides of a branch agree
+  std::unordered_map<u64, OccRef> children;
+
+  DRef add(const DNode& n) {
+    this->out.nodes.push_back(n);
+    return DRef{static_cast<u32>(this->out.nodes.size() - 1)};
+  }
+
+  OccRef child(OccRef parent, u32 field) {
+    auto key = (u64(parent.i) << 32) | field;
+    auto it  = this->children.find(key);
+    if (it != this->children.end())
+      return it->second;
+    this->out.occs.push_back(Occurrence{parent, field});
+    auto occ = OccRef{static_cast<u32>(this->out.occs.size() - 1)};
+    this->children.emplace(key, occ);
+    return occ;
+  }
+
+  tl::unexpected<MatchError> error(PatRef p, string msg) const {
+    return tl::make_unexpected(MatchError{this->m.loc(p), std::move(msg)});
+  }
+
+  /// variables and as-patterns bind their occurrence and become wildcards
+  void simplify(Row& r, const std::vector<OccRef>& occs) const {
+    for (usize j = 0; j < r.cols.size(); ++j) {
+      while (r.cols[j].valid()) {
+        auto& p = this->m[r.cols[j]];
+        if (auto* v = std::get_if<PVar>(&p)) {
+          r.binds.push_back(Binding{v->id, occs[j]});
+          r.cols[j] = PatRef();
+        } else if (auto* as = std::get_if<PAs>(&p)) {
+          r.binds.push_back(Binding{as->id, occs[j]});
+          r.cols[j] = as->pat;
+        } else if (p.is<PWildcard>()) {
+          r.cols[j] = PatRef();
+        } else {
+          break;
+        }
+      }
+    }
+  }
+
+  /// the column to switch on: refutable in the first row, and then in as
+  /// many of the following rows as possible (the "needed prefix" heuristic)
+  static option<usize> pick(const std::vector<Row>& rows) {
+    auto best  = option<usize>();
+    usize most = 0;
+    for (usize j = 0; j < rows[0].cols.size(); ++j) {
+      usize n = 0;
+      while (n < rows.size() && rows[n].cols[j].valid())
+        ++n;
+      if (n > most) {
+        best = j;
+        most = n;
+      }
+    }
+    return best;
+  }
+
+  MResult<DRef> compile(const std::vector<OccRef>& occs,
+                        std::vector<Row> rows);
+};
+
+/// a constructor or literal heading column `j`
+struct Head {
+  u32 tag;
+  PatRef lit;
+  u32 arity;
+};
+
+template <typename T>
+static std::vector<T> without(const std::vector<T>& v, usize j) {
+  auto out = std::vector<T>();
+  out.reserve(v.size() - 1);
+  out.insert(out.end(), v.begin(), v.begin() + j);
+  out.insert(out.end(), v.begin() + j + 1, v.end());
+  return out;
+}
+
+MResult<DRef> Compiler::compile(const std::vector<OccRef>& occs,
+                                std::vector<Row> rows) {
+  if (rows.empty())
+    return this->fail;
+  for (auto& r : rows)
+    simplify(r, occs);
+  auto col = pick(rows);
+  if (!col) {
+    auto& top  = rows[0];
+    auto binds = Span{static_cast<u32>(this->out.binds.size()),
+                      static_cast<u32>(top.binds.size())};
+    this->out.binds.insert(this->out.binds.end(), top.binds.begin(),
+                           top.binds.end());
+    return add(Leaf{top.clause, binds});
+  }
+  auto j = *col;
+
+  // the heads of column `j`, in order of first appearance
+  auto heads = std::vector<Head>();
+  auto seen  = std::vector<bool>();
+  auto type  = option<u32>();
+  bool lits  = false;
+  for (auto& r : rows) {
+    auto p = r.cols[j];
+    if (!p.valid())
+      continue;
+    if (auto* lit = std::get_if<PLit>(&this->m[p])) {
+      if (type)
+        return error(p, "literal pattern among constructor patterns");
+      lits = true;
+      auto dup = std::any_of(heads.begin(), heads.end(), [&](const Head& h) {
+        return same(this->m[std::get<PLit>(this->m[h.lit]).lit],
+                    this->m[lit->lit]);
+      });
+      if (!dup)
+        heads.push_back(Head{Case::NO_TAG, p, 0});
+      continue;
+    }
+    auto& con  = std::get<PCon>(this->m[p]);
+    auto* info = this->env.lookup(con.con);
+    if (!info)
+      return error(p, "unknown constructor `" + con.con.string() + "`");
+    if (info->arity != con.args.len)
+      return error(p, "constructor `" + con.con.string() + "` takes "
+                          + std::to_string(info->arity) + " arguments");
+    if (lits || (type && *type != info->type))
+      return error(p, "`" + con.con.string() + "` does not belong to type `"
+                          + (lits ? string("literal")
+                                  : this->env.types[*type].name.string())
+                          + "`");
+    if (!type) {
+      type = info->type;
+      seen.resize(this->env.types[*type].cons.size());
+    }
+    if (!seen[info->tag]) {
+      seen[info->tag] = true;
+      heads.push_back(Head{info->tag, PatRef(), info->arity});
+    }
+  }
+
+  auto rest  = without(occs, j);
+  auto cases = std::vector<Case>();
+  cases.reserve(heads.size());
+  for (auto& h : heads) {
+    // sub-values first: the next test is most likely on them
+    auto sub = std::vector<OccRef>();
+    for (u32 f = 0; f < h.arity; ++f)
+      sub.push_back(child(occs[j], f));
+    sub.insert(sub.end(), rest.begin(), rest.end());
+
+    auto spec = std::vector<Row>();
+    for (auto& r : rows) {
+      auto p    = r.cols[j];
+      auto cols = std::vector<PatRef>(h.arity);
+      if (p.valid()) {
+        auto& node = this->m[p];
+        if (h.tag == Case::NO_TAG) {
+          auto& lit = std::get<PLit>(node).lit;
+          if (!same(this->m[lit], this->m[std::get<PLit>(this->m[h.lit]).lit]))
+            continue;
+        } else {
+          auto& con = std::get<PCon>(node);
+          if (this->env.lookup(con.con)->tag != h.tag)
+            continue;
+          for (u32 f = 0; f < h.arity; ++f)
+            cols[f] = this->m.at<PatRef>(con.args, f);
+        }
+      }
+      auto others = without(r.cols, j);
+      cols.insert(cols.end(), others.begin(), others.end());
+      spec.push_back(Row{std::move(cols), r.clause, r.binds});
+    }
+    auto next = compile(sub, std::move(spec));
+    if (!next)
+      return tl::make_unexpected(std::move(next.error()));
+    auto lit = h.tag == Case::NO_TAG ? std::get<PLit>(this->m[h.lit]).lit
+                                     : ast::LitRef();
+    cases.push_back(Case{h.tag, lit, *next});
+  }
+
+  auto fallback = DRef();
+  bool complete = type && heads.size() == seen.size();
+  if (!complete) {
+    auto defaults = std::vector<Row>();
+    for (auto& r : rows)
+      if (!r.cols[j].valid())
+        defaults.push_back(Row{without(r.cols, j), r.clause, r.binds});
+    auto next = compile(rest, std::move(defaults));
+    if (!next)
+      return tl::make_unexpected(std::move(next.error()));
+    fallback = *next;
+  }
+
+  auto span = Span{static_cast<u32>(this->out.cases.size()),
+                   static_cast<u32>(cases.size())};
+  this->out.cases.insert(this->out.cases.end(), cases.begin(), cases.end());
+  return add(Switch{occs[j], type ? *type : Switch::NO_TYPE, span, fallback});
+}
+
+MResult<DecisionTree> run(const ast::Module& m, ConEnv& env, u32 arity,
+                          std::vector<Row> rows) {
+  auto tree  = DecisionTree{};
+  tree.arity = arity;
+  auto c     = Compiler{m, env, tree, DRef(), {}};
+  c.fail     = c.add(Fail{});
+  auto occs  = std::vector<OccRef>();
+  for (u32 k = 0; k < arity; ++k) {
+    tree.occs.push_back(Occurrence{OccRef(), k});
+    occs.push_back(OccRef{k});
+  }
+  auto root = c.compile(occs, std::move(rows));
+  if (!root)
+    return tl::make_unexpected(std::move(root.error()));
+  tree.root = *root;
+  return tree;
+}
+} // namespace
+
+MResult<DecisionTree> compile(const ast::Module& m, ConEnv& env,
+                              const ast::ECase& e) {
+  auto rows = std::vector<Row>();
+  for (u32 k = 0; k < e.alts.len; ++k) {
+    auto& alt = m[m.at<Ref<ast::Alt>>(e.alts, k)];
+    rows.push_back(Row{{alt.pat}, k, {}});
+  }
+  return run(m, env, 1, std::move(rows));
+}
+
+MResult<DecisionTree> compile(const ast::Module& m, ConEnv& env, PatRef p) {
+  auto rows = std::vector<Row>();
+  rows.push_back(Row{{p}, 0, {}});
+  return run(m, env, 1, std::move(rows));
+}
+MResult<DecisionTree> compile(const ast::Module& m, ConEnv& env,
+                              const std::vector<ast::ItemRef>& items,
+                              usize first) {
+  auto cs = clause_rows(m, items, first);
+  if (!cs)
+    return tl::make_unexpected(std::move(cs.error()));
+  auto arity = cs->empty() ? 0 : static_cast<u32>((*cs)[0].size());
+  auto rows  = std::vector<Row>();
+  for (u32 k = 0; k < cs->size(); ++k)
+    rows.push_back(Row{std::move((*cs)[k]), k, {}});
+  return run(m, env, arity, std::move(rows));
+}
+
+std::vector<Span> clauses(const ast::Module& m,
+                          const std::vector<ast::ItemRef>& items,
+                          usize first) {
+  auto out = std::vector<Span>();
+  auto* fn = std::get_if<ast::FnDecl>(&m[items[first]]);
+  if (!fn)
+    return out;
+  auto id = fn->id;
+  for (auto i = first; i < items.size(); ++i) {
+    fn = std::get_if<ast::FnDecl>(&m[items[i]]);
+    if (!fn || fn->id != id)
+      break;
+    out.push_back(fn->params);
+  }
+  return out;
+}
+
+MResult<std::vector<std::vector<PatRef>>>
+clause_rows(const ast::Module& m, const std::vector<ast::ItemRef>& items,
+            usize first) {
+  auto cs    = clauses(m, items, first);
+  auto arity = cs.empty() ? 0 : cs[0].len;
+  auto rows  = std::vector<std::vector<PatRef>>();
+  for (u32 k = 0; k < cs.size(); ++k) {
+    auto& c = cs[k];
+    if (c.len != arity)
+      return tl::make_unexpected(MatchError{
+          m.loc(items[first + k]),
+          "clauses with " + std::to_string(arity) + " and "
+              + std::to_string(c.len) + " parameters"});
+    auto& row = rows.emplace_back();
+    for (u32 f = 0; f < c.len; ++f)
+      row.push_back(m.at<PatRef>(c, f));
+  }
+  return rows;
+}
+
+/** printing */
+
+static string occ_name(const DecisionTree& t, OccRef o) {
+  auto& occ = t[o];
+  if (!occ.parent.valid())
+    return "$" + std::to_string(occ.field);
+  return occ_name(t, occ.parent) + "." + std::to_string(occ.field);
+}
+
+static string print(const DecisionTree& t, const ast::Module& m,
+                    const ConEnv& env, DRef r) {
+  return std::visit(
+      overloaded{
+          [&](const Leaf& l) {
+            auto s = "#" + std::to_string(l.clause);
+            for (u32 k = 0; k < l.binds.len; ++k) {
+              auto& b = t.binds[l.binds.start + k];
+              s += (k ? ", " : " {") + b.id.string() + "=" + occ_name(t, b.occ);
+            }
+            return l.binds.len ? s + "}" : s;
+          },
+          [](const Fail&) { return string("fail"); },
+          [&](const Switch& sw) {
+            auto s = "(" + occ_name(t, sw.occ) + " ";
+            for (u32 k = 0; k < sw.cases.len; ++k) {
+              auto& c = t.at(sw.cases, k);
+              s += k ? "; " : "{ ";
+              s += c.tag == Case::NO_TAG
+                       ? m[c.lit].to_string()
+                       : env.types[sw.type].cons[c.tag].string();
+              s += ": " + print(t, m, env, c.next);
+            }
+            if (sw.fallback.valid())
+              s += "; _: " + print(t, m, env, sw.fallback);
+            return s + " })";
+          }},
+      static_cast<const DNode::variant&>(t[r]));
+}
+
+string DecisionTree::to_string(const ast::Module& m, const ConEnv& env) const {
+  return print(*this, m, env, this->root);
+}
+
+} // namespace mangekyou::pat
@@ -0,0 +1,154 @@
+#pragma once
+#include <arena.hpp>
+#include <expected>
+#include <prelude.hpp>
+#include <unordered_map>
+#include <vector>
+
+#include "name.hpp"
+#include "parse/ast.hpp"
+#include "pats.hpp"
+
+/** pattern matching, compiled to decision trees (Maranget, "Compiling
+ * Pattern Matching to Good Decision Trees", 2008).
+ * the clauses of a `case` or of a multi-clause function form a matrix, one
+ * row per clause and one column per scrutinee. the compiler repeatedly picks
+ * a column, switches on the constructor at that position and specialises the
+ * matrix for every branch. a position is removed from the matrix once it is
+ * switched on, so every path tests each sub-value at most once.
+ */
+namespace mangekyou::pat {
+
+/// a data type: constructor tags are indices into `cons`
+struct DataInfo {
+  Id name;
+  std::vector<Id> cons;
+  std::vector<u32> arity;
+};
+
+struct ConInfo {
+  /// index in `ConEnv::types`
+  u32 type;
+  u32 tag;
+  u32 arity;
+};
+
+/// the constructors in scope, keyed by name
+struct ConEnv {
+  std::vector<DataInfo> types;
+  std::unordered_map<Id, ConInfo> cons;
+
+  /// the `data` declarations of `m`, top level and nested
+  static ConEnv collect(const ast::Module& m);
+  void declare(const DataInfo& d);
+  /// tuples `(,)`, `(,,)`, ... are declared the first time they are seen
+  const ConInfo* lookup(const Id& con);
+};
+
+struct MatchError {
+  parse::SourceLoc at;
+  string message;
+};
+
+template <typename T>
+using MResult = tl::expected<T, MatchError>;
+
+/// a sub-value of the scrutinees: field `field` of `parent`, or scrutinee
+/// `field` when `parent` is invalid
+struct Occurrence {
+  Ref<Occurrence> parent;
+  u32 field;
+};
+using OccRef = Ref<Occurrence>;
+
+struct Binding {
+  Id id;
+  OccRef occ;
+};
+
+struct DNode;
+using DRef = Ref<DNode>;
+
+/// one branch of a `Switch`: a constructor (by tag) or a literal
+struct Case {
+  /// the `tag` of a literal case
+  static constexpr u32 NO_TAG = ~u32(0);
+
+  u32 tag;
+  ast::LitRef lit;
+  DRef next;
+};
+
+/// clause `clause` matched, `binds` are `Binding`s
+struct Leaf {
+  u32 clause;
+  Span binds;
+};
+/// no clause matches
+struct Fail {};
+/// test `occ` and continue with the matching case, or `fallback` (which is
+/// invalid when the cases are exhaustive). `type` indexes `ConEnv::types`,
+/// and is `NO_TYPE` when switching on literals
+struct Switch {
+  static constexpr u32 NO_TYPE = ~u32(0);
+
+  OccRef occ;
+  u32 type;
+  Span cases;
+  DRef fallback;
+};
+
+struct DNode : std::variant<Leaf, Fail, Switch> {
+  using variant::variant;
+
+  template <typename T>
+  bool is() const {
+    return std::holds_alternative<T>(*this);
+  }
+};
+
+/// pools like `ast::Module`'s: `Switch::cases` index `cases`,
+/// `Leaf::binds` index `binds`
+struct DecisionTree {
+  DRef root;
+  /// the scrutinees are the first `arity` occurrences
+  u32 arity;
+  std::vector<DNode> nodes;
+  std::vector<Case> cases;
+  std::vector<Binding> binds;
+  std::vector<Occurrence> occs;
+
+  const DNode& operator[](DRef r) const { return this->nodes[r.i]; }
+  const Occurrence& operator[](OccRef r) const { return this->occs[r.i]; }
+  const Case& at(Span s, u32 k) const { return this->cases[s.start + k]; }
+
+  /// `switch`/`leaf`/`fail`, with constructor names from `env`
+  string to_string(const ast::Module& m, const ConEnv& env) const;
+};
+
+/// the alternatives of `e`, one scrutinee
+MResult<DecisionTree> compile(const ast::Module& m, ConEnv& env,
+                              const ast::ECase& e);
+/// the one pattern of a lambda
+MResult<DecisionTree> compile(const ast::Module& m, ConEnv& env, PatRef p);
+/// the clauses of the function defined from `items[first]`, as found by
+/// `clause_rows`
+MResult<DecisionTree> compile(const ast::Module& m, ConEnv& env,
+                              const std::vector<ast::ItemRef>& items,
+                              usize first);
+
+/// the consecutive `FnDecl`s of `m.items` defining the same function as
+/// `items[first]`, each a `Span` of `PatRef` parameters
+std::vector<Span> clauses(const ast::Module& m,
+                          const std::vector<ast::ItemRef>& items,
+                          usize first);
+/// the parameters of each of `clauses`, failing at the item of the first
+/// clause whose arity differs from the first one's
+MResult<std::vector<std::vector<PatRef>>>
+clause_rows(const ast::Module& m, const std::vector<ast::ItemRef>& items,
+            usize first);
+
+/// literal equality, the way a `Switch` tells its cases apart
+bool same(const Literal& a, const Literal& b);
+
+} // namespace mangekyou::pat
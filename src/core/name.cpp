@@ -1,5 +1,12 @@
 #include "name.hpp"
 
 namespace mangekyou::name {
-  FastString::table_type FastString::s_table = FastString::table_type{};
+  FastString::table_type& FastString::s_table() {
+    static auto table = table_type{};
+    return table;
+  }
+  std::shared_mutex& FastString::s_lock() {
+    static auto lock = std::shared_mutex();
+    return lock;
+  }
 }
@@ -1,30 +1,61 @@
 #pragma once
 #include <prelude.hpp>
+#include <mutex>
+#include <shared_mutex>
 #include <unordered_map>
 #include <string>
+#include <string_view>
 #include <iostream>
 
 namespace mangekyou::name {
 
+/// lets `s_table` be probed with a `string_view` without building a string
+struct StringHash {
+  using is_transparent = void;
+  usize operator()(std::string_view s) const {
+    return std::hash<std::string_view>{}(s);
+  }
+};
+
 struct FastString {
-  using table_type = std::unordered_map<std::string, std::string*>;
-  static table_type s_table;
+  using table_type = std::unordered_map<std::string, std::string*, StringHash,
+                                        std::equal_to<>>;
+  /// built on first use, so names can be interned by static initialisers
+  /// in other files (e.g. the primitive `Type`s)
+  static table_type& s_table();
+  /// modules may be parsed on several threads: lookups share the lock, only
+  /// the first sighting of a string takes it exclusively
+  static std::shared_mutex& s_lock();
 
   table_type::mapped_type str;
 
   FastString(const FastString& other)
       : str(other.str) {}
-  explicit FastString(const char* str) {
-    auto& ref = s_table[str];
-    if (!ref)
-      ref = new std::string(str);
-    this->str = ref;
+  FastString& operator=(const FastString&) = default;
+  explicit FastString(const char* str)
+      : FastString(std::string_view(str)) {}
+  explicit FastString(const std::string& str)
+      : FastString(std::string_view(str)) {}
+  /// only allocates the first time `str` is seen
+  explicit FastString(std::string_view str) {
+    {
+      auto lock = std::shared_lock(s_lock());
+      auto it   = s_table().find(str);
+      if (it != s_table().end()) {
+        this->str = it->second;
+        return;
+      }
+    }
+    auto lock = std::unique_lock(s_lock());
+    auto it   = s_table().find(str);
+    if (it == s_table().end())
+      it = s_table().emplace(std::string(str), new std::string(str)).first;
+    this->str = it->second;
   }
-  explicit FastString(const std::string& str) {
-    auto& ref = s_table[str];
-    if (!ref)
-      ref = new std::string(str);
-    this->str = ref;
+
+  /// re-wrap a pointer previously taken from `str`
+  static FastString from_interned(table_type::mapped_type str) {
+    return FastString(str);
   }
 
   std::string string() const { return *(this->str); }
@@ -47,6 +78,10 @@ struct FastString {
   bool operator>=(const FastString& other) const {
     return *(this->str) >= *(other.str);
   }
+
+private:
+  explicit FastString(table_type::mapped_type str)
+      : str(str) {}
 };
 
 using Id = FastString;
@@ -100,3 +135,11 @@ struct OccName {
 */
 
 } // namespace mangekyou::name
+
+/// interned: hashing the pointer is enough
+template <>
+struct std::hash<mangekyou::name::FastString> {
+  usize operator()(const mangekyou::name::FastString& s) const {
+    return std::hash<const void*>{}(s.str);
+  }
+};
@@ -0,0 +1,29 @@
+#include "pats.hpp"
+
+#include <charconv>
+
+namespace mangekyou::pat {
+
+parse::literal::Integer BigInt::value() const {
+  auto i  = parse::literal::Integer();
+  i.limbs = std::vector<u32>(this->limbs, this->limbs + this->len);
+  return i;
+}
+
+std::string Literal::to_string() const {
+  return std::visit(
+      overloaded{[](u64 i) { return std::to_string(i); },
+                 [](const BigInt& i) { return i.value().to_string(); },
+                 [](double d) {
+                   char buf[32];
+                   auto r = std::to_chars(buf, buf + sizeof(buf), d);
+                   return std::string(buf, r.ptr);
+                 },
+                 [](char c) { return "'" + std::string(1, c) + "'"; },
+                 [](std::string_view s) {
+                   return "\"" + std::string(s) + "\"";
+                 }},
+      static_cast<const Literal::variant&>(*this));
+}
+
+} // namespace mangekyou::pat
@@ -1,11 +1,37 @@
-#include <prelude>
-#include <expected>
+#pragma once
+#include <arena.hpp>
+#include <prelude.hpp>
+#include <string_view>
 #include <variant>
+#include <vector>
+
+#include "name.hpp"
+#include "parse/literal.hpp"
 
 namespace mangekyou::pat {
+  using name::Id;
+
+  /// an `Integer` literal that overflowed `u64`, limbs live in the arena
+  struct BigInt {
+    const u32* limbs;
+    u32 len;
+
+    parse::literal::Integer value() const;
+  };
+
   /// @TODO FieldPuns and Shit
-  struct Literal;
+  struct Literal
+      : std::variant<u64, BigInt, double, char, std::string_view> {
+    using variant::variant;
+
+    template <typename T>
+    bool is() const {
+      return std::holds_alternative<T>(*this);
+    }
+    std::string to_string() const;
+  };
   struct Pat;
+  using PatRef = Ref<Pat>;
 
   /// binding
   struct PVar {
@@ -16,17 +42,26 @@ namespace mangekyou::pat {
   /// as-pattern `id@pat`
   struct PAs {
     Id id;
-    Rc<Pat> pat;
+    PatRef pat;
   };
   /// literal pattern
   struct PLit {
-    Literal lit;
+    Ref<Literal> lit;
   };
-  /// Constructor
+  /// Constructor, tuples are `(,)`, `(,,)`, ...
+  /// `args` are `PatRef`s in the owner's list pool
   struct PCon {
-    Ass ass;
-    std::vector<Pat> args;
+    Id con;
+    Span args;
   };
 
+  struct Pat : std::variant<PVar, PWildcard, PAs, PLit, PCon> {
+    using variant::variant;
+
+    template <typename T>
+    bool is() const {
+      return std::holds_alternative<T>(*this);
+    }
+  };
 
 }
@@ -0,0 +1,237 @@
+#include "prim.hpp"
+
+#include <algorithm>
+#include <array>
+
+namespace mangekyou::core {
+
+namespace {
+
+struct Prim {
+  const char* boxed;
+  const char* con;
+  const char* unboxed;
+  Rep rep;
+};
+
+/// in the order of `Rep`, past `Boxed`
+constexpr Prim PRIMS[] = {
+    {"Int", "I#", "Int#", Rep::Int},
+    {"Char", "C#", "Char#", Rep::Char},
+    {"Float", "F#", "Float#", Rep::Float},
+    {"Double", "D#", "Double#", Rep::Double},
+};
+
+const Prim& prim(Rep r) { return PRIMS[static_cast<u8>(r) - 1]; }
+
+/// the unboxed type a literal of this kind is a value of, in its box
+Rep literal(const Literal& l) {
+  return std::visit(overloaded{[](u64) { return Rep::Int; },
+                               [](char) { return Rep::Char; },
+                               [](double) { return Rep::Double; },
+                               [](const auto&) { return Rep::Boxed; }},
+                    static_cast<const Literal::variant&>(l));
+}
+
+struct Representer {
+  Program& p;
+  Represented& stats;
+  /// the data type boxing each representation, by `Rep`
+  std::array<u32, 5> boxes{};
+  /// what each `extern` takes its parameters and gives its result as,
+  /// the result last, `Boxed` where it is left alone
+  std::vector<std::vector<Rep>> plans;
+
+  /// the representation the boxed primitive `ty` boxes, `Boxed` for any
+  /// other type
+  Rep boxed(TypeRef ty) const {
+    auto* c = std::get_if<TCon>(&this->p[ty]);
+    if (c)
+      for (auto& x : PRIMS)
+        if (c->id == Id(x.boxed))
+          return x.rep;
+    return Rep::Boxed;
+  }
+  TypeRef unboxed(Rep r) { return this->p.type(TCon{Id(prim(r).unboxed)}); }
+
+  void declare() {
+    for (auto& x : PRIMS) {
+      auto t = u32(0);
+      while (t < this->p.data.size() && this->p.data[t].name != Id(x.boxed))
+        ++t;
+      this->boxes[static_cast<u8>(x.rep)] = t;
+      if (t < this->p.data.size())
+        continue;
+      auto con = DataCon{Id(x.con), {unboxed(x.rep)}};
+      this->p.data.push_back(DataType{Id(x.boxed), {}, {con}});
+      this->p.env.declare(pat::DataInfo{Id(x.boxed), {Id(x.con)}, {1}});
+    }
+  }
+
+  /// the `extern`s' types with the unboxed types in place of the boxed
+  void externs() {
+    for (auto& ext : this->p.externs) {
+      auto ty   = ext.ty;
+      auto from = std::vector<TypeRef>();
+      auto plan = std::vector<Rep>();
+      for (u32 k = 0; k < ext.arity; ++k) {
+        auto& f = std::get<TFun>(this->p[ty]);
+        from.push_back(f.from);
+        plan.push_back(boxed(f.from));
+        ty = f.to;
+      }
+      plan.push_back(boxed(ty));
+      if (plan.back() != Rep::Boxed)
+        ty = unboxed(plan.back());
+      for (auto k = ext.arity; k-- > 0;) {
+        auto arg = plan[k] == Rep::Boxed ? from[k] : unboxed(plan[k]);
+        ty       = this->p.type(TFun{arg, ty});
+      }
+      ext.ty = ty;
+      this->plans.push_back(std::move(plan));
+    }
+  }
+
+  /// `I# v` for the machine value `v`
+  ExprRef box(Rep r, ExprRef v) {
+    auto ty = this->p.type(TCon{Id(prim(r).boxed)});
+    auto fn = this->p.type(TFun{unboxed(r), ty});
+    auto c  = this->p.add(ECon{this->boxes[static_cast<u8>(r)], 0}, fn);
+    return this->p.add(EApp{c, this->p.list(std::vector<ExprRef>{v})}, ty);
+  }
+  /// `case scrut of { I# u -> body }`
+  ExprRef unpack(ExprRef scrut, Rep r, VarRef u, ExprRef body) {
+    auto alt  = Alt{Alt::Con, this->boxes[static_cast<u8>(r)], 0, LitRef(),
+                   this->p.list(std::vector<VarRef>{u}), body};
+    auto alts = std::vector<Ref<Alt>>{this->p.add(alt)};
+    return this->p.add(ECase{scrut, VarRef(), this->p.list(alts)},
+                       this->p.type_of(body));
+  }
+  /// the machine value in the box `e`, `n#` for the variable `n`
+  VarRef field(ExprRef e, Rep r) {
+    auto* x = std::get_if<EVar>(&this->p[e]);
+    return field(x ? this->p[x->var].name.string() : string("x"), r);
+  }
+  VarRef field(const string& name, Rep r) {
+    return this->p.add(Var{Id(name + "#"), unboxed(r), true});
+  }
+
+  void call(ExprRef e, const ECall& x) {
+    auto& plan = this->plans[x.ext];
+    if (std::all_of(plan.begin(), plan.end(),
+                    [](Rep r) { return r == Rep::Boxed; }))
+      return;
+    ++this->stats.calls;
+    auto args    = std::vector<ExprRef>();
+    auto unpacks = std::vector<std::tuple<ExprRef, Rep, VarRef>>();
+    for (u32 k = 0; k < x.args.len; ++k) {
+      auto a = this->p.at<ExprRef>(x.args, k);
+      if (plan[k] != Rep::Boxed) {
+        auto u = field(a, plan[k]);
+        unpacks.emplace_back(a, plan[k], u);
+        a = this->p.add(EVar{u}, unboxed(plan[k]));
+      }
+      args.push_back(a);
+    }
+    auto result = plan.back();
+    auto body   = this->p.add(
+        ECall{x.ext, this->p.list(args)},
+        result == Rep::Boxed ? this->p.type_of(e) : unboxed(result));
+    if (result != Rep::Boxed)
+      body = box(result, body);
+    for (auto it = unpacks.rbegin(); it != unpacks.rend(); ++it)
+      body = unpack(std::get<0>(*it), std::get<1>(*it), std::get<2>(*it),
+                    body);
+    this->p.replace(e, body);
+  }
+
+  void expr(ExprRef e) {
+    auto node = Expr(this->p[e]);
+    auto list = [&](Span s) {
+      for (u32 k = 0; k < s.len; ++k)
+        expr(this->p.at<ExprRef>(s, k));
+    };
+    std::visit(
+        overloaded{
+            [](const EVar&) {}, [](const ECon&) {}, [](const EFail&) {},
+            [&](const ELit& x) {
+              auto r = literal(this->p[x.lit]);
+              if (r == Rep::Boxed || rep(this->p, this->p.type_of(e))
+                                         != Rep::Boxed)
+                return;
+              ++this->stats.literals;
+              auto lit = this->p.add(ELit{x.lit}, unboxed(r));
+              this->p.replace(e, box(r, lit));
+            },
+            [&](const EApp& x) {
+              expr(x.fn);
+              list(x.args);
+            },
+            [&](const ELam& x) { expr(x.body); },
+            [&](const ELet& x) {
+              expr(x.rhs);
+              expr(x.body);
+            },
+            [&](const ELetRec& x) {
+              for (u32 k = 0; k < x.binds.len; ++k)
+                expr(this->p[this->p.at<Ref<Bind>>(x.binds, k)].rhs);
+              expr(x.body);
+            },
+            [&](const ECase& x) {
+              expr(x.scrut);
+              auto r = Rep::Boxed;
+              for (u32 k = 0; k < x.alts.len; ++k) {
+                auto alt = this->p[this->p.at<Ref<Alt>>(x.alts, k)];
+                expr(alt.rhs);
+                if (alt.kind == Alt::Lit)
+                  r = literal(this->p[alt.lit]);
+              }
+              if (r == Rep::Boxed
+                  || rep(this->p, this->p.type_of(x.scrut)) != Rep::Boxed)
+                return;
+              ++this->stats.cases;
+              auto u     = x.bndr.valid()
+                               ? field(this->p[x.bndr].name.string(), r)
+                               : field(x.scrut, r);
+              auto inner = this->p.add(
+                  ECase{this->p.add(EVar{u}, unboxed(r)), VarRef(), x.alts},
+                  this->p.type_of(e));
+              auto alt   = Alt{Alt::Con, this->boxes[static_cast<u8>(r)], 0,
+                             LitRef(), this->p.list(std::vector<VarRef>{u}),
+                             inner};
+              auto alts  = std::vector<Ref<Alt>>{this->p.add(alt)};
+              auto out   = this->p.add(
+                  ECase{x.scrut, x.bndr, this->p.list(alts)},
+                  this->p.type_of(e));
+              this->p.replace(e, out);
+            },
+            [&](const ECall& x) {
+              list(x.args);
+              call(e, x);
+            }},
+        static_cast<const Expr::variant&>(node));
+  }
+};
+
+} // namespace
+
+Rep rep(const Program& p, TypeRef ty) {
+  auto* c = std::get_if<TCon>(&p[ty]);
+  if (c)
+    for (auto& x : PRIMS)
+      if (c->id == Id(x.unboxed))
+        return x.rep;
+  return Rep::Boxed;
+}
+
+Represented represent(Program& p) {
+  auto stats = Represented();
+  auto r     = Representer{p, stats, {}, {}};
+  r.declare();
+  r.externs();
+  for (auto b : p.top)
+    r.expr(p[b].rhs);
+  return stats;
+}
+
+} // namespace mangekyou::core
@@ -0,0 +1,52 @@
+#pragma once
+#include <prelude.hpp>
+
+#include "ir.hpp"
+
+/** unboxed primitives: `Int#`, `Char#`, `Float#` and `Double#` are machine
+ * values, the primitive types of the front end are ordinary data types
+ * boxing them:
+ *
+ *     data Int    = I# Int#
+ *     data Char   = C# Char#
+ *     data Float  = F# Float#
+ *     data Double = D# Double#
+ *
+ * `represent` declares those in a desugared program and makes the boxes
+ * explicit:
+ * - an `Int`, `Char` or `Double` literal is boxed, `I# 1`,
+ * - a `case` on literals unpacks its scrutinee and switches on the
+ *   machine value, `case n of { I# n# -> case n# of { 0 -> .. } }`,
+ * - an `extern` takes and returns the unboxed types in place of the boxed
+ *   ones, so `@add` is the machine addition; its calls unpack their
+ *   arguments and box the result.
+ *
+ * after it, `Int` is a product like any other: a function strict in one
+ * is split by `worker_wrapper` into a worker taking the `Int#`, and a loop
+ * over it keeps the machine value and allocates nothing. a value of an
+ * unboxed type is never suspended: bound by a `let`, passed as an argument
+ * or stored in a field, it is computed on the spot.
+ */
+namespace mangekyou::core {
+
+/// how a value is held: a pointer to a heap object, or a machine value of
+/// one of the unboxed types
+enum class Rep : u8 { Boxed, Int, Char, Float, Double };
+
+/// the representation of the values of `ty`
+Rep rep(const Program& p, TypeRef ty);
+
+struct Represented {
+  /// literals boxed
+  u32 literals = 0;
+  /// `case`s on literals unpacking their scrutinee
+  u32 cases = 0;
+  /// `extern` calls unpacking their arguments or boxing their result
+  u32 calls = 0;
+};
+
+/// declare the boxed primitives in `p` and make their boxes explicit, in
+/// place. running it again changes nothing
+Represented represent(Program& p);
+
+} // namespace mangekyou::core
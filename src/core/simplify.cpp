@@ -0,0 +1,838 @@
+#include "simplify.hpp"
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace mangekyou::core {
+
+/** size */
+
+u32 size(const Program& p, ExprRef e, u32 cap) {
+  auto n    = u32(0);
+  auto walk = [&](ExprRef r, auto& self) -> void {
+    if (++n > cap)
+      return;
+    auto list = [&](Span s) {
+      for (u32 k = 0; k < s.len && n <= cap; ++k)
+        self(p.at<ExprRef>(s, k), self);
+    };
+    std::visit(overloaded{[](const EVar&) {}, [](const ELit&) {},
+                          [](const ECon&) {}, [](const EFail&) {},
+                          [&](const EApp& x) {
+                            self(x.fn, self);
+                            list(x.args);
+                          },
+                          [&](const ELam& x) { self(x.body, self); },
+                          [&](const ELet& x) {
+                            self(x.rhs, self);
+                            self(x.body, self);
+                          },
+                          [&](const ELetRec& x) {
+                            for (u32 k = 0; k < x.binds.len; ++k)
+                              self(p[p.at<Ref<Bind>>(x.binds, k)].rhs, self);
+                            self(x.body, self);
+                          },
+                          [&](const ECase& x) {
+                            self(x.scrut, self);
+                            for (u32 k = 0; k < x.alts.len; ++k)
+                              self(p[p.at<Ref<Alt>>(x.alts, k)].rhs, self);
+                          },
+                          [&](const ECall& x) { list(x.args); }},
+               static_cast<const Expr::variant&>(p[r]));
+  };
+  walk(e, walk);
+  return n;
+}
+
+namespace {
+
+/// how an input variable occurs
+struct Occ {
+  u32 uses = 0;
+  /// some use is under a lambda the binder is not
+  bool in_lam = false;
+  /// the loop breaker of a cycle in its recursive group, never inlined
+  bool loop = false;
+  /// lambdas around the binder
+  u32 depth = 0;
+};
+
+/** occurrence analysis */
+
+struct Analyser {
+  const Program& p;
+  std::vector<Occ> occ;
+  /// the recursive group each variable is bound in, 0 for none
+  std::vector<u32> group;
+  u32 groups = 0;
+  u32 depth  = 0;
+  /// group members whose right-hand sides are being analysed, innermost last
+  std::vector<VarRef> owners;
+  /// the members of its own group each member's right-hand side mentions
+  std::unordered_map<u32, std::vector<u32>> deps;
+  /// the right-hand side of each group member
+  std::unordered_map<u32, ExprRef> rhs;
+
+  void binder(VarRef v) { this->occ[v.i].depth = this->depth; }
+  void use(VarRef v) {
+    auto& o = this->occ[v.i];
+    ++o.uses;
+    o.in_lam |= this->depth > o.depth;
+    if (!this->group[v.i])
+      return;
+    for (auto it = this->owners.rbegin(); it != this->owners.rend(); ++it)
+      if (this->group[it->i] == this->group[v.i]) {
+        this->deps[it->i].push_back(v.i);
+        break;
+      }
+  }
+
+  void expr(ExprRef e) {
+    auto list = [&](Span s) {
+      for (u32 k = 0; k < s.len; ++k)
+        expr(this->p.at<ExprRef>(s, k));
+    };
+    std::visit(
+        overloaded{[&](const EVar& x) { use(x.var); }, [](const ELit&) {},
+                   [](const ECon&) {}, [](const EFail&) {},
+                   [&](const EApp& x) {
+                     expr(x.fn);
+                     list(x.args);
+                   },
+                   [&](const ELam& x) {
+                     ++this->depth;
+                     for (u32 k = 0; k < x.params.len; ++k)
+                       binder(this->p.at<VarRef>(x.params, k));
+                     expr(x.body);
+                     --this->depth;
+                   },
+                   [&](const ELet& x) {
+                     expr(x.rhs);
+                     binder(x.var);
+                     expr(x.body);
+                   },
+                   [&](const ELetRec& x) {
+                     auto binds = std::vector<Ref<Bind>>();
+                     for (u32 k = 0; k < x.binds.len; ++k)
+                       binds.push_back(this->p.at<Ref<Bind>>(x.binds, k));
+                     rec(binds, x.body);
+                   },
+                   [&](const ECase& x) {
+                     expr(x.scrut);
+                     if (x.bndr.valid())
+                       binder(x.bndr);
+                     for (u32 k = 0; k < x.alts.len; ++k) {
+                       auto& alt = this->p[this->p.at<Ref<Alt>>(x.alts, k)];
+                       for (u32 v = 0; v < alt.vars.len; ++v)
+                         binder(this->p.at<VarRef>(alt.vars, v));
+                       expr(alt.rhs);
+                     }
+                   },
+                   [&](const ECall& x) { list(x.args); }},
+        static_cast<const Expr::variant&>(this->p[e]));
+  }
+
+  /// a recursive group: only the bindings `body` reaches are analysed, the
+  /// others keep no uses. without a body (the top level) all are kept
+  void rec(const std::vector<Ref<Bind>>& binds, ExprRef body) {
+    auto g = ++this->groups;
+    for (auto b : binds) {
+      this->group[this->p[b].var.i] = g;
+      binder(this->p[b].var);
+    }
+    if (body.valid())
+      expr(body);
+    auto live = std::vector<bool>(binds.size());
+    for (auto changed = true; changed;) {
+      changed = false;
+      for (usize k = 0; k < binds.size(); ++k) {
+        auto& b = this->p[binds[k]];
+        if (live[k] || (body.valid() && !this->occ[b.var.i].uses))
+          continue;
+        live[k] = changed = true;
+        this->owners.push_back(b.var);
+        expr(b.rhs);
+        this->owners.pop_back();
+      }
+    }
+    auto members = std::vector<u32>();
+    for (usize k = 0; k < binds.size(); ++k)
+      if (live[k]) {
+        members.push_back(this->p[binds[k]].var.i);
+        this->rhs[members.back()] = this->p[binds[k]].rhs;
+      }
+    cycles(members);
+  }
+
+  /// every cycle of `deps` gets one loop breaker, never inlined: its
+  /// biggest member, so a small wrapper around a recursive worker stays
+  /// inlinable. the rest of the cycle is looked at again without it
+  void cycles(const std::vector<u32>& members) {
+    constexpr auto NONE = ~u32(0);
+    auto index   = std::unordered_map<u32, u32>();
+    auto order   = std::vector<u32>(members.size(), NONE);
+    auto low     = std::vector<u32>(members.size());
+    auto on      = std::vector<bool>(members.size());
+    auto stack   = std::vector<u32>();
+    auto loops   = std::vector<std::vector<u32>>();
+    auto counter = u32(0);
+    for (u32 k = 0; k < members.size(); ++k)
+      index[members[k]] = k;
+
+    auto visit = [&](u32 k, auto& self) -> void {
+      order[k] = low[k] = counter++;
+      stack.push_back(k);
+      on[k]       = true;
+      auto& out   = this->deps[members[k]];
+      auto looped = false;
+      for (auto d : out) {
+        auto it = index.find(d);
+        if (it == index.end())
+          continue;
+        auto j = it->second;
+        if (j == k)
+          looped = true;
+        if (order[j] == NONE) {
+          self(j, self);
+          low[k] = std::min(low[k], low[j]);
+        } else if (on[j]) {
+          low[k] = std::min(low[k], order[j]);
+        }
+      }
+      if (low[k] != order[k])
+        return;
+      auto start  = std::find(stack.begin(), stack.end(), k);
+      auto cyclic = looped || stack.end() - start > 1;
+      if (cyclic)
+        loops.emplace_back();
+      for (auto it = start; it != stack.end(); ++it) {
+        on[*it] = false;
+        if (cyclic)
+          loops.back().push_back(members[*it]);
+      }
+      stack.erase(start, stack.end());
+    };
+    for (u32 k = 0; k < members.size(); ++k)
+      if (order[k] == NONE)
+        visit(k, visit);
+
+    for (auto& loop : loops) {
+      auto biggest = loop.begin();
+      auto most    = u32(0);
+      for (auto it = loop.begin(); it != loop.end(); ++it) {
+        auto n = size(this->p, this->rhs.at(*it), 256);
+        if (n > most) {
+          most    = n;
+          biggest = it;
+        }
+      }
+      this->occ[*biggest].loop = true;
+      loop.erase(biggest);
+      cycles(loop);
+    }
+  }
+};
+
+/** rewriting */
+
+/// what an input variable becomes
+struct Subst {
+  enum Kind : u8 {
+    /// itself: an output variable, or one not rebound yet
+    None,
+    Rename,
+    /// an output atom, shared by every use
+    Done,
+    /// its input right-hand side, simplified at its one use
+    Later,
+  };
+  Kind kind = None;
+  VarRef var;
+  ExprRef expr;
+};
+
+/// inside an alternative: the variable is constructor `tag` of `type`,
+/// with these fields
+struct Known {
+  u32 type;
+  u32 tag;
+  std::vector<VarRef> vars;
+};
+
+/// a constructor application seen through
+struct ConApp {
+  u32 type;
+  u32 tag;
+  std::vector<ExprRef> args;
+};
+
+struct Simplifier {
+  Program& p;
+  const Budget& budget;
+  Stats& stats;
+  /// ticks left for rewrites that copy code
+  u32 fuel;
+  /// of the input variables
+  std::vector<Occ> occ;
+  std::vector<Subst> subst;
+  /// of the output variables: their simplified right-hand side, and
+  /// whether it may be inlined
+  std::vector<ExprRef> unfoldings;
+  std::vector<u8> inlinable;
+  std::unordered_map<u32, Known> known;
+
+  template <typename T>
+  T& at(std::vector<T>& v, VarRef r) {
+    if (v.size() <= r.i)
+      v.resize(this->p.vars.size());
+    return v[r.i];
+  }
+  /// variables bound while rewriting are used many times, as far as we know
+  Occ info(VarRef v) const {
+    return v.i < this->occ.size() ? this->occ[v.i] : Occ{2, true, true, 0};
+  }
+  bool spend() {
+    if (!this->fuel)
+      return false;
+    --this->fuel;
+    return true;
+  }
+
+  static bool atom(const Expr& e) {
+    return e.is<EVar>() || e.is<ELit>() || e.is<ECon>();
+  }
+  u32 arity(u32 type, u32 tag) const {
+    return static_cast<u32>(this->p.data[type].cons[tag].fields.size());
+  }
+  ExprRef var(VarRef v) { return this->p.add(EVar{v}, this->p[v].ty); }
+  VarRef rename(VarRef v) {
+    auto out = this->p.clone(v);
+    at(this->subst, v) = Subst{Subst::Rename, out, {}};
+    return out;
+  }
+
+  /// `e` as a saturated constructor application, through what is known
+  /// of variables
+  option<ConApp> con_app(ExprRef e) {
+    auto node = Expr(this->p[e]);
+    if (auto* c = std::get_if<ECon>(&node))
+      if (!arity(c->type, c->tag))
+        return ConApp{c->type, c->tag, {}};
+    if (auto* a = std::get_if<EApp>(&node))
+      if (auto* c = std::get_if<ECon>(&this->p[a->fn]))
+        if (a->args.len == arity(c->type, c->tag)) {
+          auto out = ConApp{c->type, c->tag, {}};
+          for (u32 k = 0; k < a->args.len; ++k)
+            out.args.push_back(this->p.at<ExprRef>(a->args, k));
+          return out;
+        }
+    auto* x = std::get_if<EVar>(&node);
+    if (!x)
+      return {};
+    if (auto it = this->known.find(x->var.i); it != this->known.end()) {
+      auto out = ConApp{it->second.type, it->second.tag, {}};
+      for (auto v : it->second.vars)
+        out.args.push_back(var(v));
+      return out;
+    }
+    // a `let` of a constructor, when its fields can be copied
+    auto u = at(this->unfoldings, x->var);
+    if (!u.valid())
+      return {};
+    auto out = con_app(u);
+    if (out)
+      for (auto a : out->args)
+        if (!atom(this->p[a]))
+          return {};
+    return out;
+  }
+
+  /** bindings */
+  /// `v = rhs` of a `let`: substituted or dropped, or the binding to keep
+  option<Bind> bind(VarRef v, ExprRef rhs) {
+    auto o = info(v);
+    if (!o.uses) {
+      ++this->stats.dead;
+      return {};
+    }
+    if (o.uses == 1 && !o.loop && (!o.in_lam || this->p[rhs].is<ELam>())) {
+      at(this->subst, v) = Subst{Subst::Later, {}, rhs};
+      return {};
+    }
+    auto out = expr(rhs);
+    if (atom(this->p[out])) {
+      ++this->stats.inlined;
+      at(this->subst, v) = Subst{Subst::Done, {}, out};
+      return {};
+    }
+    auto v2                   = rename(v);
+    at(this->unfoldings, v2) = out;
+    at(this->inlinable, v2)  = !o.loop;
+    return Bind{v2, out};
+  }
+  /// `let` the output bindings `bs` around `body`
+  ExprRef wrap(const std::vector<Bind>& bs, ExprRef body) {
+    for (auto it = bs.rbegin(); it != bs.rend(); ++it)
+      body = this->p.add(ELet{it->var, it->rhs, body},
+                         this->p.type_of(body));
+    return body;
+  }
+  /// bind the input `v` to the output `e`
+  void bind_to(VarRef v, ExprRef e, std::vector<Bind>& out) {
+    if (atom(this->p[e])) {
+      at(this->subst, v) = Subst{Subst::Done, {}, e};
+      return;
+    }
+    auto v2                   = rename(v);
+    at(this->unfoldings, v2) = e;
+    out.push_back(Bind{v2, e});
+  }
+
+  ExprRef letrec(const std::vector<Ref<Bind>>& binds, ExprRef body) {
+    auto kept = std::vector<Bind>();
+    for (auto r : binds) {
+      auto b = this->p[r];
+      auto o = info(b.var);
+      if (!o.uses) {
+        ++this->stats.dead;
+      } else if (o.uses == 1 && !o.loop
+                 && (!o.in_lam || this->p[b.rhs].is<ELam>())) {
+        at(this->subst, b.var) = Subst{Subst::Later, {}, b.rhs};
+      } else {
+        kept.push_back(Bind{rename(b.var), b.rhs});
+        at(this->inlinable, kept.back().var) = !o.loop;
+      }
+    }
+    auto out = std::vector<Ref<Bind>>();
+    for (auto& b : kept) {
+      auto rhs                    = expr(b.rhs);
+      at(this->unfoldings, b.var) = rhs;
+      out.push_back(this->p.add(Bind{b.var, rhs}));
+    }
+    auto e = expr(body);
+    if (out.empty())
+      return e;
+    // one binding off any cycle needs no `letrec`
+    if (out.size() == 1 && at(this->inlinable, kept[0].var))
+      return wrap({this->p[out[0]]}, e);
+    return this->p.add(ELetRec{this->p.list(out), e}, this->p.type_of(e));
+  }
+
+  /** applications */
+  /// `lam args`, `lam` an input or output lambda and `args` input
+  ExprRef beta(ExprRef lam, const std::vector<ExprRef>& args) {
+    ++this->stats.beta;
+    auto l    = std::get<ELam>(this->p[lam]);
+    auto n    = std::min(l.params.len, static_cast<u32>(args.size()));
+    auto body = l.body;
+    if (l.params.len > n)
+      body = this->p.add(ELam{Span{l.params.start + n, l.params.len - n}, body},
+                         this->p.result(this->p.type_of(lam), n));
+    for (auto k = n; k-- > 0;)
+      body = this->p.add(
+          ELet{this->p.at<VarRef>(l.params, k), args[k], body},
+          this->p.type_of(body));
+    auto out = expr(body);
+    if (args.size() == n)
+      return out;
+    auto rest = std::vector<ExprRef>();
+    for (auto k = n; k < args.size(); ++k)
+      rest.push_back(expr(args[k]));
+    return apply(out, rest);
+  }
+  /// `fn args`, both output
+  ExprRef apply(ExprRef fn, std::vector<ExprRef> args) {
+    if (auto* a = std::get_if<EApp>(&this->p[fn])) {
+      auto inner = *a;
+      auto all   = std::vector<ExprRef>();
+      for (u32 k = 0; k < inner.args.len; ++k)
+        all.push_back(this->p.at<ExprRef>(inner.args, k));
+      all.insert(all.end(), args.begin(), args.end());
+      return apply(inner.fn, std::move(all));
+    }
+    auto ty = this->p.result(this->p.type_of(fn), args.size());
+    return this->p.add(EApp{fn, this->p.list(args)}, ty);
+  }
+
+  /// whether the input `arg` is a value at its call
+  bool value(ExprRef arg) {
+    auto& e = this->p[arg];
+    if (e.is<ELit>() || e.is<ELam>() || e.is<ECon>())
+      return true;
+    if (auto* a = std::get_if<EApp>(&e))
+      return this->p[a->fn].is<ECon>();
+    if (auto* x = std::get_if<EVar>(&e)) {
+      auto& s = at(this->subst, x->var);
+      auto v  = s.kind == Subst::Rename ? s.var : x->var;
+      if (s.kind == Subst::Done)
+        return true;
+      auto u = at(this->unfoldings, v);
+      return u.valid() && value(u);
+    }
+    return false;
+  }
+  /// whether `body` scrutinises or calls `v`
+  bool looks_into(ExprRef body, VarRef v) {
+    auto hit  = false;
+    auto walk = [&](ExprRef r, auto& self) -> void {
+      if (hit)
+        return;
+      auto head = [&](ExprRef h) {
+        auto* x = std::get_if<EVar>(&this->p[h]);
+        hit |= x && x->var.i == v.i;
+      };
+      auto list = [&](Span s) {
+        for (u32 k = 0; k < s.len; ++k)
+          self(this->p.at<ExprRef>(s, k), self);
+      };
+      std::visit(
+          overloaded{[](const EVar&) {}, [](const ELit&) {},
+                     [](const ECon&) {}, [](const EFail&) {},
+                     [&](const EApp& x) {
+                       head(x.fn);
+                       self(x.fn, self);
+                       list(x.args);
+                     },
+                     [&](const ELam& x) { self(x.body, self); },
+                     [&](const ELet& x) {
+                       self(x.rhs, self);
+                       self(x.body, self);
+                     },
+                     [&](const ELetRec& x) {
+                       for (u32 k = 0; k < x.binds.len; ++k)
+                         self(this->p[this->p.at<Ref<Bind>>(x.binds, k)].rhs,
+                              self);
+                       self(x.body, self);
+                     },
+                     [&](const ECase& x) {
+                       head(x.scrut);
+                       self(x.scrut, self);
+                       for (u32 k = 0; k < x.alts.len; ++k)
+                         self(this->p[this->p.at<Ref<Alt>>(x.alts, k)].rhs,
+                              self);
+                     },
+                     [&](const ECall& x) { list(x.args); }},
+          static_cast<const Expr::variant&>(this->p[r]));
+    };
+    walk(body, walk);
+    return hit;
+  }
+  /// inline the unfolding of the output `v` into a call with `args`
+  bool inline_into(VarRef v, const std::vector<ExprRef>& args) {
+    auto u = at(this->unfoldings, v);
+    if (!u.valid() || !at(this->inlinable, v))
+      return false;
+    auto* l = std::get_if<ELam>(&this->p[u]);
+    if (!l || args.size() < l->params.len)
+      return false;
+    auto lam   = *l;
+    auto limit = this->budget.inline_size;
+    auto n     = size(this->p, lam.body,
+                      limit + lam.params.len * this->budget.discount);
+    if (n > limit)
+      for (u32 k = 0; k < lam.params.len; ++k)
+        if (value(args[k])
+            && looks_into(lam.body, this->p.at<VarRef>(lam.params, k)))
+          limit += this->budget.discount;
+    return n <= limit && spend();
+  }
+
+  ExprRef app(ExprRef fn, std::vector<ExprRef> args) {
+    // look through bindings substituted at their one use, and through
+    // nested applications, for a lambda
+    for (;;) {
+      auto& e = this->p[fn];
+      if (auto* x = std::get_if<EVar>(&e)) {
+        auto& s = at(this->subst, x->var);
+        if (s.kind != Subst::Later)
+          break;
+        ++this->stats.inlined;
+        fn = s.expr;
+      } else if (auto* a = std::get_if<EApp>(&e)) {
+        auto inner = *a;
+        auto all   = std::vector<ExprRef>();
+        for (u32 k = 0; k < inner.args.len; ++k)
+          all.push_back(this->p.at<ExprRef>(inner.args, k));
+        args.insert(args.begin(), all.begin(), all.end());
+        fn = inner.fn;
+      } else {
+        break;
+      }
+    }
+    if (this->p[fn].is<ELam>())
+      return beta(fn, args);
+    auto f = expr(fn);
+    if (this->p[f].is<EFail>())
+      return f;
+    if (auto* x = std::get_if<EVar>(&this->p[f]))
+      if (inline_into(x->var, args)) {
+        ++this->stats.inlined;
+        return beta(at(this->unfoldings, x->var), args);
+      }
+    for (auto& a : args)
+      a = expr(a);
+    return apply(f, std::move(args));
+  }
+
+  /** case */
+  /// the alternative of `alts` that `tag`, or the literal `lit`, picks
+  option<Alt> pick(Span alts, option<u32> tag, option<Literal> lit) {
+    for (u32 k = 0; k < alts.len; ++k) {
+      auto alt = this->p[this->p.at<Ref<Alt>>(alts, k)];
+      if (alt.kind == Alt::Default || (tag && alt.kind == Alt::Con
+                                        && alt.tag == *tag)
+          || (lit && alt.kind == Alt::Lit
+              && pat::same(*lit, this->p[alt.lit])))
+        return alt;
+    }
+    return {};
+  }
+  /// the chosen alternative, bound to the output scrutinee `s`
+  ExprRef choose(ExprRef s, VarRef bndr, option<Alt> alt,
+                 const std::vector<ExprRef>& fields, TypeRef ty) {
+    ++this->stats.known;
+    if (!alt)
+      return this->p.add(EFail{}, ty);
+    auto binds = std::vector<Bind>();
+    auto whole = s;
+    if (alt->kind == Alt::Con) {
+      // the fields are parts of `s`: a field that is not an atom is bound
+      // first, and `bndr` rebuilt from its variable rather than copying it
+      auto args  = std::vector<ExprRef>();
+      bool atoms = true;
+      for (u32 k = 0; k < alt->vars.len; ++k) {
+        bind_to(this->p.at<VarRef>(alt->vars, k), fields[k], binds);
+        atoms &= atom(this->p[fields[k]]);
+        args.push_back(atom(this->p[fields[k]]) ? fields[k]
+                                                : var(binds.back().var));
+      }
+      if (bndr.valid() && !atoms) {
+        // only an application has fields that are not atoms
+        auto fn = std::get<EApp>(this->p[s]).fn;
+        whole   = this->p.add(EApp{fn, this->p.list(args)},
+                              this->p.type_of(s));
+      }
+    }
+    if (bndr.valid())
+      bind_to(bndr, whole, binds);
+    return wrap(binds, expr(alt->rhs));
+  }
+
+  /// `case s of alts`, `s` output, `bndr` and `alts` input
+  ExprRef select(ExprRef s, VarRef bndr, Span alts, TypeRef ty) {
+    auto node = Expr(this->p[s]);
+    if (node.is<EFail>())
+      return s;
+    if (auto* l = std::get_if<ELet>(&node)) {
+      ++this->stats.case_of_case;
+      auto body = select(l->body, bndr, alts, ty);
+      return this->p.add(ELet{l->var, l->rhs, body}, this->p.type_of(body));
+    }
+    if (auto* l = std::get_if<ELetRec>(&node)) {
+      ++this->stats.case_of_case;
+      auto body = select(l->body, bndr, alts, ty);
+      return this->p.add(ELetRec{l->binds, body}, this->p.type_of(body));
+    }
+    if (auto* l = std::get_if<ELit>(&node))
+      return choose(s, bndr, pick(alts, {}, this->p[l->lit]), {}, ty);
+    if (auto c = con_app(s))
+      return choose(s, bndr, pick(alts, c->tag, {}), c->args, ty);
+    if (auto* inner = std::get_if<ECase>(&node))
+      if (auto out = case_of_case(*inner, bndr, alts, ty))
+        return *out;
+
+    auto b2  = bndr.valid() ? rename(bndr) : VarRef();
+    auto out = std::vector<Ref<Alt>>();
+    for (u32 k = 0; k < alts.len; ++k) {
+      auto alt  = this->p[this->p.at<Ref<Alt>>(alts, k)];
+      auto vars = std::vector<VarRef>();
+      for (u32 v = 0; v < alt.vars.len; ++v)
+        vars.push_back(rename(this->p.at<VarRef>(alt.vars, v)));
+      alt.vars = this->p.list(vars);
+      if (alt.kind == Alt::Con) {
+        auto fact = Known{alt.type, alt.tag, vars};
+        alt.rhs   = under(s, b2, fact, alt.rhs);
+      } else {
+        alt.rhs = expr(alt.rhs);
+      }
+      out.push_back(this->p.add(alt));
+    }
+    return this->p.add(ECase{s, b2, this->p.list(out)}, ty);
+  }
+  /// the input `rhs`, knowing the output `s` (when a variable) and `bndr`
+  /// (when valid) are `fact`
+  ExprRef under(ExprRef s, VarRef bndr, const Known& fact, ExprRef rhs) {
+    auto vars = std::vector<VarRef>{bndr};
+    if (auto* x = std::get_if<EVar>(&this->p[s]))
+      vars.push_back(x->var);
+    auto saved = std::vector<option<Known>>();
+    for (auto v : vars) {
+      auto it = this->known.find(v.i);
+      saved.push_back(it == this->known.end() ? option<Known>()
+                                              : option<Known>(it->second));
+      if (v.valid())
+        this->known[v.i] = fact;
+    }
+    auto out = expr(rhs);
+    for (usize k = 0; k < vars.size(); ++k) {
+      if (saved[k])
+        this->known[vars[k].i] = *saved[k];
+      else
+        this->known.erase(vars[k].i);
+    }
+    return out;
+  }
+  /// the outer `alts` copied into every alternative of `inner`, when that
+  /// is cheap enough
+  option<ExprRef> case_of_case(const ECase& inner, VarRef bndr, Span alts,
+                               TypeRef ty) {
+    auto cost = u32(0);
+    for (u32 k = 0; k < alts.len; ++k)
+      cost += size(this->p, this->p[this->p.at<Ref<Alt>>(alts, k)].rhs,
+                   this->budget.inline_size + 1);
+    if (inner.alts.len > 1
+        && cost * (inner.alts.len - 1) > this->budget.inline_size)
+      return {};
+    if (!spend())
+      return {};
+    ++this->stats.case_of_case;
+    auto out = std::vector<Ref<Alt>>();
+    for (u32 k = 0; k < inner.alts.len; ++k) {
+      auto alt = this->p[this->p.at<Ref<Alt>>(inner.alts, k)];
+      if (alt.kind == Alt::Con) {
+        auto fact = Known{alt.type, alt.tag, {}};
+        for (u32 v = 0; v < alt.vars.len; ++v)
+          fact.vars.push_back(this->p.at<VarRef>(alt.vars, v));
+        // the inner alternative is already simplified, only the outer
+        // ones are rewritten with what it knows
+        auto saved = this->known;
+        if (auto* x = std::get_if<EVar>(&this->p[inner.scrut]))
+          this->known[x->var.i] = fact;
+        if (inner.bndr.valid())
+          this->known[inner.bndr.i] = fact;
+        alt.rhs     = select(alt.rhs, bndr, alts, ty);
+        this->known = std::move(saved);
+      } else {
+        alt.rhs = select(alt.rhs, bndr, alts, ty);
+      }
+      out.push_back(this->p.add(alt));
+    }
+    return this->p.add(ECase{inner.scrut, inner.bndr, this->p.list(out)},
+                       ty);
+  }
+
+  /** expressions */
+  ExprRef expr(ExprRef e) {
+    auto ty   = this->p.type_of(e);
+    auto node = Expr(this->p[e]);
+    auto list = [&](Span s) {
+      auto out = std::vector<ExprRef>();
+      for (u32 k = 0; k < s.len; ++k)
+        out.push_back(this->p.at<ExprRef>(s, k));
+      return out;
+    };
+    return std::visit(
+        overloaded{
+            [&](const EVar& x) -> ExprRef {
+              auto s = at(this->subst, x.var);
+              switch (s.kind) {
+              case Subst::None: return e;
+              case Subst::Rename: return var(s.var);
+              case Subst::Done: return s.expr;
+              case Subst::Later: ++this->stats.inlined; return expr(s.expr);
+              }
+              return e;
+            },
+            [&](const ELit&) { return e; }, [&](const ECon&) { return e; },
+            [&](const EFail&) { return e; },
+            [&](const EApp& x) { return app(x.fn, list(x.args)); },
+            [&](const ELam& x) -> ExprRef {
+              auto params = std::vector<VarRef>();
+              for (u32 k = 0; k < x.params.len; ++k)
+                params.push_back(rename(this->p.at<VarRef>(x.params, k)));
+              auto body = expr(x.body);
+              // `\x -> \y -> b` is `\x y -> b`
+              if (auto* l = std::get_if<ELam>(&this->p[body])) {
+                auto inner = *l;
+                for (u32 k = 0; k < inner.params.len; ++k)
+                  params.push_back(this->p.at<VarRef>(inner.params, k));
+                body = inner.body;
+              }
+              return this->p.add(ELam{this->p.list(params), body}, ty);
+            },
+            [&](const ELet& x) -> ExprRef {
+              auto b = bind(x.var, x.rhs);
+              if (!b)
+                return expr(x.body);
+              return wrap({*b}, expr(x.body));
+            },
+            [&](const ELetRec& x) -> ExprRef {
+              auto binds = std::vector<Ref<Bind>>();
+              for (u32 k = 0; k < x.binds.len; ++k)
+                binds.push_back(this->p.at<Ref<Bind>>(x.binds, k));
+              return letrec(binds, x.body);
+            },
+            [&](const ECase& x) -> ExprRef {
+              return select(expr(x.scrut), x.bndr, x.alts, ty);
+            },
+            [&](const ECall& x) -> ExprRef {
+              auto args = list(x.args);
+              for (auto& a : args)
+                a = expr(a);
+              return this->p.add(ECall{x.ext, this->p.list(args)}, ty);
+            }},
+        static_cast<const Expr::variant&>(node));
+  }
+
+  void run() {
+    auto a = Analyser{this->p,
+                      std::vector<Occ>(this->p.vars.size()),
+                      std::vector<u32>(this->p.vars.size()),
+                      0,
+                      0,
+                      {},
+                      {},
+                      {}};
+    a.rec(this->p.top, ExprRef());
+    this->occ = std::move(a.occ);
+
+    // every top-level binding is kept, whatever its uses
+    auto top = std::vector<Bind>();
+    for (auto b : this->p.top) {
+      auto old = this->p[b];
+      top.push_back(Bind{rename(old.var), old.rhs});
+      at(this->inlinable, top.back().var) = !this->occ[old.var.i].loop;
+    }
+    this->p.top.clear();
+    for (auto& b : top) {
+      auto rhs                    = expr(b.rhs);
+      at(this->unfoldings, b.var) = rhs;
+      this->p.top.push_back(this->p.add(Bind{b.var, rhs}));
+    }
+  }
+};
+
+} // namespace
+
+Stats simplify(Program& p, const Budget& budget) {
+  auto stats = Stats();
+  while (stats.rounds < budget.rounds) {
+    auto before = stats.ticks();
+    auto s      = Simplifier{p,  budget, stats,
+                             budget.ticks > before ? budget.ticks - before : 0,
+                             {}, {},     {},    {},
+                             {}};
+    s.run();
+    p.compact();
+    ++stats.rounds;
+    if (stats.ticks() == before) {
+      stats.fixpoint = true;
+      break;
+    }
+    if (stats.ticks() >= budget.ticks)
+      break;
+  }
+  return stats;
+}
+
+} // namespace mangekyou::core
@@ -0,0 +1,64 @@
+#pragma once
+#include <prelude.hpp>
+
+#include "ir.hpp"
+
+/** the Core simplifier: local rewrites run over the whole program until
+ * none applies or the budget is spent.
+ *
+ * - inlining: a binding used once, and not under a lambda unless it is one,
+ *   is substituted at its use; atoms are substituted everywhere; a small
+ *   function is inlined into its saturated calls, smaller still when its
+ *   arguments are values it looks into. every recursive cycle has a loop
+ *   breaker, its biggest function, that is never inlined.
+ * - beta-reduction: `(\x -> b) a` is `let x = a in b`.
+ * - case of known constructor or literal: the matching alternative, its
+ *   variables bound to the fields.
+ * - case of case: the outer alternatives pushed into the inner ones, when
+ *   copying them is cheap.
+ * - dead bindings are dropped, as they are never evaluated.
+ *
+ * a round rebuilds the program from an occurrence analysis of the last
+ * one, binders are renamed on the way so inlined copies stay bound once.
+ * every rewrite costs a tick; once the budget's ticks are spent nothing is
+ * copied any more and the round finishes as a plain rebuild.
+ */
+namespace mangekyou::core {
+
+struct Budget {
+  /// rounds over the program at most
+  u32 rounds = 8;
+  /// rewrites over all rounds at most
+  u32 ticks = 100000;
+  /// a function body at most this big is inlined into a saturated call
+  u32 inline_size = 24;
+  /// taken off the body's size for each argument that is a value the body
+  /// scrutinises or calls
+  u32 discount = 8;
+};
+
+struct Stats {
+  u32 rounds = 0;
+  u32 inlined = 0;
+  u32 beta = 0;
+  /// case of known constructor or literal
+  u32 known = 0;
+  /// case of case, and of `let`
+  u32 case_of_case = 0;
+  u32 dead = 0;
+  /// the last round rewrote nothing
+  bool fixpoint = false;
+
+  u32 ticks() const {
+    return this->inlined + this->beta + this->known + this->case_of_case
+           + this->dead;
+  }
+};
+
+/// simplify `p` in place, compacted after every round
+Stats simplify(Program& p, const Budget& budget = {});
+
+/// the number of nodes of `e`, counting stops past `cap`
+u32 size(const Program& p, ExprRef e, u32 cap);
+
+} // namespace mangekyou::core
@@ -93,12 +93,12 @@ std::vector<TyVar> Type::tv() {
   return v;
 }
 
-auto Type::Unit = Type::Gen(0);
-auto Type::Char = Type::Con(name::FastString("Char"), Kind::Star());
-auto Type::Int = Type::Con(name::FastString("Int"), Kind::Star());
-auto Type::Integer = Type::Con(name::FastString("Integer"), Kind::Star());
-auto Type::Float = Type::Con(name::FastString("Float"), Kind::Star());
-auto Type::Double = Type::Con(name::FastString("Double"), Kind::Star());
+Rc<Type> Type::Unit = Type::Gen(0);
+Rc<Type> Type::Char = Type::Con(name::FastString("Char"), Kind::Star());
+Rc<Type> Type::Int = Type::Con(name::FastString("Int"), Kind::Star());
+Rc<Type> Type::Integer = Type::Con(name::FastString("Integer"), Kind::Star());
+Rc<Type> Type::Float = Type::Con(name::FastString("Float"), Kind::Star());
+Rc<Type> Type::Double = Type::Con(name::FastString("Double"), Kind::Star());
 
 // TODO
 // auto Type::List = Type::Con(FastString("[]"), Kind::Arrow());
@@ -0,0 +1,195 @@
+#include "worker.hpp"
+
+#include "prim.hpp"
+
+namespace mangekyou::core {
+
+option<u32> product(const Program& p, TypeRef ty) {
+  while (auto* app = std::get_if<TApp>(&p[ty]))
+    ty = app->lhs;
+  auto* head = std::get_if<TCon>(&p[ty]);
+  if (!head)
+    return {};
+  for (u32 t = 0; t < p.data.size(); ++t) {
+    auto& data = p.data[t];
+    if (data.name == head->id)
+      return data.cons.size() == 1 && !data.cons[0].fields.empty()
+                 ? option<u32>(t)
+                 : option<u32>();
+  }
+  return {};
+}
+
+namespace {
+
+struct Splitter {
+  Program& p;
+  Split& stats;
+
+  /// whether `l` only unpacks its parameters and calls a function with
+  /// them: a wrapper already, splitting it again gains nothing
+  bool wrapper(const ELam& l) const {
+    auto e = l.body;
+    while (auto* c = std::get_if<ECase>(&this->p[e])) {
+      auto* x = std::get_if<EVar>(&this->p[c->scrut]);
+      if (!x || c->alts.len != 1)
+        return false;
+      e = this->p[this->p.at<Ref<Alt>>(c->alts, 0)].rhs;
+    }
+    auto* a = std::get_if<EApp>(&this->p[e]);
+    return a && this->p[a->fn].is<EVar>();
+  }
+
+  /// `data[type]`'s constructor of type `ty` applied to `vars`
+  ExprRef con(u32 type, TypeRef ty, const std::vector<VarRef>& vars) {
+    auto fn = ty;
+    for (auto it = vars.rbegin(); it != vars.rend(); ++it)
+      fn = this->p.type(TFun{this->p[*it].ty, fn});
+    auto args = std::vector<ExprRef>();
+    for (auto v : vars)
+      args.push_back(this->p.add(EVar{v}, this->p[v].ty));
+    return this->p.add(EApp{this->p.add(ECon{type, 0}, fn),
+                            this->p.list(args)},
+                       ty);
+  }
+
+  /// turn `b` into a wrapper in place, and give its worker
+  option<Bind> split(const Bind& b) {
+    auto* l = std::get_if<ELam>(&this->p[b.rhs]);
+    if (!l || wrapper(*l))
+      return {};
+    auto lam   = *l;
+    auto boxes = std::vector<option<u32>>();
+    auto any   = false;
+    for (u32 k = 0; k < lam.params.len; ++k) {
+      auto& x = this->p[this->p.at<VarRef>(lam.params, k)];
+      boxes.push_back(x.strict ? product(this->p, x.ty) : option<u32>());
+      any |= boxes.back().has_value();
+    }
+    if (!any)
+      return {};
+    ++this->stats.functions;
+
+    // the worker takes the original parameters, or the fields of those it
+    // unboxes, and rebuilds the latter around the original body
+    auto wparams  = std::vector<VarRef>();
+    auto params   = std::vector<VarRef>();
+    auto args     = std::vector<ExprRef>();
+    auto unpacks  = std::vector<std::pair<VarRef, Alt>>();
+    auto body     = lam.body;
+    auto rebuilds = std::vector<std::pair<VarRef, ExprRef>>();
+    for (u32 k = 0; k < lam.params.len; ++k) {
+      auto x = this->p.at<VarRef>(lam.params, k);
+      auto y = this->p.clone(x);
+      params.push_back(y);
+      if (!boxes[k]) {
+        wparams.push_back(x);
+        args.push_back(this->p.add(EVar{y}, this->p[y].ty));
+        continue;
+      }
+      ++this->stats.unboxed;
+      auto t      = *boxes[k];
+      auto name   = this->p[x].name;
+      auto inner  = std::vector<VarRef>();
+      auto outer  = std::vector<VarRef>();
+      for (auto ty : this->p.fields(t, 0, this->p[x].ty)) {
+        // a machine value is always evaluated, and named `n#`
+        auto machine = rep(this->p, ty) != Rep::Boxed;
+        auto id      = machine ? Id(name.string() + "#") : name;
+        inner.push_back(this->p.add(Var{id, ty, machine}));
+        outer.push_back(this->p.add(Var{id, ty, machine}));
+        wparams.push_back(inner.back());
+        args.push_back(this->p.add(EVar{outer.back()}, ty));
+      }
+      rebuilds.emplace_back(x, con(t, this->p[x].ty, inner));
+      unpacks.emplace_back(
+          y, Alt{Alt::Con, t, 0, LitRef(), this->p.list(outer), ExprRef()});
+    }
+    for (auto it = rebuilds.rbegin(); it != rebuilds.rend(); ++it)
+      body = this->p.add(ELet{it->first, it->second, body},
+                         this->p.type_of(body));
+    auto wty = this->p.type_of(lam.body);
+    for (auto it = wparams.rbegin(); it != wparams.rend(); ++it)
+      wty = this->p.type(TFun{this->p[*it].ty, wty});
+    auto worker = this->p.add(
+        Var{name::Id("$w" + this->p[b.var].name.string()), wty});
+    auto wrhs = this->p.add(ELam{this->p.list(wparams), body}, wty);
+
+    // the wrapper evaluates and unpacks, then calls the worker
+    auto call = this->p.add(
+        EApp{this->p.add(EVar{worker}, wty), this->p.list(args)},
+        this->p.type_of(lam.body));
+    for (auto it = unpacks.rbegin(); it != unpacks.rend(); ++it) {
+      it->second.rhs = call;
+      auto alts      = std::vector<Ref<Alt>>{this->p.add(it->second)};
+      call           = this->p.add(
+          ECase{this->p.add(EVar{it->first}, this->p[it->first].ty),
+                VarRef(), this->p.list(alts)},
+          this->p.type_of(call));
+    }
+    this->p.exprs[b.rhs.i] = ELam{this->p.list(params), call};
+    return Bind{worker, wrhs};
+  }
+
+  /// the group `binds` with each split function followed by its worker
+  std::vector<Ref<Bind>> group(const std::vector<Ref<Bind>>& binds) {
+    auto out = std::vector<Ref<Bind>>();
+    for (auto r : binds) {
+      out.push_back(r);
+      if (auto w = split(this->p[r]))
+        out.push_back(this->p.add(*w));
+    }
+    return out;
+  }
+
+  void expr(ExprRef e) {
+    auto node = Expr(this->p[e]);
+    auto list = [&](Span s) {
+      for (u32 k = 0; k < s.len; ++k)
+        expr(this->p.at<ExprRef>(s, k));
+    };
+    std::visit(
+        overloaded{[](const EVar&) {}, [](const ELit&) {}, [](const ECon&) {},
+                   [](const EFail&) {},
+                   [&](const EApp& x) {
+                     expr(x.fn);
+                     list(x.args);
+                   },
+                   [&](const ELam& x) { expr(x.body); },
+                   [&](const ELet& x) {
+                     expr(x.rhs);
+                     expr(x.body);
+                   },
+                   [&](const ELetRec& x) {
+                     auto binds = std::vector<Ref<Bind>>();
+                     for (u32 k = 0; k < x.binds.len; ++k) {
+                       binds.push_back(this->p.at<Ref<Bind>>(x.binds, k));
+                       expr(this->p[binds.back()].rhs);
+                     }
+                     expr(x.body);
+                     auto out = group(binds);
+                     if (out.size() != binds.size())
+                       this->p.exprs[e.i] = ELetRec{this->p.list(out), x.body};
+                   },
+                   [&](const ECase& x) {
+                     expr(x.scrut);
+                     for (u32 k = 0; k < x.alts.len; ++k)
+                       expr(this->p[this->p.at<Ref<Alt>>(x.alts, k)].rhs);
+                   },
+                   [&](const ECall& x) { list(x.args); }},
+        static_cast<const Expr::variant&>(node));
+  }
+};
+
+} // namespace
+
+Split worker_wrapper(Program& p) {
+  auto stats = Split();
+  auto s     = Splitter{p, stats};
+  for (auto b : p.top)
+    s.expr(p[b].rhs);
+  p.top = s.group(p.top);
+  return stats;
+}
+
+} // namespace mangekyou::core
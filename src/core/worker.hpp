@@ -0,0 +1,40 @@
+#pragma once
+#include <prelude.hpp>
+
+#include "ir.hpp"
+
+/** the worker/wrapper split: a function strict in a parameter of a
+ * product type, a data type with one constructor, takes its fields
+ * instead.
+ *
+ *     f = \!p n -> body        -- p : Pair a b
+ *
+ * becomes a worker, which rebuilds `p` for the uses that want it whole,
+ * and a wrapper, which evaluates and unpacks it:
+ *
+ *     $wf = \x y n -> let p = Pair x y in body
+ *     f   = \!p n -> case p of { Pair x y -> $wf x y n }
+ *
+ * the wrapper is small, so the simplifier inlines it into every saturated
+ * call, the worker's own recursive calls included, where a constructor
+ * built for the call then meets its `case`: the loop runs on the fields
+ * and allocates no box per iteration. run after `strictness`, which marks
+ * the parameters, and before `simplify`, which does the rest.
+ */
+namespace mangekyou::core {
+
+struct Split {
+  /// functions split into a wrapper and a worker
+  u32 functions = 0;
+  /// parameters passed to a worker as their fields
+  u32 unboxed = 0;
+};
+
+/// split the functions of `p` bound at the top level or in a `letrec`
+Split worker_wrapper(Program& p);
+
+/// the data type of a value of `ty`, when it has one constructor and that
+/// has fields
+option<u32> product(const Program& p, TypeRef ty);
+
+} // namespace mangekyou::core
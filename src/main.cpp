@@ -1,24 +1,61 @@
+#include <charconv>
+#include <filesystem>
 #include <iostream>
-#include <set>
 #include <string>
+#include <vector>
 
-#include "core/type.hpp"
+#include "build/driver.hpp"
 
-int main() {
-  std::string* ptr1 = new std::string("foo");
-  std::string* ptr2 = new std::string("foo");
+using namespace mangekyou;
 
-  std::string& ref1 = *ptr1;
-  std::string& ref2 = *ptr2;
-  std::string* pref1 = &ref1;
-
-  std::string val1 = *ptr1;
-  std::string val2 = *ptr2;
+static int usage() {
+  std::cerr << "usage: mangekyou [-j jobs] [-I dir]... [--cache dir | "
+               "--no-cache] file.mk...\n";
+  return 2;
+}
 
-  std::cout << (ptr1 == ptr2) << '\n'; // false
-  std::cout << (ref1 == ref2) << '\n'; // true
-  std::cout << (val1 == val2) << '\n'; // true
-  std::cout << "-----\n";
+int main(int argc, char** argv) {
+  auto roots = std::vector<std::string>();
+  auto dirs  = std::vector<std::string>();
+  auto opts  = build::Options{.cache = ".mangekyou-cache"};
+  for (int i = 1; i < argc; ++i) {
+    auto arg = std::string_view(argv[i]);
+    if (arg == "-j" && i + 1 < argc) {
+      auto n   = std::string_view(argv[++i]);
+      auto res = std::from_chars(n.data(), n.data() + n.size(), opts.jobs);
+      if (res.ec != std::errc() || res.ptr != n.data() + n.size())
+        return usage();
+    } else if (arg == "-I" && i + 1 < argc) {
+      dirs.push_back(argv[++i]);
+    } else if (arg == "--cache" && i + 1 < argc) {
+      opts.cache = argv[++i];
+    } else if (arg == "--no-cache") {
+      opts.cache.clear();
+    } else if (arg.starts_with("-")) {
+      return usage();
+    } else {
+      roots.push_back(argv[i]);
+    }
+  }
+  if (roots.empty())
+    return usage();
+  // imports are also looked up next to the files given
+  for (auto& r : roots) {
+    auto dir = std::filesystem::path(r).parent_path();
+    dirs.push_back(dir.empty() ? "." : dir.string());
+  }
 
-  std::cout << ((std::string*)&ref1 == ptr1) << '\n'; // true
+  auto graph = build::Graph::load(roots, dirs);
+  if (!graph) {
+    std::cerr << graph.error() << '\n';
+    return 1;
+  }
+  if (auto order = graph->order(); !order) {
+    std::cerr << order.error() << '\n';
+    return 1;
+  }
+  auto report = build::compile(*graph, opts);
+  for (auto& e : report.errors)
+    std::cerr << e << '\n';
+  return report.ok() ? 0 : 1;
 }
@@ -0,0 +1,263 @@
+#include "ast.hpp"
+
+namespace mangekyou::ast {
+
+static_assert(sizeof(Expr) <= 24, "Expr nodes should stay three words");
+static_assert(sizeof(Type) <= 16, "Type nodes should stay two words");
+
+void Module::reserve(usize tokens) {
+  // guesses, not measurements: punctuation, keywords and layout tokens make
+  // no node, so at most about every other token is an expression; patterns,
+  // types and list elements are rarer. a wrong guess costs one regrowth
+  this->exprs.reserve(tokens / 2);
+  this->pats.reserve(tokens / 8);
+  this->types.reserve(tokens / 8);
+  this->expr_locs.reserve(tokens / 2);
+  this->pat_locs.reserve(tokens / 8);
+  this->type_locs.reserve(tokens / 8);
+  this->refs.reserve(tokens / 4);
+}
+
+Span Module::list(std::vector<u32>& scratch, usize mark) {
+  auto s = Span{static_cast<u32>(this->refs.size()),
+                static_cast<u32>(scratch.size() - mark)};
+  this->refs.insert(this->refs.end(), scratch.begin() + mark, scratch.end());
+  scratch.resize(mark);
+  return s;
+}
+
+namespace {
+/// pool sizes of a module before another one is appended to it
+struct Shift {
+  std::vector<u32>& refs;
+  u32 exprs, pats, types, decls, alts, cons, lits, list, names;
+
+  template <typename T>
+  void by(Ref<T>& r, u32 base) const {
+    if (r.valid())
+      r.i += base;
+  }
+  /// a list of refs into the pool at `base`
+  void by(Span& s, u32 base) const {
+    s.start += this->list;
+    for (u32 k = 0; k < s.len; ++k)
+      this->refs[s.start + k] += base;
+  }
+
+  void operator()(Expr& e) const {
+    std::visit(overloaded{[&](ELit& e) { by(e.lit, lits); },
+                          [](EVar&) {},
+                          [](ECon&) {},
+                          [&](EApp& e) {
+                            by(e.fn, exprs);
+                            by(e.arg, exprs);
+                          },
+                          [&](EOp& e) {
+                            by(e.op, names);
+                            by(e.lhs, exprs);
+                            by(e.rhs, exprs);
+                          },
+                          [&](ELam& e) {
+                            by(e.param, pats);
+                            by(e.ty, types);
+                            by(e.body, exprs);
+                          },
+                          [&](ELet& e) {
+                            by(e.items, decls);
+                            by(e.body, exprs);
+                          },
+                          [&](ECase& e) {
+                            by(e.scrut, exprs);
+                            by(e.alts, alts);
+                          },
+                          [&](ETuple& e) { by(e.elems, exprs); },
+                          [&](EAnn& e) {
+                            by(e.expr, exprs);
+                            by(e.ty, types);
+                          }},
+               static_cast<Expr::variant&>(e));
+  }
+  void operator()(Pat& p) const {
+    std::visit(overloaded{[](pat::PVar&) {},
+                          [](pat::PWildcard&) {},
+                          [&](pat::PAs& p) { by(p.pat, pats); },
+                          [&](pat::PLit& p) { by(p.lit, lits); },
+                          [&](pat::PCon& p) { by(p.args, pats); }},
+               static_cast<Pat::variant&>(p));
+  }
+  void operator()(Type& t) const {
+    std::visit(overloaded{[](TCon&) {},
+                          [](TVar&) {},
+                          [](TInfer&) {},
+                          [&](TApp& t) {
+                            by(t.lhs, types);
+                            by(t.rhs, types);
+                          },
+                          [&](TFun& t) {
+                            by(t.from, types);
+                            by(t.to, types);
+                          },
+                          [&](TTuple& t) { by(t.elems, types); }},
+               static_cast<Type::variant&>(t));
+  }
+  void operator()(Item& i) const {
+    std::visit(overloaded{[](OpDecl&) {},
+                          [&](TypeSig& i) { by(i.ty, types); },
+                          [&](FnDecl& i) {
+                            by(i.params, pats);
+                            by(i.body, exprs);
+                          },
+                          [&](DataDecl& i) {
+                            i.params.start += names;
+                            by(i.cons, cons);
+                          },
+                          [&](TypeSyn& i) {
+                            i.params.start += names;
+                            by(i.rhs, types);
+                          },
+                          [&](ExternDecl& i) { by(i.ty, types); }},
+               static_cast<Item::variant&>(i));
+  }
+  void operator()(Alt& a) const {
+    by(a.pat, pats);
+    by(a.body, exprs);
+  }
+  void operator()(DataCon& c) const { by(c.args, types); }
+};
+
+template <typename T>
+void move_pool(std::vector<T>& to, std::vector<T>& from, const Shift& shift) {
+  auto base = to.size();
+  to.insert(to.end(), from.begin(), from.end());
+  for (auto i = base; i < to.size(); ++i)
+    shift(to[i]);
+}
+} // namespace
+
+void Module::append(Module&& other) {
+  // every span owns its entries of `refs`, so each one is shifted once
+  auto shift = Shift{this->refs,
+                     static_cast<u32>(this->exprs.size()),
+                     static_cast<u32>(this->pats.size()),
+                     static_cast<u32>(this->types.size()),
+                     static_cast<u32>(this->decls.size()),
+                     static_cast<u32>(this->alts.size()),
+                     static_cast<u32>(this->cons.size()),
+                     static_cast<u32>(this->lits.size()),
+                     static_cast<u32>(this->refs.size()),
+                     static_cast<u32>(this->names.size())};
+  this->refs.insert(this->refs.end(), other.refs.begin(), other.refs.end());
+  this->names.insert(this->names.end(), other.names.begin(),
+                     other.names.end());
+  this->lits.insert(this->lits.end(), other.lits.begin(), other.lits.end());
+  // locations are global, they move as they are
+  for (auto [to, from] : {std::pair(&this->expr_locs, &other.expr_locs),
+                          std::pair(&this->pat_locs, &other.pat_locs),
+                          std::pair(&this->type_locs, &other.type_locs),
+                          std::pair(&this->decl_locs, &other.decl_locs)})
+    to->insert(to->end(), from->begin(), from->end());
+  move_pool(this->exprs, other.exprs, shift);
+  move_pool(this->pats, other.pats, shift);
+  move_pool(this->types, other.types, shift);
+  move_pool(this->decls, other.decls, shift);
+  move_pool(this->alts, other.alts, shift);
+  move_pool(this->cons, other.cons, shift);
+  for (auto item : other.items) {
+    shift.by(item, shift.decls);
+    this->items.push_back(item);
+  }
+  this->starts.insert(this->starts.end(), other.starts.begin(),
+                      other.starts.end());
+  // a chunk of a file may start within its imports
+  this->imports.insert(this->imports.end(), other.imports.begin(),
+                       other.imports.end());
+  this->arena.adopt(std::move(other.arena));
+}
+
+std::string Module::to_string(TypeRef r) const {
+  return std::visit(
+      overloaded{
+          [](const TCon& t) { return t.id.string(); },
+          [](const TVar& t) { return t.id.string(); },
+          [](const TInfer&) { return std::string("_"); },
+          [this](const TApp& t) {
+            return "(" + to_string(t.lhs) + " " + to_string(t.rhs) + ")";
+          },
+          [this](const TFun& t) {
+            return "(" + to_string(t.from) + " -> " + to_string(t.to) + ")";
+          },
+          [this](const TTuple& t) {
+            auto s = std::string("(");
+            for (u32 k = 0; k < t.elems.len; ++k)
+              s += (k ? ", " : "") + to_string(at<TypeRef>(t.elems, k));
+            return s + ")";
+          }},
+      static_cast<const Type::variant&>((*this)[r]));
+}
+
+std::string Module::to_string(PatRef r) const {
+  return std::visit(
+      overloaded{[](const pat::PVar& p) { return p.id.string(); },
+                 [](const pat::PWildcard&) { return std::string("_"); },
+                 [this](const pat::PAs& p) {
+                   return p.id.string() + "@" + to_string(p.pat);
+                 },
+                 [this](const pat::PLit& p) {
+                   return (*this)[p.lit].to_string();
+                 },
+                 [this](const pat::PCon& p) {
+                   if (p.args.len == 0)
+                     return p.con.string();
+                   auto s = "(" + p.con.string();
+                   for (u32 k = 0; k < p.args.len; ++k)
+                     s += " " + to_string(at<PatRef>(p.args, k));
+                   return s + ")";
+                 }},
+      static_cast<const Pat::variant&>((*this)[r]));
+}
+
+std::string Module::to_string(ExprRef r) const {
+  return std::visit(
+      overloaded{
+          [this](const ELit& e) { return (*this)[e.lit].to_string(); },
+          [](const EVar& e) { return e.id.string(); },
+          [](const ECon& e) { return e.id.string(); },
+          [this](const EApp& e) {
+            return "(" + to_string(e.fn) + " " + to_string(e.arg) + ")";
+          },
+          [this](const EOp& e) {
+            return "(" + to_string(e.lhs) + " " + (*this)[e.op].string() + " "
+                   + to_string(e.rhs) + ")";
+          },
+          [this](const ELam& e) {
+            auto p = to_string(e.param);
+            if (e.ty.valid())
+              p = "(" + p + " : " + to_string(e.ty) + ")";
+            return "(\\" + p + " -> " + to_string(e.body) + ")";
+          },
+          [this](const ELet& e) {
+            return "(let {" + std::to_string(e.items.len) + "} in "
+                   + to_string(e.body) + ")";
+          },
+          [this](const ECase& e) {
+            auto s = "(case " + to_string(e.scrut) + " of {";
+            for (u32 k = 0; k < e.alts.len; ++k) {
+              auto& alt = (*this)[at<Ref<Alt>>(e.alts, k)];
+              s += std::string(k ? "; " : " ") + to_string(alt.pat) + " -> "
+                   + to_string(alt.body);
+            }
+            return s + " })";
+          },
+          [this](const ETuple& e) {
+            auto s = std::string("(");
+            for (u32 k = 0; k < e.elems.len; ++k)
+              s += (k ? ", " : "") + to_string(at<ExprRef>(e.elems, k));
+            return s + ")";
+          },
+          [this](const EAnn& e) {
+            return "(" + to_string(e.expr) + " : " + to_string(e.ty) + ")";
+          }},
+      static_cast<const Expr::variant&>((*this)[r]));
+}
+
+} // namespace mangekyou::ast
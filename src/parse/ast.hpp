@@ -0,0 +1,280 @@
+#pragma once
+#include <arena.hpp>
+#include <prelude.hpp>
+#include <variant>
+#include <vector>
+
+#include "core/name.hpp"
+#include "core/pats.hpp"
+#include "location.hpp"
+
+/** surface syntax, see syntax.md § Parsing.
+ * nodes live in their `Module`'s pools and refer to each other with 32-bit
+ * `Ref`s; lists of children are `Span`s of `Module::refs`. everything is
+ * trivially destructible and goes away with the module in one shot.
+ * locations are kept next to the pools, not in the nodes.
+ */
+namespace mangekyou::ast {
+
+using name::Id;
+using parse::SourceLoc;
+using pat::Literal;
+using pat::Pat;
+using pat::PatRef;
+
+struct Type;
+struct Expr;
+struct Item;
+struct Alt;
+struct DataCon;
+using TypeRef = Ref<Type>;
+using ExprRef = Ref<Expr>;
+using ItemRef = Ref<Item>;
+using LitRef  = Ref<Literal>;
+
+/** Types */
+struct TCon {
+  Id id;
+};
+struct TVar {
+  Id id;
+};
+/// `_`, inferred
+struct TInfer {};
+struct TApp {
+  TypeRef lhs;
+  TypeRef rhs;
+};
+struct TFun {
+  TypeRef from;
+  TypeRef to;
+};
+/// `()` is the empty tuple, `elems` are `TypeRef`s
+struct TTuple {
+  Span elems;
+};
+
+struct Type : std::variant<TCon, TVar, TInfer, TApp, TFun, TTuple> {
+  using variant::variant;
+
+  template <typename T>
+  bool is() const {
+    return std::holds_alternative<T>(*this);
+  }
+};
+
+/** Expressions */
+struct ELit {
+  LitRef lit;
+};
+struct EVar {
+  Id id;
+};
+struct ECon {
+  Id id;
+};
+struct EApp {
+  ExprRef fn;
+  ExprRef arg;
+};
+/// binary operator application, fixity already resolved.
+/// `op` indexes `Module::names`, which keeps the node at 12 bytes
+struct EOp {
+  Ref<Id> op;
+  ExprRef lhs;
+  ExprRef rhs;
+};
+/// `\ pat -> body`, `\ (pat : ty) -> body`, `ty` may be invalid
+struct ELam {
+  PatRef param;
+  TypeRef ty;
+  ExprRef body;
+};
+/// `items` are `ItemRef`s
+struct ELet {
+  Span items;
+  ExprRef body;
+};
+struct Alt {
+  PatRef pat;
+  ExprRef body;
+};
+/// `alts` are `Ref<Alt>`s
+struct ECase {
+  ExprRef scrut;
+  Span alts;
+};
+/// `elems` are `ExprRef`s
+struct ETuple {
+  Span elems;
+};
+/// `e : ty`
+struct EAnn {
+  ExprRef expr;
+  TypeRef ty;
+};
+
+struct Expr
+    : std::variant<ELit, EVar, ECon, EApp, EOp, ELam, ELet, ECase, ETuple,
+                   EAnn> {
+  using variant::variant;
+
+  template <typename T>
+  bool is() const {
+    return std::holds_alternative<T>(*this);
+  }
+};
+
+/** Items */
+enum class Assoc : u8 { Left, Right, None };
+
+/// `infixl + 6`
+struct OpDecl {
+  Assoc assoc;
+  Id op;
+  u8 prec;
+};
+/// `f : ty`
+struct TypeSig {
+  Id id;
+  TypeRef ty;
+};
+/// `f p1 p2 = body`, `params` are `PatRef`s
+struct FnDecl {
+  Id id;
+  Span params;
+  ExprRef body;
+};
+/// `args` are `TypeRef`s
+struct DataCon {
+  Id id;
+  Span args;
+};
+/// `data T a = A a | B`, `params` index `Module::names`, `cons` are
+/// `Ref<DataCon>`s
+struct DataDecl {
+  Id id;
+  Span params;
+  Span cons;
+};
+/// `type T a = ty`, `params` index `Module::names`
+struct TypeSyn {
+  Id id;
+  Span params;
+  TypeRef rhs;
+};
+/// `extern f : ty`
+struct ExternDecl {
+  Id id;
+  TypeRef ty;
+};
+
+struct Item
+    : std::variant<OpDecl, TypeSig, FnDecl, DataDecl, TypeSyn, ExternDecl> {
+  using variant::variant;
+
+  template <typename T>
+  bool is() const {
+    return std::holds_alternative<T>(*this);
+  }
+};
+
+/// `import M`
+struct Import {
+  Id module;
+  SourceLoc at;
+};
+
+/// the per-module arena: one pool per node type
+struct Module {
+  /// `module M`, none when the file has no declaration
+  option<Id> name;
+  std::vector<Import> imports;
+  /// top level items
+  std::vector<ItemRef> items;
+  /// byte offset of each top level item's first token, parallel to `items`
+  std::vector<u32> starts;
+
+  std::vector<Expr> exprs;
+  std::vector<Pat> pats;
+  std::vector<Type> types;
+  std::vector<Item> decls;
+  std::vector<Alt> alts;
+  std::vector<DataCon> cons;
+  std::vector<Literal> lits;
+  /// child lists
+  std::vector<u32> refs;
+  std::vector<Id> names;
+  /// where each expression, pattern, type and item starts, parallel to
+  /// their pools
+  std::vector<SourceLoc> expr_locs;
+  std::vector<SourceLoc> pat_locs;
+  std::vector<SourceLoc> type_locs;
+  std::vector<SourceLoc> decl_locs;
+  /// decoded string literals and big integer limbs
+  Arena arena;
+
+  /// size the pools for about `tokens` tokens worth of nodes up front, so
+  /// they are not regrown while parsing
+  void reserve(usize tokens);
+
+  ExprRef add(const Expr& e, SourceLoc at) {
+    this->expr_locs.push_back(at);
+    return push(this->exprs, e);
+  }
+  PatRef add(const Pat& p, SourceLoc at) {
+    this->pat_locs.push_back(at);
+    return push(this->pats, p);
+  }
+  TypeRef add(const Type& t, SourceLoc at) {
+    this->type_locs.push_back(at);
+    return push(this->types, t);
+  }
+  ItemRef add(const Item& i, SourceLoc at) {
+    this->decl_locs.push_back(at);
+    return push(this->decls, i);
+  }
+  Ref<Alt> add(const Alt& a) { return push(this->alts, a); }
+  Ref<DataCon> add(const DataCon& c) { return push(this->cons, c); }
+  LitRef add(const Literal& l) { return push(this->lits, l); }
+  Ref<Id> add(const Id& id) { return push(this->names, id); }
+
+  const Expr& operator[](ExprRef r) const { return this->exprs[r.i]; }
+  const Pat& operator[](PatRef r) const { return this->pats[r.i]; }
+  const Type& operator[](TypeRef r) const { return this->types[r.i]; }
+  const Item& operator[](ItemRef r) const { return this->decls[r.i]; }
+  const Alt& operator[](Ref<Alt> r) const { return this->alts[r.i]; }
+  const DataCon& operator[](Ref<DataCon> r) const { return this->cons[r.i]; }
+  const Literal& operator[](LitRef r) const { return this->lits[r.i]; }
+  const Id& operator[](Ref<Id> r) const { return this->names[r.i]; }
+
+  SourceLoc loc(ExprRef r) const { return this->expr_locs[r.i]; }
+  SourceLoc loc(PatRef r) const { return this->pat_locs[r.i]; }
+  SourceLoc loc(TypeRef r) const { return this->type_locs[r.i]; }
+  SourceLoc loc(ItemRef r) const { return this->decl_locs[r.i]; }
+
+  /// `k`th child of a list
+  template <typename R>
+  R at(Span s, u32 k) const {
+    return R{this->refs[s.start + k]};
+  }
+  /// move `scratch[mark..]` into `refs`, truncating `scratch`
+  Span list(std::vector<u32>& scratch, usize mark);
+
+  /// move `other`'s nodes to the end of the pools, shifting every ref they
+  /// hold, and its top level items after ours
+  void append(Module&& other);
+
+  std::string to_string(ExprRef e) const;
+  std::string to_string(PatRef p) const;
+  std::string to_string(TypeRef t) const;
+
+private:
+  template <typename T>
+  static Ref<T> push(std::vector<T>& pool, const T& v) {
+    pool.push_back(v);
+    return Ref<T>{static_cast<u32>(pool.size() - 1)};
+  }
+};
+
+} // namespace mangekyou::ast
@@ -0,0 +1,34 @@
+#include "fixity.hpp"
+
+namespace mangekyou::parse {
+
+FixityTable FixityTable::collect(const TokenBuffer& toks) {
+  auto table = FixityTable();
+  for (u32 i = 0; i + 2 < toks.size(); ++i) {
+    auto assoc = ast::Assoc::None;
+    switch (toks.kind(i)) {
+    case TokenKind::KwInfixl: assoc = ast::Assoc::Left; break;
+    case TokenKind::KwInfixr: assoc = ast::Assoc::Right; break;
+    case TokenKind::KwInfix: assoc = ast::Assoc::None; break;
+    default: continue;
+    }
+    // `op` or `` `name` ``, then a single digit
+    u32 op = i + 1;
+    u32 n  = op + 1;
+    if (toks.kind(op) == TokenKind::Backtick && op + 2 < toks.size()
+        && toks.kind(op + 2) == TokenKind::Backtick) {
+      op += 1;
+      n += 2;
+    } else if (toks.kind(op) != TokenKind::Operator) {
+      continue;
+    }
+    if (n >= toks.size() || toks.kind(n) != TokenKind::IntLit
+        || toks.lengths[n] != 1)
+      continue;
+    auto prec = static_cast<u8>(toks.text(n)[0] - '0');
+    table.declare(toks.ident(op), Fixity{assoc, prec});
+  }
+  return table;
+}
+
+} // namespace mangekyou::parse
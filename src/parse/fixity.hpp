@@ -0,0 +1,34 @@
+#pragma once
+#include <prelude.hpp>
+#include <unordered_map>
+
+#include "ast.hpp"
+#include "tokens.hpp"
+
+namespace mangekyou::parse {
+
+struct Fixity {
+  ast::Assoc assoc;
+  u8 prec;
+};
+
+/// operator fixities, keyed by the interned operator
+struct FixityTable {
+  /// undeclared operators are `infixl 9`
+  static constexpr Fixity DEFAULT = {ast::Assoc::Left, 9};
+
+  std::unordered_map<name::Id, Fixity> ops;
+
+  void declare(name::Id op, Fixity f) { this->ops.insert_or_assign(op, f); }
+  Fixity lookup(const name::Id& op) const {
+    auto it = this->ops.find(op);
+    return it == this->ops.end() ? DEFAULT : it->second;
+  }
+
+  /// all `infix[lr] op n` declarations of a token stream, in one linear scan
+  /// over the kinds. running this before parsing lets operators be used
+  /// before their declaration while still resolving fixity in one pass.
+  static FixityTable collect(const TokenBuffer& toks);
+};
+
+} // namespace mangekyou::parse
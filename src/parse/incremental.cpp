@@ -0,0 +1,117 @@
+#include "incremental.hpp"
+
+#include <algorithm>
+
+#include "layout.hpp"
+
+namespace mangekyou::parse {
+
+PResult<Span> Document::parse() {
+  auto lexer     = Lexer(this->text);
+  auto toks      = Layout::run(lexer);
+  this->fixities = FixityTable::collect(toks);
+  this->reparsed = 0;
+  auto m         = Parser(toks, this->fixities).parse_module();
+  if (!m) {
+    this->stale = true;
+    return tl::make_unexpected(std::move(m.error()));
+  }
+  this->module = std::move(*m);
+  this->stale  = false;
+  return Span{0, static_cast<u32>(this->module.items.size())};
+}
+
+void Document::rebase_strings(uintptr_t old_base, usize old_size,
+                              const Edit& e) {
+  auto delta = static_cast<i64>(e.inserted.size()) - e.removed;
+  for (auto& lit : this->module.lits) {
+    auto* s = std::get_if<std::string_view>(&lit);
+    if (!s)
+      continue;
+    auto p = reinterpret_cast<uintptr_t>(s->data());
+    if (p < old_base || p >= old_base + old_size)
+      continue; // decoded into the arena
+    auto off = static_cast<i64>(p - old_base);
+    if (off >= e.offset + e.removed)
+      off += delta;
+    else if (off + static_cast<i64>(s->size()) > e.offset) {
+      // in a damaged item, about to be unreachable
+      *s = std::string_view();
+      continue;
+    }
+    *s = std::string_view(this->text.data() + off, s->size());
+  }
+}
+
+PResult<Span> Document::edit(const Edit& e) {
+  // editor events may be out of date, u64 so the end cannot wrap around
+  if (u64(e.offset) + e.removed > this->text.size())
+    return tl::make_unexpected(ParseError{
+        static_cast<u32>(std::min<usize>(e.offset, this->text.size())),
+        "edit of " + std::to_string(e.removed) + " bytes at "
+            + std::to_string(e.offset) + " is past the end of the text"});
+  auto old_base = reinterpret_cast<uintptr_t>(this->text.data());
+  auto old_size = this->text.size();
+  auto delta    = static_cast<i64>(e.inserted.size()) - e.removed;
+  this->text.replace(e.offset, e.removed, e.inserted);
+  // before anything can fail: the module outlives a failed reparse
+  rebase_strings(old_base, old_size, e);
+  if (this->stale || this->reparsed > this->text.size())
+    return parse();
+
+  auto& m      = this->module;
+  auto& starts = m.starts;
+  u32 n        = static_cast<u32>(starts.size());
+  // damaged: the items from the last one starting before the edit up to
+  // the last one starting inside it
+  auto lo   = std::lower_bound(starts.begin(), starts.end(), e.offset);
+  auto hi   = std::upper_bound(lo, starts.end(), e.offset + e.removed);
+  u32 first = static_cast<u32>(lo - starts.begin());
+  u32 last  = static_cast<u32>(hi - starts.begin());
+  first     = first > 0 ? first - 1 : 0;
+  // reparsing from the start of the file would read the header again
+  if (first == 0 && (m.name || !m.imports.empty()))
+    return parse();
+  for (u32 i = first; i < last; ++i)
+    if (m[m.items[i]].is<ast::OpDecl>())
+      return parse();
+
+  // the first undamaged item still starts a line, so the range ends there
+  u32 begin = first > 0 ? starts[first] : 0;
+  u32 end   = last < n ? static_cast<u32>(starts[last] + delta)
+                       : static_cast<u32>(this->text.size());
+  auto lexer = Lexer(std::string_view(this->text).substr(0, end));
+  lexer.pos  = begin;
+  auto toks  = Layout::run(lexer);
+  for (auto k : toks.kinds)
+    if (k == TokenKind::KwInfixl || k == TokenKind::KwInfixr
+        || k == TokenKind::KwInfix)
+      return parse();
+  auto fresh = Parser(toks, this->fixities).parse_module();
+  if (!fresh) {
+    this->stale = true;
+    return tl::make_unexpected(std::move(fresh.error()));
+  }
+  this->reparsed += end - begin;
+
+  for (u32 i = last; i < n; ++i)
+    starts[i] = static_cast<u32>(starts[i] + delta);
+  // so do the locations of every node after the edit, a document's base is 0
+  for (auto* locs : {&m.expr_locs, &m.pat_locs, &m.type_locs, &m.decl_locs})
+    for (auto& at : *locs)
+      if (at.raw >= e.offset + e.removed)
+        at.raw = static_cast<u32>(at.raw + delta);
+  // the fresh items land at the end: drop the damaged ones and rotate the
+  // fresh ones into their place
+  u32 count = static_cast<u32>(fresh->items.size());
+  m.append(std::move(*fresh));
+  auto splice = [&](auto& v) {
+    v.erase(v.begin() + first, v.begin() + last);
+    std::rotate(v.begin() + first, v.end() - count, v.end());
+  };
+  splice(m.items);
+  splice(starts);
+  return Span{first, count};
+}
+
+} // namespace mangekyou::parse
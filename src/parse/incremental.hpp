@@ -0,0 +1,59 @@
+#pragma once
+#include <prelude.hpp>
+#include <string>
+#include <string_view>
+
+#include "ast.hpp"
+#include "fixity.hpp"
+#include "parser.hpp"
+
+namespace mangekyou::parse {
+
+/// replace `removed` bytes at `offset` by `inserted`
+struct Edit {
+  u32 offset;
+  u32 removed;
+  std::string_view inserted;
+};
+
+/** a file open in an editor, reparsed item by item as it changes.
+ * an edit damages the top-level items whose text it touches, plus the one
+ * before when it lands right at an item's start (it may now continue that
+ * item's last line). only the damaged range is lexed and parsed again, in
+ * place: the fresh nodes are appended to `module`'s pools and spliced into
+ * `items`, every other node is kept as is.
+ *
+ * the dead nodes stay in the pools until they have cost about one file's
+ * worth of reparsing, then the whole file is parsed again from scratch. so
+ * are edits touching fixity declarations, which may change any item.
+ */
+struct Document {
+  std::string text;
+  ast::Module module;
+  FixityTable fixities;
+
+  explicit Document(std::string text)
+      : text(std::move(text))
+      , stale(true)
+      , reparsed(0) {}
+
+  /// parse all of `text`, the result spans every item of `module`
+  PResult<Span> parse();
+  /// apply `e` to `text` and reparse the items it damages. the result
+  /// indexes the replacing items in `module.items`. after an error `module`
+  /// is left as it was, but for the string literals of the damaged items,
+  /// which are emptied, and the next edit parses the whole file. an edit
+  /// reaching past the end of `text` fails and changes nothing
+  PResult<Span> edit(const Edit& e);
+
+private:
+  /// `module` does not describe `text`
+  bool stale;
+  /// bytes reparsed since the last full parse
+  usize reparsed;
+
+  /// re-point string literals that view `text` after it moved or shifted
+  void rebase_strings(uintptr_t old_base, usize old_size, const Edit& e);
+};
+
+} // namespace mangekyou::parse
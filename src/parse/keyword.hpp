@@ -0,0 +1,88 @@
+#pragma once
+#include <array>
+#include <prelude.hpp>
+#include <string_view>
+
+#include "token.hpp"
+
+/** reserved keywords and operators, recognised with a perfect hash built at
+ * compile time: classifying an identifier is one hash plus one compare.
+ */
+namespace mangekyou::parse::keyword {
+
+struct Entry {
+  std::string_view text;
+  TokenKind kind;
+};
+
+/// see syntax.md § Reserved keywords, § Operators
+inline constexpr Entry RESERVED[] = {
+    {"extern", TokenKind::KwExtern}, {"let", TokenKind::KwLet},
+    {"in", TokenKind::KwIn},         {"do", TokenKind::KwDo},
+    {"type", TokenKind::KwType},     {"deriving", TokenKind::KwDeriving},
+    {"via", TokenKind::KwVia},       {"for", TokenKind::KwFor},
+    {"infixr", TokenKind::KwInfixr}, {"infixl", TokenKind::KwInfixl},
+    {"infix", TokenKind::KwInfix},   {"data", TokenKind::KwData},
+    {"case", TokenKind::KwCase},     {"of", TokenKind::KwOf},
+    {"module", TokenKind::KwModule}, {"import", TokenKind::KwImport},
+    {"->", TokenKind::Arrow},        {":", TokenKind::Colon},
+    {"&", TokenKind::Amp},           {"!", TokenKind::Bang},
+    {"=", TokenKind::Equals},        {"@", TokenKind::At},
+    {"??", TokenKind::QQ},
+};
+
+inline constexpr u32 TABLE_BITS = 6;
+inline constexpr u32 TABLE_SIZE = 1 << TABLE_BITS;
+
+/// only looks at the length and the first and last bytes, which tell all of
+/// `RESERVED` apart. the length is kept clear of the first byte's bits:
+/// `let` and `import` would be the same otherwise
+constexpr u32 hash(std::string_view s, u32 seed) {
+  u32 h = seed ^ (static_cast<u32>(s.size()) << 8);
+  h     = (h ^ static_cast<u8>(s.front())) * 0x9E3779B1u;
+  h     = (h ^ static_cast<u8>(s.back())) * 0x85EBCA77u;
+  return h >> (32 - TABLE_BITS);
+}
+
+constexpr bool collides(u32 seed) {
+  auto used = std::array<bool, TABLE_SIZE>{};
+  for (auto& e : RESERVED) {
+    auto h = hash(e.text, seed);
+    if (used[h])
+      return true;
+    used[h] = true;
+  }
+  return false;
+}
+
+constexpr u32 find_seed() {
+  for (u32 seed = 0;; ++seed)
+    if (!collides(seed))
+      return seed;
+}
+
+inline constexpr u32 SEED = find_seed();
+
+/// slot -> index into `RESERVED`, -1 when empty
+constexpr std::array<i8, TABLE_SIZE> make_table() {
+  auto t = std::array<i8, TABLE_SIZE>{};
+  for (auto& i : t)
+    i = -1;
+  for (usize i = 0; i < std::size(RESERVED); ++i)
+    t[hash(RESERVED[i].text, SEED)] = static_cast<i8>(i);
+  return t;
+}
+
+inline constexpr std::array<i8, TABLE_SIZE> TABLE = make_table();
+
+/// the reserved kind of `s`, or `otherwise` (`VarId`/`Operator`)
+constexpr TokenKind classify(std::string_view s, TokenKind otherwise) {
+  if (s.empty())
+    return otherwise;
+  auto i = TABLE[hash(s, SEED)];
+  if (i < 0 || RESERVED[i].text != s)
+    return otherwise;
+  return RESERVED[i].kind;
+}
+
+} // namespace mangekyou::parse::keyword
@@ -0,0 +1,147 @@
+#include "layout.hpp"
+
+#include <cstring>
+
+namespace mangekyou::parse {
+
+Layout::Layout(Lexer& lexer)
+    : lexer(lexer)
+    , stack({Context{0, 0, false, false}})
+    , prev_end(lexer.pos)
+    , line_start(lexer.pos)
+    , depth(0)
+    , opening()
+    , started(false) {}
+
+/// pop the innermost implicit block, never the top level
+void Layout::close_implicit(u32 offset) {
+  emit(TokenKind::RBrace, offset);
+  this->stack.pop_back();
+}
+
+void Layout::handle(const Token& t) {
+  // the gap since the previous token is only trivia: its last newline, if
+  // any, starts the line of `t`
+  bool bol = !this->started;
+  if (t.offset > this->prev_end) {
+    auto* gap = this->lexer.src.data() + this->prev_end;
+    for (auto* p = gap + (t.offset - this->prev_end); p-- != gap;) {
+      if (*p == '\n') {
+        this->line_start = static_cast<u32>(p - this->lexer.src.data()) + 1;
+        bol              = true;
+        break;
+      }
+    }
+  }
+  this->prev_end = t.offset + t.length;
+  u32 col        = t.offset - this->line_start;
+  bool eof       = t.is(TokenKind::Eof);
+
+  if (this->opening) {
+    bool is_let = *this->opening;
+    this->opening.reset();
+    if (t.is(TokenKind::LBrace)) {
+      this->stack.push_back(Context{0, this->depth, true, is_let});
+      this->pending.push_back(t);
+      this->started = true;
+      return;
+    }
+    u32 enclosing = 0;
+    for (auto it = this->stack.rbegin(); it != this->stack.rend(); ++it) {
+      if (!it->is_explicit) {
+        enclosing = it->col;
+        break;
+      }
+    }
+    emit(TokenKind::LBrace, t.offset);
+    if (!eof && col > enclosing) {
+      this->stack.push_back(Context{col, this->depth, false, is_let});
+      bol = false;
+    } else {
+      emit(TokenKind::RBrace, t.offset);
+    }
+  }
+
+  if (eof) {
+    while (this->stack.size() > 1 && !this->stack.back().is_explicit)
+      close_implicit(t.offset);
+    this->pending.push_back(t);
+    return;
+  }
+
+  if (bol && !this->stack.back().is_explicit) {
+    while (this->stack.size() > 1 && !this->stack.back().is_explicit
+           && col < this->stack.back().col)
+      close_implicit(t.offset);
+    auto& top = this->stack.back();
+    if (!top.is_explicit && col == top.col && this->started)
+      emit(TokenKind::Semi, t.offset);
+  }
+
+  switch (t.kind) {
+  case TokenKind::LParen:
+  case TokenKind::LBracket: ++this->depth; break;
+  case TokenKind::RParen:
+  case TokenKind::RBracket:
+  case TokenKind::Comma:
+    // a bracket or comma belonging to an enclosing expression ends the
+    // blocks opened inside it: `(case x of A -> 1, 2)`
+    while (this->stack.size() > 1 && !this->stack.back().is_explicit
+           && this->stack.back().depth == this->depth && this->depth > 0)
+      close_implicit(t.offset);
+    if (!t.is(TokenKind::Comma) && this->depth > 0)
+      --this->depth;
+    break;
+  case TokenKind::RBrace:
+    while (this->stack.size() > 1 && !this->stack.back().is_explicit)
+      close_implicit(t.offset);
+    if (this->stack.size() > 1)
+      this->stack.pop_back();
+    break;
+  case TokenKind::KwIn: {
+    // `let x = 1 in x`, and the blocks opened in the binding that are still
+    // open: `let x = case y of A -> 1 in x`
+    auto let = this->stack.size();
+    for (auto k = this->stack.size(); k-- > 1;) {
+      auto& c = this->stack[k];
+      if (c.is_explicit || c.depth != this->depth)
+        break;
+      if (c.is_let) {
+        let = k;
+        break;
+      }
+    }
+    while (this->stack.size() > let)
+      close_implicit(t.offset);
+    break;
+  }
+  case TokenKind::KwLet: this->opening = true; break;
+  case TokenKind::KwOf:
+  case TokenKind::KwDo: this->opening = false; break;
+  default: break;
+  }
+  this->pending.push_back(t);
+  this->started = true;
+}
+
+Token Layout::next() {
+  while (this->pending.empty())
+    handle(this->lexer.next());
+  auto t = this->pending.front();
+  this->pending.pop_front();
+  return t;
+}
+
+TokenBuffer Layout::run(Lexer& lexer) {
+  auto layout = Layout(lexer);
+  auto toks   = TokenBuffer(lexer.src);
+  toks.reserve((lexer.src.size() - lexer.pos) / 4 + 1);
+  for (;;) {
+    auto t = layout.next();
+    toks.push(t);
+    if (t.is(TokenKind::Eof))
+      return toks;
+  }
+}
+
+} // namespace mangekyou::parse
@@ -0,0 +1,63 @@
+#pragma once
+#include <deque>
+#include <prelude.hpp>
+#include <vector>
+
+#include "lexer.hpp"
+#include "tokens.hpp"
+
+namespace mangekyou::parse {
+
+/** the layout rule, as a filter between the lexer and the parser.
+ * `let`, `of` and `do` open a block: unless followed by an explicit `{`, the
+ * column of the next token is pushed and a virtual `{` emitted. a line
+ * starting at that column gets a virtual `;`, one starting left of it closes
+ * the block with a virtual `}`. top-level items are a block at column 0,
+ * separated by `;` but without braces.
+ *
+ * virtual tokens have length 0. every lexer token is handled once, with a
+ * constant amount of work besides popping the context stack, and nothing is
+ * ever un-read.
+ */
+struct Layout {
+  explicit Layout(Lexer& lexer);
+
+  Token next();
+
+  /// lex all of `lexer` through the layout rule. `lexer` may start in the
+  /// middle of its buffer, at the beginning of a line
+  static TokenBuffer run(Lexer& lexer);
+
+  static bool is_virtual(const Token& t) {
+    return t.length == 0 && !t.is(TokenKind::Eof);
+  }
+
+private:
+  struct Context {
+    /// 0 for explicit `{ }`
+    u32 col;
+    /// `(`/`[` nesting when the block was opened
+    u32 depth;
+    bool is_explicit;
+    bool is_let;
+  };
+
+  Lexer& lexer;
+  std::vector<Context> stack;
+  std::deque<Token> pending;
+  /// end of the previous token and start of its line
+  u32 prev_end;
+  u32 line_start;
+  u32 depth;
+  /// set after `let`/`of`/`do`, holds whether it was `let`
+  option<bool> opening;
+  bool started;
+
+  void emit(TokenKind k, u32 offset) {
+    this->pending.emplace_back(k, offset, 0);
+  }
+  void close_implicit(u32 offset);
+  void handle(const Token& t);
+};
+
+} // namespace mangekyou::parse
@@ -0,0 +1,206 @@
+#include "lexer.hpp"
+#include "keyword.hpp"
+#include "scan.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace mangekyou::parse {
+
+using namespace scan;
+
+std::string to_string(TokenKind k) {
+  switch (k) {
+  case TokenKind::Eof: return "Eof";
+  case TokenKind::Error: return "Error";
+  case TokenKind::VarId: return "VarId";
+  case TokenKind::ConId: return "ConId";
+  case TokenKind::Underscore: return "Underscore";
+  case TokenKind::Operator: return "Operator";
+  case TokenKind::IntLit: return "IntLit";
+  case TokenKind::DecLit: return "DecLit";
+  case TokenKind::HexLit: return "HexLit";
+  case TokenKind::OctLit: return "OctLit";
+  case TokenKind::BinLit: return "BinLit";
+  case TokenKind::CharLit: return "CharLit";
+  case TokenKind::StringLit: return "StringLit";
+  case TokenKind::LParen: return "LParen";
+  case TokenKind::RParen: return "RParen";
+  case TokenKind::LBracket: return "LBracket";
+  case TokenKind::RBracket: return "RBracket";
+  case TokenKind::LBrace: return "LBrace";
+  case TokenKind::RBrace: return "RBrace";
+  case TokenKind::Comma: return "Comma";
+  case TokenKind::Semi: return "Semi";
+  case TokenKind::Backtick: return "Backtick";
+  case TokenKind::Backslash: return "Backslash";
+  case TokenKind::KwExtern: return "KwExtern";
+  case TokenKind::KwLet: return "KwLet";
+  case TokenKind::KwIn: return "KwIn";
+  case TokenKind::KwDo: return "KwDo";
+  case TokenKind::KwType: return "KwType";
+  case TokenKind::KwDeriving: return "KwDeriving";
+  case TokenKind::KwVia: return "KwVia";
+  case TokenKind::KwFor: return "KwFor";
+  case TokenKind::KwInfixr: return "KwInfixr";
+  case TokenKind::KwInfixl: return "KwInfixl";
+  case TokenKind::KwInfix: return "KwInfix";
+  case TokenKind::KwData: return "KwData";
+  case TokenKind::KwCase: return "KwCase";
+  case TokenKind::KwOf: return "KwOf";
+  case TokenKind::KwModule: return "KwModule";
+  case TokenKind::KwImport: return "KwImport";
+  case TokenKind::Arrow: return "Arrow";
+  case TokenKind::Colon: return "Colon";
+  case TokenKind::Amp: return "Amp";
+  case TokenKind::Bang: return "Bang";
+  case TokenKind::Equals: return "Equals";
+  case TokenKind::At: return "At";
+  case TokenKind::QQ: return "QQ";
+  }
+  return "?";
+}
+
+void Lexer::skip_trivia() {
+  const char* p   = this->src.data() + this->pos;
+  const char* end = this->src.data() + this->src.size();
+  for (;;) {
+    // single separating spaces are the common case, don't pay for a kernel
+    if (p < end && is(*p, C_SPACE) && ++p < end && is(*p, C_SPACE))
+      p = skip_space(p + 1, end);
+    if (end - p >= 2 && p[0] == '/' && p[1] == '/') {
+      auto nl = static_cast<const char*>(std::memchr(p, '\n', end - p));
+      p       = nl ? nl + 1 : end;
+      continue;
+    }
+    break;
+  }
+  this->pos = static_cast<u32>(p - this->src.data());
+}
+
+static bool is_digit_of(char c, TokenKind k) {
+  switch (k) {
+  case TokenKind::HexLit:
+    return is(c, C_DIGIT) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+  case TokenKind::OctLit: return c >= '0' && c <= '7';
+  case TokenKind::BinLit: return c == '0' || c == '1';
+  default: return is(c, C_DIGIT);
+  }
+}
+
+Token Lexer::number() {
+  const char* base = this->src.data();
+  const char* end  = base + this->src.size();
+  const char* p    = base + this->pos;
+  u32 start        = this->pos;
+
+  auto k = TokenKind::IntLit;
+  if (p[0] == '0' && end - p >= 3) {
+    switch (p[1]) {
+    case 'x': k = TokenKind::HexLit; break;
+    case 'o': k = TokenKind::OctLit; break;
+    case 'b': k = TokenKind::BinLit; break;
+    }
+    if (k != TokenKind::IntLit && is_digit_of(p[2], k))
+      p += 2;
+    else
+      k = TokenKind::IntLit;
+  }
+  while (p < end && is_digit_of(*p, k))
+    ++p;
+  if (k == TokenKind::IntLit && end - p >= 2 && p[0] == '.'
+      && is(p[1], C_DIGIT)) {
+    k = TokenKind::DecLit;
+    p += 1;
+    while (p < end && is(*p, C_DIGIT))
+      ++p;
+  }
+  this->pos = static_cast<u32>(p - base);
+  return make(k, start);
+}
+
+Token Lexer::quoted(char delim, TokenKind k) {
+  u32 start       = this->pos;
+  const char* end = this->src.data() + this->src.size();
+  const char* p   = this->src.data() + start + 1;
+  for (;;) {
+    p = find_either(p, end, delim, '\\');
+    if (p >= end) {
+      this->pos = static_cast<u32>(this->src.size());
+      return make(TokenKind::Error, start);
+    }
+    if (*p == delim)
+      break;
+    // the escaped byte, unless the `\` is the last one of the source
+    p += std::min<std::ptrdiff_t>(2, end - p);
+  }
+  this->pos = static_cast<u32>(p + 1 - this->src.data());
+  return make(k, start);
+}
+
+Token Lexer::next() {
+  skip_trivia();
+  u32 start = this->pos;
+  if (start >= this->src.size())
+    return Token(TokenKind::Eof, start, 0);
+
+  const char* p   = this->src.data() + start;
+  const char* end = this->src.data() + this->src.size();
+  char c          = *p;
+  u8 cls          = CLASS_TABLE[static_cast<u8>(c)];
+
+  if (cls & C_DIGIT)
+    return number();
+  if (cls & C_IDENT) {
+    this->pos = static_cast<u32>(skip_ident(p + 1, end) - this->src.data());
+    if (cls & C_UPPER)
+      return make(TokenKind::ConId, start);
+    if (c == '_' && this->pos == start + 1)
+      return make(TokenKind::Underscore, start);
+    auto t = make(TokenKind::VarId, start);
+    t.kind = keyword::classify(text(t), TokenKind::VarId);
+    return t;
+  }
+  if (cls & C_OPSYM) {
+    ++p;
+    while (p < end && is(*p, C_OPSYM))
+      ++p;
+    this->pos = static_cast<u32>(p - this->src.data());
+    auto t    = make(TokenKind::Operator, start);
+    t.kind    = keyword::classify(text(t), TokenKind::Operator);
+    return t;
+  }
+
+  this->pos += 1;
+  switch (c) {
+  case '(': return make(TokenKind::LParen, start);
+  case ')': return make(TokenKind::RParen, start);
+  case '[': return make(TokenKind::LBracket, start);
+  case ']': return make(TokenKind::RBracket, start);
+  case '{': return make(TokenKind::LBrace, start);
+  case '}': return make(TokenKind::RBrace, start);
+  case ',': return make(TokenKind::Comma, start);
+  case ';': return make(TokenKind::Semi, start);
+  case '`': return make(TokenKind::Backtick, start);
+  case '\\': return make(TokenKind::Backslash, start);
+  case '\'': this->pos = start; return quoted('\'', TokenKind::CharLit);
+  case '"': this->pos = start; return quoted('"', TokenKind::StringLit);
+  default: return make(TokenKind::Error, start);
+  }
+}
+
+TokenBuffer Lexer::lex() {
+  auto toks = TokenBuffer(this->src);
+  // the token arrays are the lexer's only allocations: size them once from an
+  // upper-ish bound (~1 token per 4 bytes), untouched pages are never faulted
+  // in. dense inputs still regrow geometrically.
+  toks.reserve(this->src.size() / 4 + 1);
+  for (;;) {
+    auto t = next();
+    toks.push(t);
+    if (t.is(TokenKind::Eof))
+      return toks;
+  }
+}
+
+} // namespace mangekyou::parse
@@ -0,0 +1,47 @@
+#pragma once
+#include <prelude.hpp>
+#include <string_view>
+#include <vector>
+
+#include "core/name.hpp"
+#include "source.hpp"
+#include "token.hpp"
+#include "tokens.hpp"
+
+namespace mangekyou::parse {
+
+/// on-demand lexer over a source buffer, see syntax.md § Lexer.
+/// whitespace, comments and identifier runs are skipped with `scan`.
+/// tokens are plain (kind, offset, length) triples into `src`: nothing is
+/// copied or interned until the parser asks for it.
+struct Lexer {
+  std::string_view src;
+  u32 pos;
+
+  explicit Lexer(std::string_view src)
+      : src(src)
+      , pos(0) {}
+  explicit Lexer(const Source& src)
+      : Lexer(src.text()) {}
+
+  /// next token, `Eof` forever once the input is exhausted
+  Token next();
+  /// lex the whole buffer, the last token is always `Eof`
+  TokenBuffer lex();
+
+  std::string_view text(const Token& t) const {
+    return this->src.substr(t.offset, t.length);
+  }
+  /// intern an identifier/operator token, lazily
+  name::Id ident(const Token& t) const { return name::Id(text(t)); }
+
+private:
+  void skip_trivia();
+  Token number();
+  Token quoted(char delim, TokenKind k);
+  Token make(TokenKind k, u32 start) const {
+    return Token(k, start, this->pos - start);
+  }
+};
+
+} // namespace mangekyou::parse
@@ -0,0 +1,25 @@
+#include "lines.hpp"
+
+#include <algorithm>
+
+#include "scan.hpp"
+
+namespace mangekyou::parse {
+
+LineIndex::LineIndex(std::string_view text)
+    : starts{0} {
+  // one line per 32 bytes, a guess that leans short so that most files fit
+  // without regrowing; longer lines only leave some capacity unused
+  this->starts.reserve(text.size() / 32 + 1);
+  scan::line_starts(text.data(), text.data() + text.size(), text.data(),
+                    this->starts);
+}
+
+LineCol LineIndex::lookup(u32 offset) const {
+  auto& s   = this->starts;
+  auto line = static_cast<u32>(std::upper_bound(s.begin(), s.end(), offset)
+                               - s.begin());
+  return LineCol{line, offset - s[line - 1] + 1};
+}
+
+} // namespace mangekyou::parse
@@ -0,0 +1,29 @@
+#pragma once
+#include <prelude.hpp>
+#include <string_view>
+#include <vector>
+
+namespace mangekyou::parse {
+
+/// 1-based, `col` counts bytes
+struct LineCol {
+  u32 line;
+  u32 col;
+};
+
+/// offset of every line start of a file, found with one vectorized pass over
+/// it. tokens and errors only carry byte offsets: a line and column is only
+/// ever computed when a diagnostic is printed, by binary search.
+struct LineIndex {
+  /// `starts[0]` is 0
+  std::vector<u32> starts;
+
+  LineIndex()
+      : starts{0} {}
+  explicit LineIndex(std::string_view text);
+
+  LineCol lookup(u32 offset) const;
+  u32 lines() const { return static_cast<u32>(this->starts.size()); }
+};
+
+} // namespace mangekyou::parse
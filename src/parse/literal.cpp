@@ -0,0 +1,213 @@
+#include "literal.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+
+namespace mangekyou::parse::literal {
+
+Integer::Integer(u64 v) {
+  while (v) {
+    this->limbs.push_back(static_cast<u32>(v));
+    v >>= 32;
+  }
+}
+
+void Integer::mul_add(u64 m, u32 a) {
+  u64 carry = a;
+  for (auto& l : this->limbs) {
+    u64 prod = static_cast<u64>(l) * m + carry;
+    l        = static_cast<u32>(prod);
+    carry    = prod >> 32;
+  }
+  if (carry)
+    this->limbs.push_back(static_cast<u32>(carry));
+}
+
+std::string Integer::to_string() const {
+  if (this->limbs.empty())
+    return "0";
+  // peel off base 10^9 digits, most significant limb first
+  auto ls     = this->limbs;
+  auto chunks = std::vector<u32>();
+  while (!ls.empty()) {
+    u64 rem = 0;
+    for (auto it = ls.rbegin(); it != ls.rend(); ++it) {
+      u64 cur = (rem << 32) | *it;
+      *it     = static_cast<u32>(cur / 1000000000);
+      rem     = cur % 1000000000;
+    }
+    chunks.push_back(static_cast<u32>(rem));
+    while (!ls.empty() && ls.back() == 0)
+      ls.pop_back();
+  }
+  auto s = std::to_string(chunks.back());
+  for (auto it = chunks.rbegin() + 1; it != chunks.rend(); ++it) {
+    auto c = std::to_string(*it);
+    s += std::string(9 - c.size(), '0') + c;
+  }
+  return s;
+}
+
+/* each step merges neighbouring lanes: lane' = hi_lane * base^k + lo_lane,
+ * first with 8-bit lanes, then 16, then 32.
+ */
+u32 swar8(u64 x, u32 base) {
+  if (base == 16) {
+    // '0'-'9' -> 0-9, 'a'-'f'/'A'-'F' -> 10-15 (bit 6 marks letters)
+    x = (x & 0x0F0F0F0F0F0F0F0F) + 9 * ((x >> 6) & 0x0101010101010101);
+  } else {
+    x -= 0x3030303030303030;
+  }
+  u64 b2 = base * base;
+  x      = (x * base + (x >> 8)) & 0x00FF00FF00FF00FF;
+  x      = (x * b2 + (x >> 16)) & 0x0000FFFF0000FFFF;
+  x      = (x * (b2 * b2) + (x >> 32)) & 0xFFFFFFFF;
+  return static_cast<u32>(x);
+}
+
+static u32 base_of(TokenKind k) {
+  switch (k) {
+  case TokenKind::HexLit: return 16;
+  case TokenKind::OctLit: return 8;
+  case TokenKind::BinLit: return 2;
+  default: return 10;
+  }
+}
+
+static u32 digit(char c) {
+  return c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10;
+}
+
+IntValue parse_int(std::string_view text, TokenKind k) {
+  u32 base = base_of(k);
+  if (base != 10)
+    text.remove_prefix(2);
+
+  u64 chunk_mul = base;
+  for (int i = 1; i < 8; ++i)
+    chunk_mul *= base;
+
+  // the leading `size % 8` digits first, so the rest are whole chunks
+  u64 acc = 0;
+  usize i = 0;
+  for (; i < text.size() % 8; ++i)
+    acc = acc * base + digit(text[i]);
+
+  for (; i < text.size(); i += 8) {
+    u64 chunk;
+    std::memcpy(&chunk, text.data() + i, 8);
+    u32 v = swar8(chunk, base);
+    u64 next;
+    if (__builtin_mul_overflow(acc, chunk_mul, &next)
+        || __builtin_add_overflow(next, v, &next)) {
+      auto big = Integer(acc);
+      big.mul_add(chunk_mul, v);
+      for (i += 8; i < text.size(); i += 8) {
+        std::memcpy(&chunk, text.data() + i, 8);
+        big.mul_add(chunk_mul, swar8(chunk, base));
+      }
+      return big;
+    }
+    acc = next;
+  }
+  return acc;
+}
+
+static constexpr double POW10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+double parse_dec(std::string_view text) {
+  auto dot    = text.find('.');
+  auto whole  = text.substr(0, dot);
+  auto frac   = text.substr(dot + 1);
+  auto digits = whole.size() + frac.size();
+
+  // Clinger's fast path: mantissa and 10^frac are both exact doubles, so a
+  // single division is correctly rounded
+  if (digits <= 19 && frac.size() <= 22) {
+    u64 m = 0;
+    for (char c : whole)
+      m = m * 10 + (c - '0');
+    usize j = 0;
+    for (; j + 8 <= frac.size(); j += 8) {
+      u64 chunk;
+      std::memcpy(&chunk, frac.data() + j, 8);
+      m = m * 100000000 + swar8(chunk, 10);
+    }
+    for (; j < frac.size(); ++j)
+      m = m * 10 + (frac[j] - '0');
+    if (m <= (u64(1) << 53))
+      return static_cast<double>(m) / POW10[frac.size()];
+  }
+  // standard libraries implement Eisel-Lemire with a correct fallback here
+  double d = 0;
+  std::from_chars(text.data(), text.data() + text.size(), d);
+  return d;
+}
+
+static option<char> unescape(char c) {
+  switch (c) {
+  case '\\': return '\\';
+  case '"': return '"';
+  case '\'': return '\'';
+  case 'n': return '\n';
+  case 'r': return '\r';
+  case '0': return '\0';
+  case 't': return '\t';
+  default: return {};
+  }
+}
+
+static tl::unexpected<string> bad_escape(char c) {
+  return tl::make_unexpected("invalid escape sequence `\\" + string(1, c)
+                             + "`");
+}
+
+tl::expected<std::string_view, string> decode_string(std::string_view text,
+                                                     Arena& arena) {
+  auto body       = text.substr(1, text.size() - 2);
+  const char* p   = body.data();
+  const char* end = p + body.size();
+  auto backslash  = [end](const char* from) {
+    auto* bs = std::memchr(from, '\\', end - from);
+    return bs ? static_cast<const char*>(bs) : end;
+  };
+  // memchr is the vectorized scan here
+  const char* bs = backslash(p);
+  if (bs == end)
+    return body;
+
+  // escapes only shrink the string: decode straight into the arena
+  auto* out = static_cast<char*>(arena.alloc(body.size(), 1));
+  usize n   = 0;
+  while (bs < end) {
+    std::memcpy(out + n, p, bs - p);
+    n += bs - p;
+    auto c = unescape(bs[1]);
+    if (!c)
+      return bad_escape(bs[1]);
+    out[n++] = *c;
+    p        = bs + 2;
+    bs       = backslash(p);
+  }
+  std::memcpy(out + n, p, end - p);
+  n += end - p;
+  return std::string_view(out, n);
+}
+
+tl::expected<char, string> decode_char(std::string_view text) {
+  auto body = text.substr(1, text.size() - 2);
+  if (body.size() == 1 && body[0] != '\\')
+    return body[0];
+  if (body.size() == 2 && body[0] == '\\') {
+    if (auto c = unescape(body[1]))
+      return *c;
+    return bad_escape(body[1]);
+  }
+  return tl::make_unexpected("character literal must hold exactly one "
+                             "character");
+}
+
+} // namespace mangekyou::parse::literal
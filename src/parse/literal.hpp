@@ -0,0 +1,54 @@
+#pragma once
+#include <arena.hpp>
+#include <expected>
+#include <prelude.hpp>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include "token.hpp"
+
+/** decoding of literal tokens (syntax.md § Literals). digits are converted
+ * eight at a time with SWAR arithmetic on a single `u64` load; strings stay
+ * views into the source unless they contain escapes.
+ */
+namespace mangekyou::parse::literal {
+
+/// arbitrary precision natural number, for literals that overflow `u64`
+/// and end up typed as `Integer`
+struct Integer {
+  /// little-endian base 2^32 digits, no leading zero limbs
+  std::vector<u32> limbs;
+
+  Integer() {}
+  explicit Integer(u64 v);
+
+  /// `*this = *this * m + a`, `m` at most 2^32
+  void mul_add(u64 m, u32 a);
+
+  bool operator==(const Integer& other) const {
+    return this->limbs == other.limbs;
+  }
+  std::string to_string() const;
+};
+
+using IntValue = std::variant<u64, Integer>;
+
+/// value of an `IntLit`/`HexLit`/`OctLit`/`BinLit` token's text
+IntValue parse_int(std::string_view text, TokenKind k);
+/// value of a `DecLit` token's text, correctly rounded
+double parse_dec(std::string_view text);
+
+/// contents of a `StringLit` token's text. without escapes this is a view
+/// into the token itself, otherwise the decoded string is copied into
+/// `arena` once.
+tl::expected<std::string_view, string> decode_string(std::string_view text,
+                                                     Arena& arena);
+/// value of a `CharLit` token's text
+tl::expected<char, string> decode_char(std::string_view text);
+
+/// eight ASCII digits of `base` (2, 8, 10 or 16), first digit in the lowest
+/// byte, to their value
+u32 swar8(u64 chunk, u32 base);
+
+} // namespace mangekyou::parse::literal
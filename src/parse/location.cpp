@@ -0,0 +1,34 @@
+#include "location.hpp"
+
+#include <algorithm>
+
+namespace mangekyou::parse {
+
+tl::expected<u32, string> SourceManager::add(Rc<Source> src) {
+  auto size = src->text().size() + 1;
+  if (size > SourceLoc::NONE - this->next)
+    return tl::make_unexpected("too much source to load `" + src->path + "`");
+  auto base = this->next;
+  this->next += static_cast<u32>(size);
+  this->bases.push_back(base);
+  this->files.push_back(std::move(src));
+  return base;
+}
+
+FullLoc SourceManager::resolve(SourceLoc loc) const {
+  auto it = std::upper_bound(this->bases.begin(), this->bases.end(), loc.raw);
+  auto k  = static_cast<usize>(it - this->bases.begin()) - 1;
+  auto& f = *this->files[k];
+  auto at = loc.raw - this->bases[k];
+  return FullLoc{&f, at, f.location(at)};
+}
+
+string SourceManager::describe(SourceLoc loc) const {
+  if (!loc.valid() || this->files.empty() || loc.raw >= this->next)
+    return "<unknown>";
+  auto r = resolve(loc);
+  return r.file->path + ":" + std::to_string(r.at.line) + ":"
+         + std::to_string(r.at.col);
+}
+
+} // namespace mangekyou::parse
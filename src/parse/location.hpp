@@ -0,0 +1,55 @@
+#pragma once
+#include <expected>
+#include <prelude.hpp>
+#include <vector>
+
+#include "lines.hpp"
+#include "source.hpp"
+
+namespace mangekyou::parse {
+
+/// a byte in any loaded file, as one 32-bit offset into the concatenation
+/// of all files (see `SourceManager`). nodes store this instead of a file,
+/// line and column, which are recovered from the side tables on demand.
+struct SourceLoc {
+  static constexpr u32 NONE = ~u32(0);
+  u32 raw                   = NONE;
+
+  bool valid() const { return this->raw != NONE; }
+  bool operator==(const SourceLoc& other) const {
+    return this->raw == other.raw;
+  }
+  bool operator!=(const SourceLoc& other) const {
+    return this->raw != other.raw;
+  }
+};
+
+/// a location resolved for a diagnostic
+struct FullLoc {
+  const Source* file;
+  /// within `file`
+  u32 offset;
+  LineCol at;
+};
+
+/// the side table of `SourceLoc`s: every file added gets the next range of
+/// global offsets, one past its end so that `Eof` has a location too.
+struct SourceManager {
+  /// the first global offset of `src`, fails once 4GiB of source is loaded
+  tl::expected<u32, string> add(Rc<Source> src);
+
+  SourceLoc loc(u32 base, u32 offset) const {
+    return SourceLoc{base + offset};
+  }
+  /// binary search over the file bases, then over that file's lines
+  FullLoc resolve(SourceLoc loc) const;
+  /// `path:line:col`
+  string describe(SourceLoc loc) const;
+
+private:
+  std::vector<u32> bases;
+  std::vector<Rc<Source>> files;
+  u32 next = 0;
+};
+
+} // namespace mangekyou::parse
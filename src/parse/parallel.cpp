@@ -0,0 +1,111 @@
+#include "parallel.hpp"
+
+#include <cstring>
+#include <thread>
+
+#include "layout.hpp"
+#include "scan.hpp"
+
+namespace mangekyou::parse {
+
+using namespace scan;
+
+static bool starts_item(char c) {
+  return is(c, C_LOWER | C_UPPER) || c == '(';
+}
+
+std::vector<u32> split_items(std::string_view src, usize chunks) {
+  auto cuts = std::vector<u32>{0};
+  if (chunks < 2)
+    return cuts;
+  auto step       = src.size() / chunks;
+  const char* beg = src.data();
+  const char* end = beg + src.size();
+  for (usize k = 1; k < chunks; ++k) {
+    const char* p = beg + std::max<usize>(k * step, cuts.back() + 1);
+    for (;;) {
+      p = p < end ? static_cast<const char*>(std::memchr(p, '\n', end - p))
+                  : nullptr;
+      if (!p || ++p == end)
+        return cuts;
+      if (starts_item(*p))
+        break;
+    }
+    cuts.push_back(static_cast<u32>(p - beg));
+  }
+  return cuts;
+}
+
+namespace {
+struct Chunk {
+  TokenBuffer toks;
+  FixityTable fixities;
+  option<PResult<ast::Module>> result;
+};
+
+/// run `f(k)` for every chunk, one thread each
+template <typename F>
+void each(usize n, F f) {
+  auto threads = std::vector<std::thread>();
+  threads.reserve(n - 1);
+  for (usize k = 1; k < n; ++k)
+    threads.emplace_back(f, k);
+  f(0);
+  for (auto& t : threads)
+    t.join();
+}
+} // namespace
+
+static PResult<ast::Module> parse_sequential(std::string_view src) {
+  auto lexer = Lexer(src);
+  auto toks  = Layout::run(lexer);
+  return Parser(toks).parse_module();
+}
+
+PResult<ast::Module> parse_parallel(std::string_view src, unsigned jobs) {
+  if (jobs == 0)
+    jobs = std::max(1u, std::thread::hardware_concurrency());
+  auto n    = std::min<usize>(jobs, src.size() / MIN_CHUNK);
+  auto cuts = split_items(src, n);
+  if (cuts.size() < 2)
+    return parse_sequential(src);
+
+  auto chunks = std::vector<Chunk>();
+  chunks.reserve(cuts.size());
+  for (usize k = 0; k < cuts.size(); ++k) {
+    // the lexer sees the file up to the end of the chunk: offsets stay
+    // file-relative and the chunk ends with its own `Eof`
+    auto stop = k + 1 < cuts.size() ? cuts[k + 1] : src.size();
+    chunks.push_back(Chunk{TokenBuffer(src.substr(0, stop)), {}, {}});
+  }
+
+  each(chunks.size(), [&](usize k) {
+    auto lexer         = Lexer(chunks[k].toks.src);
+    lexer.pos          = cuts[k];
+    chunks[k].toks     = Layout::run(lexer);
+    chunks[k].fixities = FixityTable::collect(chunks[k].toks);
+  });
+
+  // later declarations win, as in a sequential `collect`
+  auto fixities = FixityTable();
+  for (auto& c : chunks)
+    for (auto& [op, fix] : c.fixities.ops)
+      fixities.declare(op, fix);
+
+  // only the first chunk may start with the header, anywhere else it is
+  // an error as in a sequential parse
+  each(chunks.size(), [&](usize k) {
+    auto parser      = Parser(chunks[k].toks, fixities);
+    chunks[k].result = k == 0 ? parser.parse_module() : parser.parse_items();
+  });
+
+  for (auto& c : chunks)
+    if (!*c.result)
+      return parse_sequential(src);
+  auto module = std::move(**chunks[0].result);
+  for (usize k = 1; k < chunks.size(); ++k)
+    module.append(std::move(**chunks[k].result));
+  return module;
+}
+
+} // namespace mangekyou::parse
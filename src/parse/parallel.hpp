@@ -0,0 +1,33 @@
+#pragma once
+#include <prelude.hpp>
+#include <string_view>
+#include <vector>
+
+#include "ast.hpp"
+#include "parser.hpp"
+
+namespace mangekyou::parse {
+
+/** parsing one file on several threads.
+ * under the layout rule a line starting at column 0 starts a new top-level
+ * item, so the file is cut at such lines into chunks that are lexed, laid
+ * out and parsed independently, each into its own `Module`. fixities are
+ * collected from every chunk before any is parsed. the chunk modules are
+ * appended in file order, token offsets are always relative to the file.
+ */
+
+/// smaller inputs are not worth a thread
+inline constexpr usize MIN_CHUNK = 64 * 1024;
+
+/// the offsets at which to cut `src` into at most `chunks` pieces, starting
+/// with 0. every cut other than 0 is at the start of a line whose first byte
+/// can start an item
+std::vector<u32> split_items(std::string_view src, usize chunks);
+
+/// lex and parse `src` on up to `jobs` threads (0: one per core). if a chunk
+/// fails, which also happens when a cut fell inside a multi-line string or
+/// an explicit block, the whole file is parsed again sequentially so errors
+/// are the same as without threads
+PResult<ast::Module> parse_parallel(std::string_view src, unsigned jobs = 0);
+
+} // namespace mangekyou::parse
@@ -0,0 +1,644 @@
+#include "parser.hpp"
+#include "literal.hpp"
+
+namespace mangekyou::parse {
+
+using namespace ast;
+
+#define TRY(var, e)                                                            \
+  auto var = (e);                                                              \
+  if (!var)                                                                    \
+  return tl::make_unexpected(std::move(var.error()))
+
+static bool is_literal(TokenKind k) {
+  switch (k) {
+  case TokenKind::IntLit:
+  case TokenKind::DecLit:
+  case TokenKind::HexLit:
+  case TokenKind::OctLit:
+  case TokenKind::BinLit:
+  case TokenKind::CharLit:
+  case TokenKind::StringLit: return true;
+  default: return false;
+  }
+}
+
+static bool at_aexp_start(TokenKind k) {
+  return is_literal(k) || k == TokenKind::VarId || k == TokenKind::ConId
+         || k == TokenKind::LParen;
+}
+
+static bool at_apat_start(TokenKind k) {
+  return at_aexp_start(k) || k == TokenKind::Underscore;
+}
+
+static bool at_atype_start(TokenKind k) {
+  return k == TokenKind::ConId || k == TokenKind::VarId
+         || k == TokenKind::Underscore || k == TokenKind::LParen;
+}
+
+/** helpers */
+
+TokenKind Parser::peek(u32 n) const {
+  u32 i = this->pos + n;
+  return i < this->toks.size() ? this->toks.kind(i) : TokenKind::Eof;
+}
+
+bool Parser::eat(TokenKind k) {
+  if (!at(k))
+    return false;
+  ++this->pos;
+  return true;
+}
+
+bool Parser::at_text(std::string_view s) const {
+  return at(TokenKind::Operator) && this->toks.text(this->pos) == s;
+}
+
+PResult<u32> Parser::expect(TokenKind k, const char* what) {
+  if (!at(k))
+    return error(string("expected ") + what);
+  return this->pos++;
+}
+
+tl::unexpected<ParseError> Parser::error(string msg) const {
+  u32 i = std::min(this->pos, this->toks.size() - 1);
+  return tl::make_unexpected(ParseError{this->toks.offsets[i], std::move(msg)});
+}
+
+option<std::pair<name::Id, u32>> Parser::peek_op() const {
+  if (at(TokenKind::Operator))
+    return std::make_pair(this->toks.ident(this->pos), 1u);
+  if (at(TokenKind::Backtick)
+      && (peek(1) == TokenKind::VarId || peek(1) == TokenKind::ConId)
+      && peek(2) == TokenKind::Backtick)
+    return std::make_pair(this->toks.ident(this->pos + 1), 3u);
+  return {};
+}
+
+/* error recovery: a failed item or block entry is recorded, then tokens are
+ * skipped up to the `;` that ends it, or the `}` that ends its block. the
+ * layout rule puts one of those at every line of a block and every
+ * top-level item, so no more than a line is lost per error. skipping only
+ * looks at token kinds and `braces`, and never goes backwards.
+ */
+bool Parser::recover(ParseError e, u32 open) {
+  // an error at the same place is a consequence of the previous one
+  if (this->errors.empty() || this->errors.back().offset != e.offset)
+    this->errors.push_back(std::move(e));
+  if (this->braces.empty()) {
+    this->braces.resize(this->toks.size());
+    u32 d = 0;
+    for (u32 i = 0; i < this->toks.size(); ++i) {
+      auto k = this->toks.kind(i);
+      if (k == TokenKind::RBrace && d > 0)
+        --d;
+      this->braces[i] = d;
+      if (k == TokenKind::LBrace)
+        ++d;
+    }
+  }
+  u32 outer = open == TOP_LEVEL ? 0 : this->braces[open];
+  u32 inner = open == TOP_LEVEL ? 0 : outer + 1;
+  for (;; ++this->pos) {
+    switch (peek()) {
+    case TokenKind::Eof: return false;
+    case TokenKind::Semi:
+      if (this->braces[this->pos] == inner)
+        return true;
+      break;
+    case TokenKind::RBrace:
+      if (this->braces[this->pos] == outer)
+        return false;
+      break;
+    default: break;
+    }
+  }
+}
+
+/// `{ entry (; entry)* }`, where `entry` parses one child. a child that
+/// fails is recorded and skipped, the others are kept
+template <typename F>
+PResult<Span> Parser::block(F entry) {
+  auto open = this->pos;
+  TRY(lbrace, expect(TokenKind::LBrace, "`{`"));
+  auto mark = this->scratch.size();
+  while (eat(TokenKind::Semi)) {}
+  while (!at(TokenKind::RBrace)) {
+    auto here  = this->scratch.size();
+    auto child = entry();
+    if (child) {
+      this->scratch.push_back(*child);
+    } else {
+      this->scratch.resize(here);
+      if (!recover(std::move(child.error()), open))
+        break;
+    }
+    if (!eat(TokenKind::Semi))
+      break;
+    while (eat(TokenKind::Semi)) {}
+  }
+  TRY(rbrace, expect(TokenKind::RBrace, "`}`"));
+  return this->module.list(this->scratch, mark);
+}
+
+/** Items */
+
+PResult<Module> Parser::parse_module() {
+  while (eat(TokenKind::Semi)) {}
+  header();
+  return parse_items();
+}
+
+PResult<Module> Parser::parse_items() {
+  while (eat(TokenKind::Semi)) {}
+  while (!at(TokenKind::Eof)) {
+    auto start = this->toks.offsets[this->pos];
+    auto it    = item();
+    if (it) {
+      this->module.items.push_back(*it);
+      this->module.starts.push_back(start);
+      if (!at(TokenKind::Semi) && !at(TokenKind::Eof))
+        it = error("expected `;` or a new line after item");
+    }
+    if (!it) {
+      this->scratch.clear();
+      recover(std::move(it.error()), TOP_LEVEL);
+      // a stray `}`
+      eat(TokenKind::RBrace);
+    }
+    while (eat(TokenKind::Semi)) {}
+  }
+  if (!this->errors.empty())
+    return tl::make_unexpected(this->errors.front());
+  return std::move(this->module);
+}
+
+void Parser::header() {
+  // the keyword, a module name and the end of the line
+  auto line = [&]() -> PResult<name::Id> {
+    ++this->pos;
+    TRY(name, mod_name());
+    if (!at(TokenKind::Semi) && !at(TokenKind::Eof))
+      return error("expected a new line after the module name");
+    return *name;
+  };
+  if (at(TokenKind::KwModule)) {
+    if (auto name = line())
+      this->module.name = *name;
+    else
+      recover(std::move(name.error()), TOP_LEVEL);
+    while (eat(TokenKind::Semi)) {}
+  }
+  while (at(TokenKind::KwImport)) {
+    auto loc = SourceLoc{this->base + this->toks.offsets[this->pos]};
+    if (auto name = line())
+      this->module.imports.push_back(Import{*name, loc});
+    else
+      recover(std::move(name.error()), TOP_LEVEL);
+    while (eat(TokenKind::Semi)) {}
+  }
+}
+
+PResult<name::Id> Parser::mod_name() {
+  TRY(first, expect(TokenKind::ConId, "a module name"));
+  auto s = string(this->toks.text(*first));
+  // `A.B` with no spaces, `A . B` is an application of `.`
+  auto end = [&](u32 i) {
+    return this->toks.offsets[i] + this->toks.lengths[i];
+  };
+  while (at_text(".") && peek(1) == TokenKind::ConId
+         && this->toks.offsets[this->pos] == end(this->pos - 1)
+         && this->toks.offsets[this->pos + 1] == end(this->pos)) {
+    s += '.';
+    s += this->toks.text(this->pos + 1);
+    this->pos += 2;
+  }
+  return name::Id(s);
+}
+
+PResult<ItemRef> Parser::item() {
+  auto start = this->pos;
+  switch (peek()) {
+  case TokenKind::KwInfixl:
+  case TokenKind::KwInfixr:
+  case TokenKind::KwInfix: return op_decl();
+  case TokenKind::KwData: return data_decl();
+  case TokenKind::KwType: return type_syn();
+  case TokenKind::KwExtern: {
+    ++this->pos;
+    TRY(name, fn_name());
+    TRY(colon, expect(TokenKind::Colon, "`:` in extern declaration"));
+    TRY(ty, type());
+    return node(start, Item(ExternDecl{name->first, *ty}));
+  }
+  case TokenKind::VarId:
+  case TokenKind::LParen: {
+    TRY(name, fn_name());
+    if (eat(TokenKind::Colon)) {
+      TRY(ty, type());
+      return node(start, Item(TypeSig{name->first, *ty}));
+    }
+    auto mark = this->scratch.size();
+    while (at_apat_start(peek())) {
+      TRY(p, apat());
+      this->scratch.push_back(p->i);
+    }
+    auto params = this->module.list(this->scratch, mark);
+    TRY(eq, expect(TokenKind::Equals, "`=` in definition"));
+    TRY(body, expr());
+    return node(start, Item(FnDecl{name->first, params, *body}));
+  }
+  default: return error("expected an item");
+  }
+}
+
+/// `ID` or `(OPERATOR)`, the flag is set for operators
+PResult<std::pair<name::Id, bool>> Parser::fn_name() {
+  if (at(TokenKind::VarId))
+    return std::make_pair(this->toks.ident(this->pos++), false);
+  if (at(TokenKind::LParen) && peek(1) == TokenKind::Operator
+      && peek(2) == TokenKind::RParen) {
+    auto op = this->toks.ident(this->pos + 1);
+    this->pos += 3;
+    return std::make_pair(op, true);
+  }
+  return error("expected a name or a parenthesised operator");
+}
+
+PResult<ItemRef> Parser::op_decl() {
+  auto start = this->pos;
+  auto assoc = peek() == TokenKind::KwInfixl   ? Assoc::Left
+               : peek() == TokenKind::KwInfixr ? Assoc::Right
+                                               : Assoc::None;
+  ++this->pos;
+  auto op = peek_op();
+  if (!op)
+    return error("expected an operator in fixity declaration");
+  this->pos += op->second;
+  if (!at(TokenKind::IntLit) || this->toks.lengths[this->pos] != 1)
+    return error("expected a precedence between 0 and 9");
+  auto prec = static_cast<u8>(this->toks.text(this->pos++)[0] - '0');
+  return node(start, Item(OpDecl{assoc, op->first, prec}));
+}
+
+Span Parser::ty_params() {
+  auto s = Span{static_cast<u32>(this->module.names.size()), 0};
+  for (; at(TokenKind::VarId); ++s.len)
+    this->module.add(this->toks.ident(this->pos++));
+  return s;
+}
+
+PResult<ItemRef> Parser::data_decl() {
+  auto start = this->pos++;
+  TRY(name, expect(TokenKind::ConId, "a type name"));
+  auto params = ty_params();
+  TRY(eq, expect(TokenKind::Equals, "`=` in data declaration"));
+  auto cons = this->scratch.size();
+  do {
+    TRY(con, expect(TokenKind::ConId, "a data constructor"));
+    auto args = this->scratch.size();
+    while (at_atype_start(peek())) {
+      TRY(arg, atype());
+      this->scratch.push_back(arg->i);
+    }
+    auto dc = DataCon{this->toks.ident(*con),
+                      this->module.list(this->scratch, args)};
+    this->scratch.push_back(this->module.add(dc).i);
+  } while (at_text("|") && ++this->pos);
+  auto list = this->module.list(this->scratch, cons);
+  return node(start, Item(DataDecl{this->toks.ident(*name), params, list}));
+}
+
+PResult<ItemRef> Parser::type_syn() {
+  auto start = this->pos++;
+  TRY(name, expect(TokenKind::ConId, "a type name"));
+  auto params = ty_params();
+  TRY(eq, expect(TokenKind::Equals, "`=` in type synonym"));
+  TRY(rhs, type());
+  return node(start, Item(TypeSyn{this->toks.ident(*name), params, *rhs}));
+}
+
+/** Expressions */
+
+PResult<ExprRef> Parser::expr() {
+  auto start = this->pos;
+  TRY(e, op_expr(0));
+  if (!eat(TokenKind::Colon))
+    return e;
+  TRY(ty, type());
+  return node(start, Expr(EAnn{*e, *ty}));
+}
+
+/* precedence climbing: an operator of precedence `p` is only taken if
+ * `p >= min_prec`; its right operand is parsed with `p + 1` (left/non
+ * associative) or `p` (right associative), so the tree comes out already
+ * associated and nothing is ever rotated afterwards. two operators of the
+ * same precedence next to each other must both be left or both be right
+ * associative: `prec` and `assoc` are the previous one's, that of the
+ * operator whose right operand this is at first, `prec` is -1 at the start.
+ */
+PResult<ExprRef> Parser::op_expr(u8 min_prec, int prec, Assoc assoc) {
+  auto start = this->pos;
+  TRY(lhs, lexp());
+  auto e = *lhs;
+  while (auto op = peek_op()) {
+    auto fix = this->fixities.lookup(op->first);
+    if (fix.prec < min_prec)
+      break;
+    if (prec == fix.prec && fix.assoc == Assoc::None)
+      return error("non-associative operator `" + op->first.string()
+                   + "` used without parentheses");
+    if (prec == fix.prec && fix.assoc != assoc)
+      return error("operator `" + op->first.string()
+                   + "` mixed with a differently associative operator of "
+                     "precedence "
+                   + std::to_string(fix.prec) + " without parentheses");
+    this->pos += op->second;
+    auto next = fix.assoc == Assoc::Right ? fix.prec : fix.prec + 1;
+    TRY(rhs, op_expr(static_cast<u8>(next), fix.prec, fix.assoc));
+    e     = node(start, Expr(EOp{this->module.add(op->first), e, *rhs}));
+    prec  = fix.prec;
+    assoc = fix.assoc;
+  }
+  return e;
+}
+
+PResult<ExprRef> Parser::lexp() {
+  auto start = this->pos;
+  switch (peek()) {
+  case TokenKind::Backslash: return lambda();
+  case TokenKind::KwLet: return let();
+  case TokenKind::KwCase: return case_of();
+  default: break;
+  }
+  TRY(f, aexp());
+  auto e = *f;
+  while (at_aexp_start(peek())) {
+    TRY(arg, aexp());
+    e = node(start, Expr(EApp{e, *arg}));
+  }
+  return e;
+}
+
+PResult<ExprRef> Parser::aexp() {
+  auto start = this->pos;
+  auto k = peek();
+  if (is_literal(k)) {
+    TRY(lit, literal());
+    return node(start, Expr(ELit{*lit}));
+  }
+  if (k == TokenKind::VarId)
+    return node(start, Expr(EVar{this->toks.ident(this->pos++)}));
+  if (k == TokenKind::ConId)
+    return node(start, Expr(ECon{this->toks.ident(this->pos++)}));
+  if (k != TokenKind::LParen)
+    return error("expected an expression");
+
+  ++this->pos;
+  if (eat(TokenKind::RParen))
+    return node(start, Expr(ETuple{}));
+  if (at(TokenKind::Operator) && peek(1) == TokenKind::RParen) {
+    auto op = this->toks.ident(this->pos);
+    this->pos += 2;
+    return node(start, Expr(EVar{op}));
+  }
+  TRY(e, expr());
+  if (!at(TokenKind::Comma)) {
+    TRY(close, expect(TokenKind::RParen, "`)`"));
+    return e;
+  }
+  auto mark = this->scratch.size();
+  this->scratch.push_back(e->i);
+  while (eat(TokenKind::Comma)) {
+    TRY(el, expr());
+    this->scratch.push_back(el->i);
+  }
+  TRY(close, expect(TokenKind::RParen, "`)` after tuple"));
+  return node(start, Expr(ETuple{this->module.list(this->scratch, mark)}));
+}
+
+PResult<LitRef> Parser::literal() {
+  auto k    = peek();
+  auto text = this->toks.text(this->pos);
+  auto& m   = this->module;
+  switch (k) {
+  case TokenKind::DecLit:
+    ++this->pos;
+    return m.add(Literal(literal::parse_dec(text)));
+  case TokenKind::CharLit: {
+    auto c = literal::decode_char(text);
+    if (!c)
+      return error(c.error());
+    ++this->pos;
+    return m.add(Literal(*c));
+  }
+  case TokenKind::StringLit: {
+    auto s = literal::decode_string(text, m.arena);
+    if (!s)
+      return error(s.error());
+    ++this->pos;
+    return m.add(Literal(*s));
+  }
+  default: {
+    ++this->pos;
+    auto v = literal::parse_int(text, k);
+    if (auto* small = std::get_if<u64>(&v))
+      return m.add(Literal(*small));
+    auto& limbs = std::get<literal::Integer>(v).limbs;
+    auto* p     = static_cast<u32*>(
+        m.arena.alloc(limbs.size() * sizeof(u32), alignof(u32)));
+    std::copy(limbs.begin(), limbs.end(), p);
+    return m.add(Literal(pat::BigInt{p, static_cast<u32>(limbs.size())}));
+  }
+  }
+}
+
+/// `\ p1 (p2 : T) -> body`, one `ELam` per parameter
+PResult<ExprRef> Parser::lambda() {
+  auto start = this->pos++;
+  // (param, annotation) pairs
+  auto mark = this->scratch.size();
+  while (!at(TokenKind::Arrow)) {
+    auto ann = TypeRef();
+    if (at(TokenKind::LParen)) {
+      TRY(p, paren_pat(&ann));
+      this->scratch.push_back(p->i);
+    } else if (at_apat_start(peek())) {
+      TRY(p, apat());
+      this->scratch.push_back(p->i);
+    } else {
+      return error("expected a lambda parameter or `->`");
+    }
+    this->scratch.push_back(ann.i);
+  }
+  if (this->scratch.size() == mark)
+    return error("lambda without parameters");
+  ++this->pos;
+  TRY(body, expr());
+  auto e = *body;
+  for (auto i = this->scratch.size(); i > mark; i -= 2) {
+    auto param = PatRef{this->scratch[i - 2]};
+    auto ann   = TypeRef{this->scratch[i - 1]};
+    e          = node(start, Expr(ELam{param, ann, e}));
+  }
+  this->scratch.resize(mark);
+  return e;
+}
+
+PResult<ExprRef> Parser::let() {
+  auto start = this->pos++;
+  TRY(items, block([this]() -> PResult<u32> {
+    TRY(it, item());
+    return it->i;
+  }));
+  TRY(in, expect(TokenKind::KwIn, "`in`"));
+  TRY(body, expr());
+  return node(start, Expr(ELet{*items, *body}));
+}
+
+PResult<ExprRef> Parser::case_of() {
+  auto start = this->pos++;
+  TRY(scrut, expr());
+  TRY(of, expect(TokenKind::KwOf, "`of`"));
+  TRY(alts, block([this]() -> PResult<u32> {
+    TRY(p, pattern());
+    TRY(arrow, expect(TokenKind::Arrow, "`->` in case branch"));
+    TRY(body, expr());
+    return this->module.add(Alt{*p, *body}).i;
+  }));
+  if (alts->len == 0)
+    return error("case without branches");
+  return node(start, Expr(ECase{*scrut, *alts}));
+}
+
+/** Patterns */
+
+PResult<PatRef> Parser::pattern() {
+  auto start = this->pos;
+  if (!at(TokenKind::ConId))
+    return apat();
+  auto con  = this->toks.ident(this->pos++);
+  auto mark = this->scratch.size();
+  while (at_apat_start(peek())) {
+    TRY(p, apat());
+    this->scratch.push_back(p->i);
+  }
+  auto args = this->module.list(this->scratch, mark);
+  return node(start, Pat(pat::PCon{con, args}));
+}
+
+PResult<PatRef> Parser::apat() {
+  auto start = this->pos;
+  auto k = peek();
+  if (k == TokenKind::VarId) {
+    auto id = this->toks.ident(this->pos++);
+    if (!eat(TokenKind::At))
+      return node(start, Pat(pat::PVar{id}));
+    TRY(p, apat());
+    return node(start, Pat(pat::PAs{id, *p}));
+  }
+  if (k == TokenKind::Underscore) {
+    ++this->pos;
+    return node(start, Pat(pat::PWildcard{}));
+  }
+  if (k == TokenKind::ConId) {
+    auto con = this->toks.ident(this->pos++);
+    return node(start, Pat(pat::PCon{con, Span{}}));
+  }
+  if (is_literal(k)) {
+    TRY(lit, literal());
+    return node(start, Pat(pat::PLit{*lit}));
+  }
+  if (k == TokenKind::LParen)
+    return paren_pat(nullptr);
+  return error("expected a pattern");
+}
+
+static name::Id tuple_con(usize arity) {
+  return name::Id("(" + string(arity ? arity - 1 : 0, ',') + ")");
+}
+
+/// `()`, `(p)`, `(p1, p2, ...)`, and `(p : T)` when `ann` is given
+PResult<PatRef> Parser::paren_pat(TypeRef* ann) {
+  auto start = this->pos++;
+  if (eat(TokenKind::RParen))
+    return node(start, Pat(pat::PCon{tuple_con(0), Span{}}));
+  TRY(p, pattern());
+  if (ann && eat(TokenKind::Colon)) {
+    TRY(ty, type());
+    *ann = *ty;
+  }
+  if (!at(TokenKind::Comma)) {
+    TRY(close, expect(TokenKind::RParen, "`)`"));
+    return p;
+  }
+  auto mark = this->scratch.size();
+  this->scratch.push_back(p->i);
+  while (eat(TokenKind::Comma)) {
+    TRY(el, pattern());
+    this->scratch.push_back(el->i);
+  }
+  TRY(close, expect(TokenKind::RParen, "`)` after tuple pattern"));
+  auto con   = tuple_con(this->scratch.size() - mark);
+  auto elems = this->module.list(this->scratch, mark);
+  return node(start, Pat(pat::PCon{con, elems}));
+}
+
+/** Types */
+
+PResult<TypeRef> Parser::type() {
+  auto start = this->pos;
+  TRY(lhs, btype());
+  if (!eat(TokenKind::Arrow))
+    return lhs;
+  TRY(rhs, type());
+  return node(start, Type(TFun{*lhs, *rhs}));
+}
+
+PResult<TypeRef> Parser::btype() {
+  auto start = this->pos;
+  TRY(hd, atype());
+  auto t = *hd;
+  while (at_atype_start(peek())) {
+    TRY(arg, atype());
+    t = node(start, Type(TApp{t, *arg}));
+  }
+  return t;
+}
+
+PResult<TypeRef> Parser::atype() {
+  auto start = this->pos;
+  auto& m    = this->module;
+  switch (peek()) {
+  case TokenKind::ConId:
+    return node(start, Type(TCon{this->toks.ident(this->pos++)}));
+  case TokenKind::VarId:
+    return node(start, Type(TVar{this->toks.ident(this->pos++)}));
+  case TokenKind::Underscore:
+    ++this->pos;
+    return node(start, Type(TInfer{}));
+  case TokenKind::LParen: break;
+  default: return error("expected a type");
+  }
+  ++this->pos;
+  if (eat(TokenKind::RParen))
+    return node(start, Type(TTuple{}));
+  TRY(t, type());
+  if (!at(TokenKind::Comma)) {
+    TRY(close, expect(TokenKind::RParen, "`)`"));
+    return t;
+  }
+  auto mark = this->scratch.size();
+  this->scratch.push_back(t->i);
+  while (eat(TokenKind::Comma)) {
+    TRY(el, type());
+    this->scratch.push_back(el->i);
+  }
+  TRY(close, expect(TokenKind::RParen, "`)` after tuple type"));
+  return node(start, Type(TTuple{m.list(this->scratch, mark)}));
+}
+
+#undef TRY
+
+} // namespace mangekyou::parse
@@ -0,0 +1,117 @@
+#pragma once
+#include <expected>
+#include <prelude.hpp>
+
+#include "ast.hpp"
+#include "fixity.hpp"
+#include "tokens.hpp"
+
+namespace mangekyou::parse {
+
+struct ParseError {
+  /// byte offset of the offending token
+  u32 offset;
+  string message;
+};
+
+template <typename T>
+using PResult = tl::expected<T, ParseError>;
+
+/// recursive descent for items, patterns and types; Pratt/precedence
+/// climbing for operator expressions, driven by `fixities`. the parser never
+/// rewinds: every decision is taken on at most three tokens of lookahead.
+struct Parser {
+  const TokenBuffer& toks;
+  FixityTable fixities;
+  u32 pos;
+  /// where nodes are allocated, moved out by `parse_module`
+  ast::Module module;
+  /// global offset of the file, see `SourceManager`
+  u32 base = 0;
+  /// every error recovered from, `parse_module` fails with the first one
+  std::vector<ParseError> errors;
+
+  explicit Parser(const TokenBuffer& toks)
+      : toks(toks)
+      , fixities(FixityTable::collect(toks))
+      , pos(0) {
+    this->module.reserve(toks.size());
+  }
+  /// with fixities collected beforehand, e.g. over a whole file that is
+  /// parsed in chunks
+  Parser(const TokenBuffer& toks, FixityTable fixities)
+      : toks(toks)
+      , fixities(std::move(fixities))
+      , pos(0) {
+    this->module.reserve(toks.size());
+  }
+
+  /// the header, then `Item (; Item)*` up to `Eof`, going on after errors
+  PResult<ast::Module> parse_module();
+  /// `Item (; Item)*` up to `Eof` with no header, for a chunk of a file
+  /// past its first item
+  PResult<ast::Module> parse_items();
+
+  PResult<ast::ItemRef> item();
+  PResult<ast::ExprRef> expr();
+  PResult<ast::PatRef> pattern();
+  PResult<ast::TypeRef> type();
+
+private:
+  static constexpr u32 TOP_LEVEL = ~u32(0);
+
+  /// children of the lists being parsed, innermost last
+  std::vector<u32> scratch;
+  /// `{` nesting at each token, filled in at the first error
+  std::vector<u32> braces;
+
+  TokenKind peek(u32 n = 0) const;
+  bool at(TokenKind k) const { return peek() == k; }
+  bool eat(TokenKind k);
+  bool at_text(std::string_view s) const;
+  PResult<u32> expect(TokenKind k, const char* what);
+  tl::unexpected<ParseError> error(string msg) const;
+  /// record `e` and skip to the end of the item or block entry, in the block
+  /// opened at token `open`. true if stopped at a `;`, false at its `}`/`Eof`
+  bool recover(ParseError e, u32 open);
+  template <typename F>
+  PResult<Span> block(F entry);
+
+  /// add a node to `module`, located at token `tok`
+  template <typename T>
+  auto node(u32 tok, const T& v) {
+    auto at = SourceLoc{this->base + this->toks.offsets[tok]};
+    return this->module.add(v, at);
+  }
+
+  /// an infix operator, symbolic or in backticks, with its token count
+  option<std::pair<name::Id, u32>> peek_op() const;
+
+  /// `module M` and `import M` lines, into `module`
+  void header();
+  /// `Con(.Con)*`, interned with its dots
+  PResult<name::Id> mod_name();
+
+  PResult<std::pair<name::Id, bool>> fn_name();
+  PResult<ast::ItemRef> op_decl();
+  PResult<ast::ItemRef> data_decl();
+  PResult<ast::ItemRef> type_syn();
+  Span ty_params();
+
+  PResult<ast::ExprRef> op_expr(u8 min_prec, int prec = -1,
+                                ast::Assoc assoc = ast::Assoc::Left);
+  PResult<ast::ExprRef> lexp();
+  PResult<ast::ExprRef> aexp();
+  PResult<ast::ExprRef> lambda();
+  PResult<ast::ExprRef> let();
+  PResult<ast::ExprRef> case_of();
+  PResult<ast::LitRef> literal();
+
+  PResult<ast::PatRef> apat();
+  PResult<ast::PatRef> paren_pat(ast::TypeRef* ann);
+
+  PResult<ast::TypeRef> btype();
+  PResult<ast::TypeRef> atype();
+};
+
+} // namespace mangekyou::parse
@@ -0,0 +1,210 @@
+#include "scan.hpp"
+
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__))                                 \
+    && (defined(__GNUC__) || defined(__clang__))
+#define MK_SCAN_X86
+#include <immintrin.h>
+#endif
+
+namespace mangekyou::parse::scan {
+
+static const char* skip_scalar(const char* p, const char* end, u8 cls) {
+  while (p < end && is(*p, cls))
+    ++p;
+  return p;
+}
+
+#ifdef MK_SCAN_X86
+/* nibble lookup: a byte `b` is in a class iff
+ * `LO[b & 0xF] & HI[b >> 4] & class_bits`. bytes >= 0x80 hit HI[8..15] = 0.
+ *   0x01 digits        (hi 3, lo 0-9)
+ *   0x02 letters A-O   (hi 4|6, lo 1-F)
+ *   0x04 letters P-Z   (hi 5|7, lo 0-A)
+ *   0x08 underscore    (hi 5, lo F)
+ *   0x10 space         (hi 2, lo 0)
+ *   0x20 \t \n \r      (hi 0, lo 9|A|D)
+ */
+static constexpr u8 N_IDENT = 0x0F;
+static constexpr u8 N_SPACE = 0x30;
+
+#define MK_LO_TABLE                                                            \
+  0x15, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x27, 0x26, 0x02,      \
+      0x02, 0x22, 0x02, 0x0A
+#define MK_HI_TABLE                                                            \
+  0x20, 0x00, 0x10, 0x01, 0x02, 0x0C, 0x02, 0x04, 0x00, 0x00, 0x00, 0x00,      \
+      0x00, 0x00, 0x00, 0x00
+
+__attribute__((target("ssse3"))) static const char*
+skip_ssse3(const char* p, const char* end, u8 bits, u8 cls) {
+  const auto lo_t = _mm_setr_epi8(MK_LO_TABLE);
+  const auto hi_t = _mm_setr_epi8(MK_HI_TABLE);
+  const auto nib  = _mm_set1_epi8(0x0F);
+  const auto sel  = _mm_set1_epi8(static_cast<char>(bits));
+  while (end - p >= 16) {
+    auto v  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    auto lo = _mm_shuffle_epi8(lo_t, _mm_and_si128(v, nib));
+    auto hi = _mm_shuffle_epi8(hi_t, _mm_and_si128(_mm_srli_epi16(v, 4), nib));
+    auto in = _mm_and_si128(_mm_and_si128(lo, hi), sel);
+    u32 out = _mm_movemask_epi8(_mm_cmpeq_epi8(in, _mm_setzero_si128()));
+    if (out)
+      return p + __builtin_ctz(out);
+    p += 16;
+  }
+  return skip_scalar(p, end, cls);
+}
+
+__attribute__((target("avx2"))) static const char*
+skip_avx2(const char* p, const char* end, u8 bits, u8 cls) {
+  const auto lo_t = _mm256_setr_epi8(MK_LO_TABLE, MK_LO_TABLE);
+  const auto hi_t = _mm256_setr_epi8(MK_HI_TABLE, MK_HI_TABLE);
+  const auto nib  = _mm256_set1_epi8(0x0F);
+  const auto sel  = _mm256_set1_epi8(static_cast<char>(bits));
+  while (end - p >= 32) {
+    auto v  = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    auto lo = _mm256_shuffle_epi8(lo_t, _mm256_and_si256(v, nib));
+    auto hi = _mm256_shuffle_epi8(
+        hi_t, _mm256_and_si256(_mm256_srli_epi16(v, 4), nib));
+    auto in = _mm256_and_si256(_mm256_and_si256(lo, hi), sel);
+    u32 out = _mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(in, _mm256_setzero_si256()));
+    if (out)
+      return p + __builtin_ctz(out);
+    p += 32;
+  }
+  return skip_ssse3(p, end, bits, cls);
+}
+#undef MK_LO_TABLE
+#undef MK_HI_TABLE
+#endif
+
+static void lines_scalar(const char* p, const char* end, const char* base,
+                         std::vector<u32>& out) {
+  while ((p = static_cast<const char*>(std::memchr(p, '\n', end - p)))) {
+    out.push_back(static_cast<u32>(++p - base));
+    if (p == end)
+      break;
+  }
+}
+
+#ifdef MK_SCAN_X86
+/// one bit per newline, cleared lowest first
+static inline void push_bits(u32 hits, const char* p, const char* base,
+                             std::vector<u32>& out) {
+  for (; hits; hits &= hits - 1)
+    out.push_back(static_cast<u32>(p - base) + __builtin_ctz(hits) + 1);
+}
+
+__attribute__((target("sse2"))) static void
+lines_sse2(const char* p, const char* end, const char* base,
+           std::vector<u32>& out) {
+  const auto nl = _mm_set1_epi8('\n');
+  while (end - p >= 16) {
+    auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    push_bits(_mm_movemask_epi8(_mm_cmpeq_epi8(v, nl)), p, base, out);
+    p += 16;
+  }
+  lines_scalar(p, end, base, out);
+}
+
+__attribute__((target("avx2"))) static void
+lines_avx2(const char* p, const char* end, const char* base,
+           std::vector<u32>& out) {
+  const auto nl = _mm256_set1_epi8('\n');
+  while (end - p >= 64) {
+    // two vectors per iteration: lines are rarely shorter than 32 bytes
+    auto a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    auto b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32));
+    u32 lo = _mm256_movemask_epi8(_mm256_cmpeq_epi8(a, nl));
+    u32 hi = _mm256_movemask_epi8(_mm256_cmpeq_epi8(b, nl));
+    push_bits(lo, p, base, out);
+    push_bits(hi, p + 32, base, out);
+    p += 64;
+  }
+  lines_sse2(p, end, base, out);
+}
+#endif
+
+namespace {
+using kernel_fn = const char* (*)(const char*, const char*, u8, u8);
+using lines_fn  = void (*)(const char*, const char*, const char*,
+                          std::vector<u32>&);
+
+const char* skip_fallback(const char* p, const char* end, u8, u8 cls) {
+  return skip_scalar(p, end, cls);
+}
+
+struct Kernel {
+  kernel_fn fn;
+  lines_fn lines;
+  const char* name;
+
+  Kernel() {
+#ifdef MK_SCAN_X86
+    __builtin_cpu_init();
+    lines = __builtin_cpu_supports("avx2") ? lines_avx2 : lines_sse2;
+    if (__builtin_cpu_supports("avx2")) {
+      fn   = skip_avx2;
+      name = "avx2";
+      return;
+    }
+    if (__builtin_cpu_supports("ssse3")) {
+      fn   = skip_ssse3;
+      name = "ssse3";
+      return;
+    }
+#else
+    lines = lines_scalar;
+#endif
+    fn   = skip_fallback;
+    name = "scalar";
+  }
+};
+
+const Kernel s_kernel{};
+} // namespace
+
+#ifdef MK_SCAN_X86
+const char* skip_ident(const char* p, const char* end) {
+  return s_kernel.fn(p, end, N_IDENT, C_IDENT);
+}
+const char* skip_space(const char* p, const char* end) {
+  return s_kernel.fn(p, end, N_SPACE, C_SPACE);
+}
+#else
+const char* skip_ident(const char* p, const char* end) {
+  return skip_scalar(p, end, C_IDENT);
+}
+const char* skip_space(const char* p, const char* end) {
+  return skip_scalar(p, end, C_SPACE);
+}
+#endif
+
+const char* find_either(const char* p, const char* end, char a, char b) {
+#ifdef __SSE2__
+  // plain compares are baseline on x86-64, no dispatch needed
+  const auto va = _mm_set1_epi8(a);
+  const auto vb = _mm_set1_epi8(b);
+  while (end - p >= 16) {
+    auto v  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    u32 hit = _mm_movemask_epi8(
+        _mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb)));
+    if (hit)
+      return p + __builtin_ctz(hit);
+    p += 16;
+  }
+#endif
+  while (p < end && *p != a && *p != b)
+    ++p;
+  return p;
+}
+
+void line_starts(const char* p, const char* end, const char* base,
+                 std::vector<u32>& out) {
+  s_kernel.lines(p, end, base, out);
+}
+
+const char* kernel() { return s_kernel.name; }
+
+} // namespace mangekyou::parse::scan
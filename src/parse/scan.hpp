@@ -0,0 +1,63 @@
+#pragma once
+#include <array>
+#include <prelude.hpp>
+#include <vector>
+
+/** vectorized byte scanners used by the lexer.
+ * every `skip_*` returns a pointer to the first byte *not* in its class (or
+ * `end`). AVX2/SSSE3 kernels are picked once at startup, with a scalar
+ * fallback on other targets.
+ */
+namespace mangekyou::parse::scan {
+
+/// character classes, see syntax.md § Lexer
+enum CharClass : u8 {
+  C_IDENT   = 1 << 0, // [a-zA-Z0-9_]
+  C_SPACE   = 1 << 1, // [ \t\n\r]
+  C_OPSYM   = 1 << 2,
+  C_SPECIAL = 1 << 3,
+  C_DIGIT   = 1 << 4,
+  C_UPPER   = 1 << 5,
+  C_LOWER   = 1 << 6,
+};
+
+constexpr std::array<u8, 256> make_class_table() {
+  auto t   = std::array<u8, 256>{};
+  auto set = [&t](const char* cs, u8 cls) {
+    for (; *cs; ++cs)
+      t[static_cast<u8>(*cs)] |= cls;
+  };
+  for (int c = '0'; c <= '9'; ++c)
+    t[c] |= C_IDENT | C_DIGIT;
+  for (int c = 'A'; c <= 'Z'; ++c)
+    t[c] |= C_IDENT | C_UPPER;
+  for (int c = 'a'; c <= 'z'; ++c)
+    t[c] |= C_IDENT | C_LOWER;
+  set("_", C_IDENT);
+  set(" \t\n\r", C_SPACE);
+  set("!#$%*+./<=>?@^|-~:&", C_OPSYM);
+  set("[]{}(),;'\"`\\", C_SPECIAL);
+  return t;
+}
+
+inline constexpr std::array<u8, 256> CLASS_TABLE = make_class_table();
+
+inline bool is(char c, u8 cls) { return CLASS_TABLE[static_cast<u8>(c)] & cls; }
+
+/// skip `[a-zA-Z0-9_]*`
+const char* skip_ident(const char* p, const char* end);
+/// skip `[ \t\n\r]*`
+const char* skip_space(const char* p, const char* end);
+
+/// first byte equal to `a` or `b`
+const char* find_either(const char* p, const char* end, char a, char b);
+
+/// append the offset from `base` of the byte after every `\n` in
+/// `[p, end)` to `out`
+void line_starts(const char* p, const char* end, const char* base,
+                 std::vector<u32>& out);
+
+/// name of the kernel in use: "avx2", "ssse3" or "scalar"
+const char* kernel();
+
+} // namespace mangekyou::parse::scan
@@ -0,0 +1,83 @@
+#include "source.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define MK_HAVE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace mangekyou::parse {
+
+Source::~Source() {
+#ifdef MK_HAVE_MMAP
+  if (this->mapped)
+    munmap(const_cast<char*>(this->data), this->size);
+#endif
+}
+
+static tl::unexpected<string> failure(const char* what, const string& path) {
+  return tl::make_unexpected(string("cannot ") + what + " `" + path
+                             + "`: " + std::strerror(errno));
+}
+
+tl::expected<Rc<Source>, string> Source::open(const string& path) {
+  auto src = Rc<Source>(new Source(path));
+#ifdef MK_HAVE_MMAP
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return failure("open", path);
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    auto err = failure("stat", path);
+    ::close(fd);
+    return err;
+  }
+  if (st.st_size > 0) {
+    void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED) {
+      auto err = failure("map", path);
+      ::close(fd);
+      return err;
+    }
+    // the lexer is a single forward pass
+    madvise(p, st.st_size, MADV_SEQUENTIAL);
+    src->data   = static_cast<const char*>(p);
+    src->size   = st.st_size;
+    src->mapped = true;
+  }
+  ::close(fd);
+#else
+  auto in = std::ifstream(path, std::ios::binary);
+  if (!in)
+    return failure("open", path);
+  auto ss = std::ostringstream();
+  ss << in.rdbuf();
+  src->owned = ss.str();
+  src->data  = src->owned.data();
+  src->size  = src->owned.size();
+#endif
+  return src;
+}
+
+const LineIndex& Source::lines() const {
+  std::call_once(this->indexed,
+                 [this] { this->index = LineIndex(this->text()); });
+  return this->index;
+}
+
+Rc<Source> Source::from_string(string path, string contents) {
+  auto src   = Rc<Source>(new Source(std::move(path)));
+  src->owned = std::move(contents);
+  src->data  = src->owned.data();
+  src->size  = src->owned.size();
+  return src;
+}
+
+} // namespace mangekyou::parse
@@ -0,0 +1,46 @@
+#pragma once
+#include <expected>
+#include <mutex>
+#include <prelude.hpp>
+#include <string_view>
+
+#include "lines.hpp"
+
+namespace mangekyou::parse {
+
+/// a source file, memory-mapped read-only where the platform allows it.
+/// tokens and literals are views into `text()`, so a `Source` must outlive
+/// everything lexed from it.
+struct Source {
+  string path;
+
+  Source(const Source&)            = delete;
+  Source& operator=(const Source&) = delete;
+  ~Source();
+
+  static tl::expected<Rc<Source>, string> open(const string& path);
+  /// in-memory source, e.g. for tests or editor buffers
+  static Rc<Source> from_string(string path, string contents);
+
+  std::string_view text() const {
+    return std::string_view(this->data, this->size);
+  }
+  /// built on first use: a file that never reports a diagnostic, e.g. one
+  /// only scanned for its imports, is not read past what was lexed of it
+  const LineIndex& lines() const;
+  /// where a token or error offset is, for diagnostics
+  LineCol location(u32 offset) const { return lines().lookup(offset); }
+
+private:
+  const char* data = nullptr;
+  usize size       = 0;
+  bool mapped      = false;
+  string owned;
+  mutable LineIndex index;
+  mutable std::once_flag indexed;
+
+  explicit Source(string path)
+      : path(std::move(path)) {}
+};
+
+} // namespace mangekyou::parse
@@ -0,0 +1,82 @@
+#pragma once
+#include <prelude.hpp>
+#include <string>
+
+namespace mangekyou::parse {
+
+/// see syntax.md, § Lexer
+enum class TokenKind : u8 {
+  Eof,
+  Error,
+
+  /** identifiers */
+  VarId,
+  ConId,
+  Underscore,
+  Operator,
+
+  /** literals */
+  IntLit,
+  DecLit,
+  HexLit,
+  OctLit,
+  BinLit,
+  CharLit,
+  StringLit,
+
+  /** special */
+  LParen,
+  RParen,
+  LBracket,
+  RBracket,
+  LBrace,
+  RBrace,
+  Comma,
+  Semi,
+  Backtick,
+  Backslash,
+
+  /** reserved keywords */
+  KwExtern,
+  KwLet,
+  KwIn,
+  KwDo,
+  KwType,
+  KwDeriving,
+  KwVia,
+  KwFor,
+  KwInfixr,
+  KwInfixl,
+  KwInfix,
+  KwData,
+  KwCase,
+  KwOf,
+  KwModule,
+  KwImport,
+
+  /** reserved operators */
+  Arrow,
+  Colon,
+  Amp,
+  Bang,
+  Equals,
+  At,
+  QQ,
+};
+
+std::string to_string(TokenKind k);
+
+struct Token {
+  TokenKind kind;
+  u32 offset;
+  u32 length;
+
+  Token(TokenKind kind, u32 offset, u32 length)
+      : kind(kind)
+      , offset(offset)
+      , length(length) {}
+
+  bool is(TokenKind k) const { return this->kind == k; }
+};
+
+} // namespace mangekyou::parse
@@ -0,0 +1,78 @@
+#include "tokens.hpp"
+
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define MK_TOKENS_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace mangekyou::parse {
+
+void TokenBuffer::reserve(usize n) {
+  this->kinds.reserve(n);
+  this->offsets.reserve(n);
+  this->lengths.reserve(n);
+}
+
+name::Id TokenBuffer::ident(u32 i) const {
+  if (this->ids.empty())
+    this->ids.resize(this->size(), nullptr);
+  if (!this->ids[i])
+    this->ids[i] = name::Id(text(i)).str;
+  return name::Id::from_interned(this->ids[i]);
+}
+
+u32 TokenBuffer::find(u32 from, TokenKind k) const {
+  if (from >= size())
+    return size();
+  auto* p     = reinterpret_cast<const u8*>(this->kinds.data());
+  auto* found = std::memchr(p + from, static_cast<u8>(k), size() - from);
+  return found ? static_cast<u32>(static_cast<const u8*>(found) - p) : size();
+}
+
+static TokenKind closer(TokenKind k) {
+  switch (k) {
+  case TokenKind::LParen: return TokenKind::RParen;
+  case TokenKind::LBracket: return TokenKind::RBracket;
+  case TokenKind::LBrace: return TokenKind::RBrace;
+  default: return k;
+  }
+}
+
+u32 TokenBuffer::match_bracket(u32 open) const {
+  auto o     = static_cast<u8>(this->kinds[open]);
+  auto c     = static_cast<u8>(closer(this->kinds[open]));
+  auto* p    = reinterpret_cast<const u8*>(this->kinds.data());
+  u32 n      = size();
+  u32 i      = open + 1;
+  i32 depth  = 1;
+#ifdef MK_TOKENS_SSE2
+  // skip 16 kinds at a time until a block holds an open or close bracket
+  const auto vo = _mm_set1_epi8(static_cast<char>(o));
+  const auto vc = _mm_set1_epi8(static_cast<char>(c));
+  while (n - i >= 16) {
+    auto v    = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+    u32 opens = _mm_movemask_epi8(_mm_cmpeq_epi8(v, vo));
+    u32 clos  = _mm_movemask_epi8(_mm_cmpeq_epi8(v, vc));
+    while (opens | clos) {
+      u32 bit = (opens | clos) & -(opens | clos);
+      depth += (opens & bit) ? 1 : -1;
+      if (depth == 0)
+        return i + __builtin_ctz(bit);
+      opens &= ~bit;
+      clos &= ~bit;
+    }
+    i += 16;
+  }
+#endif
+  for (; i < n; ++i) {
+    if (p[i] == o)
+      ++depth;
+    else if (p[i] == c && --depth == 0)
+      return i;
+  }
+  return n;
+}
+
+} // namespace mangekyou::parse
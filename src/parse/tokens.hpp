@@ -0,0 +1,52 @@
+#pragma once
+#include <prelude.hpp>
+#include <string_view>
+#include <vector>
+
+#include "core/name.hpp"
+#include "token.hpp"
+
+namespace mangekyou::parse {
+
+/// the token stream as parallel arrays, indexed by token number.
+/// the parser mostly looks at `kinds` only, which is one byte per token and
+/// can be scanned with `memchr`/SSE2 compares.
+struct TokenBuffer {
+  std::string_view src;
+  std::vector<TokenKind> kinds;
+  std::vector<u32> offsets;
+  std::vector<u32> lengths;
+
+  TokenBuffer(std::string_view src)
+      : src(src) {}
+
+  void reserve(usize n);
+  void push(const Token& t) {
+    this->kinds.push_back(t.kind);
+    this->offsets.push_back(t.offset);
+    this->lengths.push_back(t.length);
+  }
+
+  u32 size() const { return static_cast<u32>(this->kinds.size()); }
+  TokenKind kind(u32 i) const { return this->kinds[i]; }
+  Token operator[](u32 i) const {
+    return Token(this->kinds[i], this->offsets[i], this->lengths[i]);
+  }
+  std::string_view text(u32 i) const {
+    return this->src.substr(this->offsets[i], this->lengths[i]);
+  }
+  /// interned text of token `i`, memoized per token
+  name::Id ident(u32 i) const;
+
+  /// first token at or after `from` of kind `k`, or `size()`
+  u32 find(u32 from, TokenKind k) const;
+  /// the `RParen`/`RBracket`/`RBrace` closing the bracket at `open`, or
+  /// `size()` when unbalanced
+  u32 match_bracket(u32 open) const;
+
+private:
+  /// allocated on first `ident`, null until a token is interned
+  mutable std::vector<name::FastString::table_type::mapped_type> ids;
+};
+
+} // namespace mangekyou::parse
@@ -0,0 +1,174 @@
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <prelude.hpp>
+
+#include "build/cache.hpp"
+#include "build/driver.hpp"
+#include "build/pool.hpp"
+#include "parse/layout.hpp"
+
+using namespace mangekyou;
+
+/// a fresh directory of source files, `{path, contents}`
+static string tree(const string& name,
+                   std::vector<std::pair<string, string>> files) {
+  auto dir = testing::TempDir() + "mangekyou-build-" + name;
+  std::filesystem::remove_all(dir);
+  for (auto& [path, text] : files) {
+    auto p = std::filesystem::path(dir) / path;
+    std::filesystem::create_directories(p.parent_path());
+    std::ofstream(p) << text;
+  }
+  return dir;
+}
+
+TEST(BuildTest, poolNested) {
+  auto count = std::atomic<u32>(0);
+  {
+    auto pool = build::Pool(4);
+    for (u32 k = 0; k < 100; ++k)
+      pool.spawn([&] {
+        for (u32 j = 0; j < 10; ++j)
+          pool.spawn([&] { ++count; });
+        ++count;
+      });
+    pool.wait();
+    EXPECT_EQ(count.load(), 1100);
+  }
+}
+
+TEST(BuildTest, header) {
+  auto h = build::header("module A.B\nimport C\nimport D.E\nx = 1\n"
+                         "import F\n");
+  ASSERT_TRUE(h.has_value()) << h.error().message;
+  EXPECT_EQ(h->name, "A.B");
+  EXPECT_EQ(h->imports, (std::vector<string>{"C", "D.E"}));
+  EXPECT_EQ(build::module_path("D.E"), "D/E.mk");
+  auto bad = build::header("import A x\n");
+  ASSERT_FALSE(bad.has_value());
+  EXPECT_EQ(bad.error().offset, 9);
+}
+
+TEST(BuildTest, headerStopsAtBody) {
+  // the body is never lexed: a string left open would be an error
+  auto body = string("import Prelude\nf = \"");
+  for (u32 k = 0; k < 100000; ++k)
+    body += "g x = x + 1\n";
+  auto h = build::header(body);
+  ASSERT_TRUE(h.has_value());
+  EXPECT_EQ(h->imports, std::vector<string>{"Prelude"});
+}
+
+TEST(BuildTest, order) {
+  auto dir = tree("order", {{"Main.mk", "import Util\nimport Data.List\n"
+                                        "main = f\n"},
+                            {"Util.mk", "module Util\nimport Data.List\n"},
+                            {"Data/List.mk", "module Data.List\nf = 1\n"}});
+  auto g   = build::Graph::load({dir + "/Main.mk"}, {dir});
+  ASSERT_TRUE(g.has_value()) << g.error();
+  ASSERT_EQ(g->units.size(), 3);
+  EXPECT_EQ(g->units[0].name, "Main");
+  auto order = g->order();
+  ASSERT_TRUE(order.has_value());
+  auto names = std::vector<string>();
+  for (auto u : *order)
+    names.push_back(g->units[u].name);
+  EXPECT_EQ(names, (std::vector<string>{"Data.List", "Util", "Main"}));
+}
+
+TEST(BuildTest, cycle) {
+  auto dir = tree("cycle", {{"A.mk", "import B\n"},
+                            {"B.mk", "import C\n"},
+                            {"C.mk", "import B\n"}});
+  auto g   = build::Graph::load({dir + "/A.mk"}, {dir});
+  ASSERT_TRUE(g.has_value()) << g.error();
+  auto order = g->order();
+  ASSERT_FALSE(order.has_value());
+  EXPECT_EQ(order.error(), "import cycle: B -> C -> B");
+}
+
+TEST(BuildTest, missingImport) {
+  auto dir = tree("missing", {{"A.mk", "import Nowhere\n"}});
+  auto g   = build::Graph::load({dir + "/A.mk"}, {dir});
+  ASSERT_FALSE(g.has_value());
+  EXPECT_NE(g.error().find("module `Nowhere` not found"), string::npos);
+}
+
+TEST(BuildTest, importedFixities) {
+  auto dir = tree("fixity",
+                  {{"Main.mk", "import Ops\ng a b c = a +++ b +++ c\n"},
+                   {"Ops.mk", "infixr +++ 5\n"},
+                   {"Bad.mk", "import Ops\nh = (\n"},
+                   {"Worse.mk", "import Bad\n"}});
+  auto g   = build::Graph::load({dir + "/Main.mk", dir + "/Worse.mk"}, {dir});
+  ASSERT_TRUE(g.has_value()) << g.error();
+  auto r = build::compile(*g, {.jobs = 4});
+  // only the module that failed reports, not the one importing it
+  ASSERT_EQ(r.errors.size(), 1);
+  EXPECT_NE(r.errors[0].find("Bad.mk:3:1: expected an expression"),
+            string::npos);
+  auto& main = r.units[g->index["Main"]];
+  ASSERT_TRUE(main.has_value());
+  auto& m  = *main->module;
+  auto& fn = std::get<ast::FnDecl>(m[m.items[0]]);
+  EXPECT_EQ(m.to_string(fn.body), "(a +++ (b +++ c))");
+  EXPECT_FALSE(r.units[g->index["Worse"]].has_value());
+  EXPECT_EQ(r.units[g->index["Main"]]->iface.exports,
+            std::vector<name::Id>{name::Id("g")});
+}
+
+TEST(BuildTest, everyError) {
+  auto dir = tree("errors", {{"A.mk", "f = (\ng x = x\nh = )\n"}});
+  auto g   = build::Graph::load({dir + "/A.mk"}, {dir});
+  ASSERT_TRUE(g.has_value()) << g.error();
+  auto r = build::compile(*g);
+  ASSERT_EQ(r.errors.size(), 2);
+  EXPECT_NE(r.errors[0].find("A.mk:2:1:"), string::npos) << r.errors[0];
+  EXPECT_NE(r.errors[1].find("A.mk:3:5:"), string::npos) << r.errors[1];
+  EXPECT_FALSE(r.units[0].has_value());
+}
+
+TEST(BuildTest, digest) {
+  auto a = build::Hasher().add("ab").add("c").finish();
+  auto b = build::Hasher().add("a").add("bc").finish();
+  EXPECT_NE(a, b);
+  EXPECT_EQ(a, build::Hasher().add("ab").add("c").finish());
+  EXPECT_EQ(a.hex().size(), 32);
+}
+
+TEST(BuildTest, interfaceRoundTrip) {
+  auto iface = build::Interface{"A.B", {}, {name::Id("f"), name::Id("T")}};
+  iface.fixities.declare(name::Id("<>"), {ast::Assoc::Right, 6});
+  iface.fixities.declare(name::Id("=="), {ast::Assoc::None, 4});
+  auto text = build::serialize(iface);
+  auto back = build::deserialize(text);
+  ASSERT_TRUE(back.has_value());
+  EXPECT_EQ(build::serialize(*back), text);
+  EXPECT_FALSE(build::deserialize("mki 0\nmodule A\n").has_value());
+}
+
+TEST(BuildTest, cache) {
+  auto files = std::vector<std::pair<string, string>>{
+      {"Main.mk", "import Ops\ng a b c = a +++ b +++ c\n"},
+      {"Ops.mk", "infixr +++ 5\nf x = x\n"}};
+  auto dir  = tree("cache", files);
+  auto opts = build::Options{.jobs = 2, .cache = dir + "/cache"};
+  auto run  = [&] {
+    auto g = build::Graph::load({dir + "/Main.mk"}, {dir});
+    EXPECT_TRUE(g.has_value());
+    auto r = build::compile(*g, opts);
+    EXPECT_TRUE(r.ok());
+    return r.hits;
+  };
+  EXPECT_EQ(run(), 0);
+  EXPECT_EQ(run(), 2);
+  // a new body, the same interface: only Ops is compiled again
+  std::ofstream(dir + "/Ops.mk") << "infixr +++ 5\nf x = 1\n";
+  EXPECT_EQ(run(), 1);
+  std::ofstream(dir + "/Ops.mk") << "infixl +++ 5\nf x = 1\n";
+  EXPECT_EQ(run(), 0);
+  opts.flags = "-O2";
+  EXPECT_EQ(run(), 0);
+}
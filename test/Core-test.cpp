@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+#include <prelude.hpp>
+
+#include "core/desugar.hpp"
+#include "fixtures.hpp"
+
+using namespace mangekyou;
+using namespace mangekyou::parse;
+using namespace mangekyou::test;
+
+TEST(CoreTest, clauses) {
+  auto p = core_of(std::string(LIST)
+                   + "map : (a -> b) -> List a -> List b\n"
+                     "map f Nil = Nil\n"
+                     "map f (Cons x xs) = Cons (f x) (map f xs)\n");
+  EXPECT_EQ(p.to_string(),
+            "map_0 = (\\f_1 x_2 -> (case x_2 of { Nil -> Nil; "
+            "Cons x_3 xs_4 -> (Cons (f_1 x_3) (map_0 f_1 xs_4)) }))\n");
+  auto& map = p[p.top[0]];
+  EXPECT_EQ(p.to_string(p[map.var].ty),
+            "((a -> b) -> ((List a) -> (List b)))");
+  // the field types follow the scrutinee's type
+  auto& lam = std::get<core::ELam>(p[map.rhs]);
+  auto& cs  = std::get<core::ECase>(p[lam.body]);
+  auto& alt = p[p.at<Ref<core::Alt>>(cs.alts, 1)];
+  EXPECT_EQ(p.to_string(p[p.at<core::VarRef>(alt.vars, 1)].ty), "(List a)");
+}
+
+TEST(CoreTest, joinPoint) {
+  // the second clause is reached from two leaves, its body is kept once
+  auto p = core_of(std::string(LIST) + "f Nil Nil = 1\n"
+                                       "f xs ys = 2\n");
+  EXPECT_EQ(p.to_string(),
+            "f_0 = (\\xs_1 ys_2 -> (let j_5 = (\\xs_3 ys_4 -> 2) in "
+            "(case xs_1 of { Nil -> (case ys_2 of { Nil -> 1; "
+            "_ -> (j_5 xs_1 ys_2) }); _ -> (j_5 xs_1 ys_2) })))\n");
+}
+
+TEST(CoreTest, externs) {
+  auto p = core_of("extern add : Int -> Int -> Int\n"
+                   "inc = add 1\n"
+                   "two = add 1 1\n");
+  EXPECT_EQ(p.to_string(), "inc_0 = (\\a_2 -> (@add 1 a_2))\n"
+                           "two_1 = (@add 1 1)\n");
+  EXPECT_EQ(p.to_string(p[p.top[0]].var), "inc_0");
+  EXPECT_EQ(p.to_string(p[p[p.top[0]].var].ty), "(Int -> Int)");
+  EXPECT_EQ(p.to_string(p[p[p.top[1]].var].ty), "Int");
+}
+
+TEST(CoreTest, casesAndTuples) {
+  auto p = core_of("extern add : Int -> Int -> Int\n"
+                   "f x = case x of\n"
+                   "  0 -> 1\n"
+                   "  n -> add n ((\\(a, b) -> a) (n, 2))\n");
+  EXPECT_EQ(p.to_string(),
+            "f_0 = (\\x_1 -> (let n_2 = x_1 in (case n_2 of { 0 -> 1; "
+            "_ -> (@add n_2 ((\\x_3 -> (case x_3 of { (,) a_4 b_5 -> a_4 }))"
+            " ((,) n_2 2))) })))\n");
+}
+
+TEST(CoreTest, errors) {
+  auto m = module_of("g = h 1\n");
+  auto p = core::desugar(m);
+  ASSERT_FALSE(p.has_value());
+  EXPECT_EQ(p.error().message, "`h` is not in scope");
+  EXPECT_TRUE(p.error().at.valid());
+
+  m = module_of("f = 1\nf = 2\n");
+  p = core::desugar(m);
+  ASSERT_FALSE(p.has_value());
+  EXPECT_EQ(p.error().message, "`f` is defined more than once");
+}
+
+TEST(CoreTest, types) {
+  auto p   = core::Program();
+  auto a   = p.type(core::TCon{name::Id("Int")});
+  auto b   = p.type(core::TCon{name::Id("Int")});
+  auto fn  = p.type(core::TFun{a, b});
+  auto fn2 = p.type(core::TFun{b, a});
+  EXPECT_EQ(a.i, b.i);
+  EXPECT_EQ(fn.i, fn2.i);
+  EXPECT_EQ(p.types.size(), 2);
+  EXPECT_NE(p.fresh_type().i, p.fresh_type().i);
+}
+
+TEST(CoreTest, compact) {
+  auto p = core_of(std::string(LIST) + "f Nil Nil = 1\n"
+                                       "f xs ys = 2\n");
+  // garbage a rewrite would leave behind
+  for (int k = 0; k < 10; ++k)
+    p.add(core::EFail{}, p.fresh_type());
+  auto exprs = p.exprs.size();
+  p.compact();
+  // the variables are renumbered in the order they are reached
+  EXPECT_EQ(p.to_string(),
+            "f_0 = (\\xs_1 ys_2 -> (let j_3 = (\\xs_4 ys_5 -> 2) in "
+            "(case xs_1 of { Nil -> (case ys_2 of { Nil -> 1; "
+            "_ -> (j_3 xs_1 ys_2) }); _ -> (j_3 xs_1 ys_2) })))\n");
+  EXPECT_EQ(p.exprs.size(), exprs - 10);
+  EXPECT_EQ(p.exprs.size(), p.expr_types.size());
+}
+
+TEST(CoreTest, locations) {
+  auto m = module_of("f x = g x\n"
+                     "g y = y\n");
+  auto p = core::desugar(m);
+  ASSERT_TRUE(p.has_value());
+  // the body of `f` is at the application it comes from
+  auto& fn   = std::get<ast::FnDecl>(m[m.items[0]]);
+  auto body  = [&] {
+    return std::get<core::ELam>((*p)[(*p)[p->top[0]].rhs]).body;
+  };
+  auto where = p->loc(body());
+  EXPECT_TRUE(where.valid());
+  EXPECT_EQ(where, m.loc(fn.body));
+  // and stays there through compaction
+  for (int k = 0; k < 10; ++k)
+    p->add(core::EFail{}, p->fresh_type());
+  p->compact();
+  EXPECT_EQ(p->loc(body()), where);
+  EXPECT_EQ(p->expr_locs.size(), p->exprs.size());
+}
@@ -0,0 +1,100 @@
+#include <gtest/gtest.h>
+#include <prelude.hpp>
+
+#include "core/coverage.hpp"
+#include "fixtures.hpp"
+
+using namespace mangekyou;
+using namespace mangekyou::parse;
+using namespace mangekyou::test;
+
+TEST(CoverageTest, tagSet) {
+  auto s = pat::TagSet(130);
+  for (u32 t = 0; t < 130; ++t)
+    if (t != 64 && t != 129)
+      s.set(t);
+  EXPECT_EQ(s.count(), 128);
+  EXPECT_TRUE(s.has(63));
+  EXPECT_FALSE(s.has(64));
+  EXPECT_EQ(s.first_missing(130), 64);
+  s.set(64);
+  EXPECT_EQ(s.first_missing(130), 129);
+  s.set(129);
+  EXPECT_EQ(s.first_missing(130), 130);
+}
+
+TEST(CoverageTest, clauses) {
+  auto m   = module_of(std::string(LIST) + "zip Nil ys = Nil\n"
+                                       "zip xs Nil = Nil\n"
+                                       "zip (Cons x xs) (Cons y ys) = x\n"
+                                       "zip (Cons x xs) Nil = x\n");
+  auto env = pat::ConEnv::collect(m);
+  auto c   = pat::check(m, env, m.items, 1);
+  ASSERT_TRUE(c.has_value()) << c.error().message;
+  EXPECT_TRUE(c->exhaustive());
+  EXPECT_EQ(c->redundant, std::vector<u32>{3});
+}
+
+TEST(CoverageTest, missing) {
+  auto m   = module_of("data Maybe a = Nothing | Just a\n"
+                   "f m = case m of\n  Just (x, Nothing) -> x\n"
+                   "  Nothing -> y\n");
+  auto env = pat::ConEnv::collect(m);
+  auto c   = pat::check(m, env, last_case(m));
+  ASSERT_TRUE(c.has_value()) << c.error().message;
+  EXPECT_TRUE(c->redundant.empty());
+  EXPECT_EQ(c->missing, std::vector<string>{"(Just (_, (Just _)))"});
+}
+
+TEST(CoverageTest, literals) {
+  auto m   = module_of("f n = case n of\n  0 -> a\n  1 -> b\n  0 -> c\n");
+  auto env = pat::ConEnv();
+  auto c   = pat::check(m, env, last_case(m));
+  ASSERT_TRUE(c.has_value());
+  EXPECT_EQ(c->redundant, std::vector<u32>{2});
+  EXPECT_EQ(c->missing, std::vector<string>{"_"});
+}
+
+TEST(CoverageTest, wideType) {
+  auto data = string("data Big = C0");
+  auto alts = string("f b = case b of\n");
+  for (u32 k = 1; k < 300; ++k)
+    data += " | C" + std::to_string(k);
+  for (u32 k = 0; k < 300; ++k)
+    if (k != 217)
+      alts += "  C" + std::to_string(k) + " -> a\n";
+  auto m   = module_of(data + "\n" + alts + "  C5 -> b\n");
+  auto env = pat::ConEnv::collect(m);
+  auto c   = pat::check(m, env, last_case(m));
+  ASSERT_TRUE(c.has_value()) << c.error().message;
+  EXPECT_EQ(c->redundant, std::vector<u32>{299});
+  EXPECT_EQ(c->missing, std::vector<string>{"C217"});
+}
+
+TEST(CoverageTest, typeMismatch) {
+  auto m   = module_of(std::string(LIST) + "data Maybe a = Nothing | Just a\n"
+                                       "f x = case x of\n  Nil -> a\n"
+                                       "  Just y -> y\n");
+  auto env = pat::ConEnv::collect(m);
+  auto c   = pat::check(m, env, last_case(m));
+  ASSERT_FALSE(c.has_value());
+  EXPECT_NE(c.error().message.find("Just"), string::npos);
+}
+
+TEST(CoverageTest, literalAmongConstructors) {
+  auto m   = module_of(std::string(LIST) + "f x = case x of\n  Nil -> 1\n"
+                                       "  3 -> 2\n");
+  auto env = pat::ConEnv::collect(m);
+  auto c   = pat::check(m, env, last_case(m));
+  ASSERT_FALSE(c.has_value());
+  EXPECT_EQ(c.error().message, "literal pattern among constructor patterns");
+}
+
+TEST(CoverageTest, noParameters) {
+  auto m   = module_of("f x = 1\nf = 2\n");
+  auto env = pat::ConEnv::collect(m);
+  auto c   = pat::check(m, env, m.items, 0);
+  ASSERT_FALSE(c.has_value());
+  EXPECT_EQ(c.error().message, "clauses with 1 and 0 parameters");
+  EXPECT_EQ(c.error().at, m.loc(m.items[1]));
+}
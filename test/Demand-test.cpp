@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+#include <prelude.hpp>
+
+#include "core/demand.hpp"
+#include "core/desugar.hpp"
+#include "core/simplify.hpp"
+#include "fixtures.hpp"
+
+using namespace mangekyou;
+using namespace mangekyou::parse;
+using namespace mangekyou::test;
+
+TEST(DemandTest, loop) {
+  // both accumulators are evaluated on every path: no thunk chain builds up
+  auto p = core_of(std::string(PRIMS) + "go acc n = case n of\n"
+                                        "  0 -> acc\n"
+                                        "  m -> go (add acc m) (sub m 1)\n");
+  core::simplify(p);
+  auto s = core::strictness(p);
+  EXPECT_EQ(s.params, 2);
+  EXPECT_EQ(s.args, 2);
+  EXPECT_EQ(p.to_string(),
+            "go_0 = (\\!acc_1 !n_2 -> (case n_2 of { 0 -> acc_1; "
+            "_ -> (case (@add acc_1 n_2) as acc_3 of { "
+            "_ -> (case (@sub n_2 1) as n_4 of { _ -> (go_0 acc_3 n_4) }) "
+            "}) }))\n");
+}
+
+TEST(DemandTest, lets) {
+  // `both` is needed on every path, `one` on one of them
+  auto p = core_of(std::string(PRIMS) + "k x y = let\n"
+                                        "  both = add x x\n"
+                                        "  one = add y y\n"
+                                        "  in case x of\n"
+                                        "    0 -> both\n"
+                                        "    _ -> sub both one\n");
+  core::simplify(p);
+  auto s = core::strictness(p);
+  EXPECT_EQ(s.lets, 1);
+  EXPECT_EQ(s.params, 1);
+  EXPECT_EQ(p.to_string(),
+            "k_0 = (\\!x_1 y_2 -> (case (@add x_1 x_1) as both_3 of { "
+            "_ -> (case x_1 of { 0 -> both_3; "
+            "_ -> (@sub both_3 (@add y_2 y_2)) }) }))\n");
+}
+
+TEST(DemandTest, lazy) {
+  // fields are lazy, and so is a parameter only some calls use
+  auto p = core_of(std::string(PRIMS)
+                   + "data Pair a b = Pair a b\n"
+                     "mk x = Pair x x\n"
+                     "pick b x y = case b of\n"
+                     "  0 -> x\n"
+                     "  _ -> y\n"
+                     "f z = pick z (add z 1) (mk (sub z 1))\n");
+  core::simplify(p);
+  auto s = core::strictness(p);
+  EXPECT_EQ(s.params, 2);
+  EXPECT_EQ(s.args, 0);
+  EXPECT_NE(p.to_string().find("(\\x_"), string::npos);
+  EXPECT_NE(p.to_string().find("(\\!b_"), string::npos);
+}
+
+TEST(DemandTest, divergence) {
+  // a branch that fails demands everything
+  auto p = core_of(std::string(PRIMS) + "data Maybe a = Nothing | Just a\n"
+                                        "get m = case m of\n"
+                                        "  Just x -> x\n");
+  core::simplify(p);
+  core::strictness(p);
+  EXPECT_EQ(p.to_string(), "get_0 = (\\!m_1 -> (case m_1 of { "
+                           "Just x_2 -> x_2; _ -> fail }))\n");
+}
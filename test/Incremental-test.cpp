@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+#include <prelude.hpp>
+
+#include "parse/incremental.hpp"
+
+using namespace mangekyou;
+using namespace mangekyou::parse;
+
+/// every top level function as `name = body`, and where it starts
+static std::vector<std::string> dump(const ast::Module& m) {
+  auto out = std::vector<std::string>();
+  for (usize i = 0; i < m.items.size(); ++i) {
+    auto s = std::to_string(m.starts[i]) + ": ";
+    if (auto* fn = std::get_if<ast::FnDecl>(&m[m.items[i]]))
+      s += fn->id.string() + " = " + m.to_string(fn->body) + " @"
+           + std::to_string(m.loc(fn->body).raw);
+    out.push_back(s);
+  }
+  return out;
+}
+
+/// `doc` after an edit must look like a fresh parse of its text
+static void expect_fresh(const Document& doc) {
+  auto fresh = Document(doc.text);
+  ASSERT_TRUE(fresh.parse().has_value());
+  EXPECT_EQ(dump(doc.module), dump(fresh.module));
+}
+
+static Document open(std::string text) {
+  auto doc = Document(std::move(text));
+  EXPECT_TRUE(doc.parse().has_value());
+  return doc;
+}
+
+TEST(IncrementalTest, editInsideItem) {
+  auto doc = open("a = \"x\"\nb = case y of\n  Just z -> z\nc = \"s\" + 1\n");
+  auto at  = static_cast<u32>(doc.text.find("-> z"));
+  auto r   = doc.edit(Edit{at + 3, 1, "w + 1"});
+  ASSERT_TRUE(r.has_value()) << r.error().message;
+  EXPECT_EQ(r->start, 1);
+  EXPECT_EQ(r->len, 1);
+  expect_fresh(doc);
+  // strings of the items around it are kept, and still view the text
+  EXPECT_EQ(doc.module.to_string(
+                std::get<ast::FnDecl>(doc.module[doc.module.items[2]]).body),
+            "(\"s\" + 1)");
+}
+
+TEST(IncrementalTest, joinAndSplitItems) {
+  auto doc = open("a = f\nb = 2\n");
+  // an indented line at the start of `b` continues `a`
+  auto r = doc.edit(Edit{6, 0, "  + 1\n"});
+  ASSERT_TRUE(r.has_value()) << r.error().message;
+  EXPECT_EQ(r->start, 0);
+  EXPECT_EQ(r->len, 2);
+  expect_fresh(doc);
+  r = doc.edit(Edit{5, 6, "\nc = 3\nd = 4"});
+  ASSERT_TRUE(r.has_value()) << r.error().message;
+  EXPECT_EQ(doc.module.items.size(), 4);
+  expect_fresh(doc);
+}
+
+TEST(IncrementalTest, keepsUntouchedNodes) {
+  auto text = std::string();
+  for (int i = 0; i < 1000; ++i)
+    text += "f" + std::to_string(i) + " x = x + " + std::to_string(i) + "\n";
+  auto doc   = open(text);
+  auto exprs = doc.module.exprs.size();
+  auto at    = static_cast<u32>(doc.text.find("f500 x = x + 500"));
+  auto r     = doc.edit(Edit{at + 13, 3, "(g 1)"});
+  ASSERT_TRUE(r.has_value());
+  // only the damaged items were rebuilt
+  EXPECT_LE(doc.module.exprs.size(), exprs + 16);
+  expect_fresh(doc);
+}
+
+TEST(IncrementalTest, fixityEdits) {
+  auto doc = open("infixl + 6\nx = a + b + c\n");
+  auto r   = doc.edit(Edit{5, 1, "r"});
+  ASSERT_TRUE(r.has_value());
+  EXPECT_EQ(r->len, doc.module.items.size());
+  EXPECT_EQ(doc.module.to_string(
+                std::get<ast::FnDecl>(doc.module[doc.module.items[1]]).body),
+            "(a + (b + c))");
+}
+
+TEST(IncrementalTest, recoversAfterError) {
+  auto doc = open("a = 1\nb = 2\n");
+  auto r   = doc.edit(Edit{10, 1, ""});
+  ASSERT_FALSE(r.has_value());
+  r = doc.edit(Edit{10, 0, "3"});
+  ASSERT_TRUE(r.has_value());
+  expect_fresh(doc);
+}
+
+TEST(IncrementalTest, editOutOfRange) {
+  auto doc = open("a = 1\nb = 2\n");
+  EXPECT_FALSE(doc.edit(Edit{13, 0, "c"}).has_value());
+  EXPECT_FALSE(doc.edit(Edit{10, 3, ""}).has_value());
+  EXPECT_FALSE(doc.edit(Edit{4, ~u32(0), ""}).has_value());
+  EXPECT_EQ(doc.text, "a = 1\nb = 2\n");
+  // the document is as it was: the next edit is incremental
+  auto r = doc.edit(Edit{12, 0, "c = 3\n"});
+  ASSERT_TRUE(r.has_value());
+  expect_fresh(doc);
+}
+
+TEST(IncrementalTest, failedEditKeepsStrings) {
+  auto doc = open("s = \"hello\"\nb = 2\n");
+  // big enough to move `text`, and unbalanced so the reparse fails
+  auto r = doc.edit(Edit{static_cast<u32>(doc.text.size()), 0,
+                         "c = (" + std::string(4096, 'x') + "\n"});
+  ASSERT_FALSE(r.has_value());
+  auto& lit = std::get<std::string_view>(doc.module.lits[0]);
+  EXPECT_EQ(lit, "hello");
+  EXPECT_GE(lit.data(), doc.text.data());
+  EXPECT_LT(lit.data(), doc.text.data() + doc.text.size());
+}
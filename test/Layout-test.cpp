@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+#include <prelude.hpp>
+
+#include "parse/layout.hpp"
+#include "parse/parser.hpp"
+
+using namespace mangekyou;
+using namespace mangekyou::parse;
+
+/// tokens as text, virtual ones as `{v` `;v` `}v`
+static std::string render(std::string_view src) {
+  auto lx   = Lexer(src);
+  auto toks = Layout::run(lx);
+  auto s    = std::string();
+  for (u32 i = 0; i + 1 < toks.size(); ++i) {
+    if (i)
+      s += " ";
+    if (toks.lengths[i] == 0)
+      s += toks.kind(i) == TokenKind::LBrace   ? "{v"
+           : toks.kind(i) == TokenKind::RBrace ? "}v"
+                                               : ";v";
+    else
+      s += toks.text(i);
+  }
+  return s;
+}
+
+TEST(LayoutTest, topLevel) {
+  EXPECT_EQ(render("f x =\n  x\ng = 1\n"), "f x = x ;v g = 1");
+}
+
+TEST(LayoutTest, letBlock) {
+  EXPECT_EQ(render("f = let a = 1\n        b = 2\n    in a + b"),
+            "f = let {v a = 1 ;v b = 2 }v in a + b");
+  EXPECT_EQ(render("f = let a = 1 in a"), "f = let {v a = 1 }v in a");
+}
+
+TEST(LayoutTest, nestedCase) {
+  auto src = "f m = case m of\n"
+             "  Just x -> case x of\n"
+             "    0 -> a\n"
+             "    _ -> b\n"
+             "  Nothing -> c\n"
+             "g = 2";
+  EXPECT_EQ(render(src), "f m = case m of {v Just x -> case x of {v 0 -> a ;v "
+                         "_ -> b }v ;v Nothing -> c }v ;v g = 2");
+}
+
+TEST(LayoutTest, caseInLet) {
+  EXPECT_EQ(render("f = let x = case y of A -> 1 in x"),
+            "f = let {v x = case y of {v A -> 1 }v }v in x");
+  EXPECT_EQ(render("f = let x = case y of A -> let z = 1 in z in x"),
+            "f = let {v x = case y of {v A -> let {v z = 1 }v in z }v }v "
+            "in x");
+  auto lx = Lexer("f y = let x = case y of A -> 1 in x");
+  auto m  = Parser(Layout::run(lx)).parse_module();
+  ASSERT_TRUE(m.has_value()) << m.error().message;
+  EXPECT_EQ(m->to_string(std::get<ast::FnDecl>((*m)[m->items[0]]).body),
+            "(let {1} in x)");
+}
+
+TEST(LayoutTest, brackets) {
+  EXPECT_EQ(render("x = (case a of B -> 1, 2)"),
+            "x = ( case a of {v B -> 1 }v , 2 )");
+  EXPECT_EQ(render("x = case a of { B -> 1;\nC -> 2 }"),
+            "x = case a of { B -> 1 ; C -> 2 }");
+  EXPECT_EQ(render("x = let in 1"), "x = let {v }v in 1");
+}
+
+TEST(LayoutTest, eofClosesBlocks) {
+  EXPECT_EQ(render("f = case a of\n  B -> let\n     y = 1\n   in y"),
+            "f = case a of {v B -> let {v y = 1 }v in y }v");
+}
+
+TEST(LayoutTest, parses) {
+  auto src  = std::string_view("infixl + 6\n"
+                               "f m = case m of\n"
+                               "  Just x ->\n"
+                               "    let y = x\n"
+                               "        z = y\n"
+                               "    in y + z\n"
+                               "  Nothing -> 0\n"
+                               "data Maybe a = Nothing | Just a\n");
+  auto lx   = Lexer(src);
+  auto toks = Layout::run(lx);
+  auto m    = Parser(toks).parse_module();
+  ASSERT_TRUE(m.has_value()) << m.error().message << " @"
+                             << m.error().offset;
+  ASSERT_EQ(m->items.size(), 3);
+  EXPECT_EQ(m->to_string(std::get<ast::FnDecl>((*m)[m->items[1]]).body),
+            "(case m of { (Just x) -> (let {2} in (y + z)); Nothing -> 0 })");
+}
+
+TEST(LayoutTest, deepNesting) {
+  auto src = std::string("f = ");
+  for (int i = 0; i < 2000; ++i)
+    src += "let x = 1 in\n" + std::string(i + 1, ' ');
+  src += "x";
+  auto lx   = Lexer(src);
+  auto toks = Layout::run(lx);
+  EXPECT_TRUE(Parser(toks).parse_module().has_value());
+}
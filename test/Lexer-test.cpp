@@ -0,0 +1,144 @@
+#include <cstdio>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <prelude.hpp>
+
+#include "parse/keyword.hpp"
+#include "parse/lexer.hpp"
+#include "parse/scan.hpp"
+
+using namespace mangekyou::parse;
+
+static std::vector<TokenKind> kinds(std::string_view src) {
+  return Lexer(src).lex().kinds;
+}
+
+TEST(LexerTest, identifiers) {
+  auto src  = std::string_view("foo Bar _ _x a_1");
+  auto lx   = Lexer(src);
+  auto toks = lx.lex();
+  ASSERT_EQ(toks.size(), 6);
+  EXPECT_EQ(toks[0].kind, TokenKind::VarId);
+  EXPECT_EQ(lx.text(toks[0]), "foo");
+  EXPECT_EQ(toks[1].kind, TokenKind::ConId);
+  EXPECT_EQ(toks[2].kind, TokenKind::Underscore);
+  EXPECT_EQ(toks[3].kind, TokenKind::VarId);
+  EXPECT_EQ(lx.text(toks[4]), "a_1");
+  EXPECT_EQ(toks[5].kind, TokenKind::Eof);
+}
+
+TEST(LexerTest, longRuns) {
+  // longer than one AVX2 block, with a non-ident byte past the boundary
+  auto id  = std::string(70, 'a') + "Z09_";
+  auto src = "  \t\n" + std::string(40, ' ') + id + "+" + std::string(33, '\n');
+  auto lx   = Lexer(src);
+  auto toks = lx.lex();
+  ASSERT_EQ(toks.size(), 3);
+  EXPECT_EQ(lx.text(toks[0]), id);
+  EXPECT_EQ(lx.text(toks[1]), "+");
+  EXPECT_EQ(toks[2].offset, src.size());
+}
+
+TEST(LexerTest, operatorsAndSpecials) {
+  EXPECT_EQ(kinds("a >>= (b, [c]) {;} `f` \\"),
+            (std::vector{TokenKind::VarId, TokenKind::Operator,
+                         TokenKind::LParen, TokenKind::VarId, TokenKind::Comma,
+                         TokenKind::LBracket, TokenKind::VarId,
+                         TokenKind::RBracket, TokenKind::RParen,
+                         TokenKind::LBrace, TokenKind::Semi, TokenKind::RBrace,
+                         TokenKind::Backtick, TokenKind::VarId,
+                         TokenKind::Backtick, TokenKind::Backslash,
+                         TokenKind::Eof}));
+}
+
+TEST(LexerTest, comments) {
+  EXPECT_EQ(kinds("a // b c\n// d\nd"),
+            (std::vector{TokenKind::VarId, TokenKind::VarId, TokenKind::Eof}));
+  EXPECT_EQ(kinds("// only"), (std::vector{TokenKind::Eof}));
+}
+
+TEST(LexerTest, literals) {
+  EXPECT_EQ(kinds("12 1.5 0xfF 0o17 0b01 'a' '\\'' \"s\\\"t\" 0x"),
+            (std::vector{TokenKind::IntLit, TokenKind::DecLit,
+                         TokenKind::HexLit, TokenKind::OctLit,
+                         TokenKind::BinLit, TokenKind::CharLit,
+                         TokenKind::CharLit, TokenKind::StringLit,
+                         TokenKind::IntLit, TokenKind::VarId, TokenKind::Eof}));
+  EXPECT_EQ(kinds("\"open"), (std::vector{TokenKind::Error, TokenKind::Eof}));
+  EXPECT_EQ(kinds("\"open\\"),
+            (std::vector{TokenKind::Error, TokenKind::Eof}));
+  EXPECT_EQ(kinds("'\\"), (std::vector{TokenKind::Error, TokenKind::Eof}));
+}
+
+TEST(LexerTest, kernelAgreesWithScalar) {
+  auto src = std::string();
+  auto alphabet = std::string_view("aZ9_ \t\n\r+(\x80\xff");
+  for (u32 i = 0, x = 1; i < 4096; ++i) {
+    x = x * 1103515245 + 12345;
+    src.push_back(alphabet[(x >> 16) % alphabet.size()]);
+  }
+  for (usize i = 0; i < 256; ++i) {
+    auto* p   = src.data() + i;
+    auto* end = src.data() + src.size();
+    auto* id  = p;
+    while (id < end && scan::is(*id, scan::C_IDENT))
+      ++id;
+    auto* sp = p;
+    while (sp < end && scan::is(*sp, scan::C_SPACE))
+      ++sp;
+    EXPECT_EQ(scan::skip_ident(p, end), id);
+    EXPECT_EQ(scan::skip_space(p, end), sp);
+  }
+}
+
+TEST(LexerTest, mappedSource) {
+  auto path = testing::TempDir() + "mangekyou-lexer-test.mk";
+  {
+    auto out = std::ofstream(path);
+    out << "let xs = map f ys";
+  }
+  auto src = Source::open(path);
+  ASSERT_TRUE(src.has_value());
+  auto lx   = Lexer(**src);
+  auto toks = lx.lex();
+  ASSERT_EQ(toks.size(), 7);
+  EXPECT_EQ(toks[1].offset, 4);
+  EXPECT_EQ(toks[1].length, 2);
+  EXPECT_EQ(lx.ident(toks[1]), mangekyou::name::Id("xs"));
+  EXPECT_EQ(toks.ident(4), lx.ident(toks[4]));
+  std::remove(path.c_str());
+
+  EXPECT_FALSE(Source::open(path).has_value());
+}
+
+TEST(LexerTest, tokenBuffer) {
+  auto src = std::string("f (a, [b]) {") + std::string(40, '(')
+             + std::string(40, ')') + "} (c)";
+  auto toks = Lexer(src).lex();
+  EXPECT_EQ(toks.find(0, TokenKind::LBrace), 8);
+  EXPECT_EQ(toks.find(0, TokenKind::Backtick), toks.size());
+  EXPECT_EQ(toks.match_bracket(1), 7);
+  EXPECT_EQ(toks.match_bracket(4), 6);
+  EXPECT_EQ(toks.match_bracket(8), 89);
+  EXPECT_EQ(toks.match_bracket(9), 88);
+  EXPECT_EQ(toks.match_bracket(90), 92);
+  EXPECT_EQ(toks.ident(0).string(), "f");
+  EXPECT_EQ(toks.ident(91), toks.ident(91));
+}
+
+TEST(LexerTest, keywords) {
+  for (auto& e : keyword::RESERVED) {
+    auto toks = Lexer(e.text).lex();
+    EXPECT_EQ(toks.kind(0), e.kind) << e.text;
+  }
+  EXPECT_EQ(kinds("lets inn infixx x -> a ->> ? ??? =="),
+            (std::vector{TokenKind::VarId, TokenKind::VarId, TokenKind::VarId,
+                         TokenKind::VarId, TokenKind::Arrow, TokenKind::VarId,
+                         TokenKind::Operator, TokenKind::Operator,
+                         TokenKind::Operator, TokenKind::Operator,
+                         TokenKind::Eof}));
+  static_assert(keyword::classify("deriving", TokenKind::VarId)
+                == TokenKind::KwDeriving);
+  static_assert(keyword::classify("Data", TokenKind::VarId)
+                == TokenKind::VarId);
+}
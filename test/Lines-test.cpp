@@ -0,0 +1,71 @@
+#include <gtest/gtest.h>
+#include <prelude.hpp>
+
+#include "parse/lexer.hpp"
+#include "parse/lines.hpp"
+#include "parse/location.hpp"
+#include "parse/parser.hpp"
+#include "parse/source.hpp"
+
+using namespace mangekyou;
+using namespace mangekyou::parse;
+
+TEST(LinesTest, lookup) {
+  auto idx = LineIndex("ab\n\ncd\n");
+  ASSERT_EQ(idx.lines(), 4);
+  EXPECT_EQ(idx.lookup(0).line, 1);
+  EXPECT_EQ(idx.lookup(1).col, 2);
+  EXPECT_EQ(idx.lookup(2).line, 1); // the `\n` ends its line
+  EXPECT_EQ(idx.lookup(3).line, 2);
+  EXPECT_EQ(idx.lookup(5).line, 3);
+  EXPECT_EQ(idx.lookup(5).col, 2);
+  EXPECT_EQ(idx.lookup(7).line, 4);
+  EXPECT_EQ(LineIndex("").lines(), 1);
+}
+
+TEST(LinesTest, agreesWithScalar) {
+  // line lengths around the 16/32/64 byte blocks, newlines on the edges
+  auto text = std::string();
+  for (int n = 0; n < 200; ++n)
+    text += std::string(n % 67, 'x') + '\n';
+  text += "tail";
+  auto idx      = LineIndex(text);
+  auto expected = std::vector<u32>{0};
+  for (usize i = 0; i < text.size(); ++i)
+    if (text[i] == '\n')
+      expected.push_back(static_cast<u32>(i + 1));
+  EXPECT_EQ(idx.starts, expected);
+}
+
+TEST(LinesTest, errorLocation) {
+  auto src  = Source::from_string("<test>", "f x = 1\n\ng y =\n  )");
+  auto toks = Lexer(*src).lex();
+  auto m    = Parser(toks).parse_module();
+  ASSERT_FALSE(m.has_value());
+  // no layout: `1 g y` is an application, the second `=` is unexpected
+  auto at = src->location(m.error().offset);
+  EXPECT_EQ(at.line, 3);
+  EXPECT_EQ(at.col, 5);
+}
+
+TEST(LinesTest, sourceManager) {
+  auto sm = SourceManager();
+  auto a  = Source::from_string("a.mk", "x = 1\n");
+  auto b  = Source::from_string("b.mk", "f y =\n  y + z\n");
+  auto ba = sm.add(a);
+  auto bb = sm.add(b);
+  ASSERT_TRUE(ba && bb);
+  EXPECT_EQ(*bb, a->text().size() + 1);
+
+  auto toks = Lexer(*b).lex();
+  auto p    = Parser(toks);
+  p.base    = *bb;
+  auto m    = p.parse_module();
+  ASSERT_TRUE(m.has_value());
+  auto& f = std::get<ast::FnDecl>((*m)[m->items[0]]);
+  EXPECT_EQ(sm.describe(m->loc(m->items[0])), "b.mk:1:1");
+  EXPECT_EQ(sm.describe(m->loc(f.body)), "b.mk:2:3");
+  EXPECT_EQ(sm.describe(m->loc(m->at<ast::PatRef>(f.params, 0))), "b.mk:1:3");
+  EXPECT_EQ(sm.describe(sm.loc(*ba, 4)), "a.mk:1:5");
+  EXPECT_EQ(sm.describe(SourceLoc()), "<unknown>");
+}
@@ -0,0 +1,101 @@
+#include <cstring>
+#include <gtest/gtest.h>
+#include <prelude.hpp>
+
+#include "parse/literal.hpp"
+
+using namespace mangekyou::parse;
+using namespace mangekyou::parse::literal;
+
+static u64 small(std::string_view s, TokenKind k = TokenKind::IntLit) {
+  return std::get<u64>(parse_int(s, k));
+}
+static std::string big(std::string_view s, TokenKind k = TokenKind::IntLit) {
+  return std::get<Integer>(parse_int(s, k)).to_string();
+}
+
+TEST(LiteralTest, swar8) {
+  u64 chunk;
+  std::memcpy(&chunk, "12345678", 8);
+  EXPECT_EQ(swar8(chunk, 10), 12345678);
+  std::memcpy(&chunk, "deadBEEF", 8);
+  EXPECT_EQ(swar8(chunk, 16), 0xdeadbeef);
+  std::memcpy(&chunk, "01234567", 8);
+  EXPECT_EQ(swar8(chunk, 8), 01234567);
+  std::memcpy(&chunk, "10110011", 8);
+  EXPECT_EQ(swar8(chunk, 2), 0b10110011);
+}
+
+TEST(LiteralTest, ints) {
+  EXPECT_EQ(small("0"), 0);
+  EXPECT_EQ(small("42"), 42);
+  EXPECT_EQ(small("1234567890123"), 1234567890123);
+  EXPECT_EQ(small("18446744073709551615"), 18446744073709551615u);
+  EXPECT_EQ(small("0xff", TokenKind::HexLit), 255);
+  EXPECT_EQ(small("0xFFFFFFFFFFFFFFFF", TokenKind::HexLit), ~u64(0));
+  EXPECT_EQ(small("0o777", TokenKind::OctLit), 0777);
+  EXPECT_EQ(small("0b1011001110001111", TokenKind::BinLit), 0b1011001110001111);
+}
+
+TEST(LiteralTest, overflowToInteger) {
+  EXPECT_EQ(big("18446744073709551616"), "18446744073709551616");
+  EXPECT_EQ(big("123456789012345678901234567890123456789"),
+            "123456789012345678901234567890123456789");
+  EXPECT_EQ(big("0x10000000000000000", TokenKind::HexLit),
+            "18446744073709551616");
+  EXPECT_EQ(big("0b1" + std::string(64, '0'), TokenKind::BinLit),
+            "18446744073709551616");
+}
+
+TEST(LiteralTest, decimals) {
+  EXPECT_EQ(parse_dec("1.5"), 1.5);
+  EXPECT_EQ(parse_dec("0.1"), 0.1);
+  EXPECT_EQ(parse_dec("3.14159265358979"), 3.14159265358979);
+  EXPECT_EQ(parse_dec("123456789.123456789"), 123456789.123456789);
+  // past the fast path
+  EXPECT_EQ(parse_dec("9007199254740993.0"), 9007199254740992.0);
+  EXPECT_EQ(parse_dec("0.30000000000000000000000000001"), 0.3);
+}
+
+TEST(LiteralTest, strings) {
+  auto arena = Arena();
+  auto src   = std::string_view("\"plain text\"");
+  auto plain = decode_string(src, arena);
+  ASSERT_TRUE(plain.has_value());
+  EXPECT_EQ(*plain, "plain text");
+  EXPECT_EQ(plain->data(), src.data() + 1);
+  EXPECT_EQ(arena.bytes(), 0);
+
+  auto esc = decode_string("\"a\\tb\\\\c\\\"d\\n\"", arena);
+  ASSERT_TRUE(esc.has_value());
+  EXPECT_EQ(*esc, "a\tb\\c\"d\n");
+
+  auto nul = decode_string("\"x\\0y\"", arena);
+  EXPECT_EQ(*nul, std::string_view("x\0y", 3));
+
+  EXPECT_FALSE(decode_string("\"\\q\"", arena).has_value());
+}
+
+TEST(LiteralTest, movedArena) {
+  auto arena = Arena();
+  auto tab   = decode_string("\"a\\tb\"", arena);
+  auto used  = arena.bytes();
+  auto moved = std::move(arena);
+  EXPECT_EQ(moved.bytes(), used);
+  EXPECT_EQ(arena.bytes(), 0);
+  // the moved-from arena starts over in a block of its own
+  auto mine   = decode_string("\"c\\td\"", arena);
+  auto theirs = decode_string("\"e\\tf\"", moved);
+  EXPECT_EQ(*tab, "a\tb");
+  EXPECT_EQ(*mine, "c\td");
+  EXPECT_EQ(*theirs, "e\tf");
+}
+
+TEST(LiteralTest, chars) {
+  EXPECT_EQ(decode_char("'a'"), 'a');
+  EXPECT_EQ(decode_char("'\\n'"), '\n');
+  EXPECT_EQ(decode_char("'\\''"), '\'');
+  EXPECT_FALSE(decode_char("''").has_value());
+  EXPECT_FALSE(decode_char("'ab'").has_value());
+  EXPECT_FALSE(decode_char("'\\x'").has_value());
+}
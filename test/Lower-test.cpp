@@ -0,0 +1,91 @@
+#include <gtest/gtest.h>
+#include <prelude.hpp>
+
+#include "core/lower.hpp"
+#include "fixtures.hpp"
+
+using namespace mangekyou;
+using namespace mangekyou::parse;
+using namespace mangekyou::test;
+
+/// the dispatch of the root switch of the `case` in the last item, after
+/// checking every case key reaches its case and others the fallback
+static pat::Dispatch root(std::string_view src) {
+  auto m   = module_of(src);
+  auto env = pat::ConEnv::collect(m);
+  auto t   = pat::compile(m, env, last_case(m));
+  EXPECT_TRUE(t.has_value()) << t.error().message;
+  auto& sw = std::get<pat::Switch>((*t)[t->root]);
+  auto d   = pat::lower(*t, m)[t->root.i];
+  for (u32 k = 0; k < sw.cases.len; ++k) {
+    if (auto n = pat::key(m, t->at(sw.cases, k))) {
+      EXPECT_EQ(d.target(*t, sw, *n).i, t->at(sw.cases, k).next.i);
+    }
+  }
+  EXPECT_EQ(d.target(*t, sw, 1000000).i, sw.fallback.i);
+  return d;
+}
+
+TEST(LowerTest, chain) {
+  auto d = root("f n = case n of\n  0 -> a\n  7 -> b\n  k -> k\n");
+  EXPECT_EQ(d.kind, pat::Dispatch::Chain);
+  EXPECT_EQ(d.keys, (std::vector<u64>{0, 7}));
+}
+
+TEST(LowerTest, denseChars) {
+  auto d = root("f c = case c of\n  'a' -> a\n  'b' -> b\n  'd' -> d\n"
+                "  'e' -> e\n  'c' -> c\n  _ -> z\n");
+  ASSERT_EQ(d.kind, pat::Dispatch::Table);
+  EXPECT_EQ(d.lo, 'a');
+  EXPECT_EQ(d.table, (std::vector<u32>{0, 1, 4, 2, 3}));
+}
+
+TEST(LowerTest, sparseIntegers) {
+  auto d = root("f n = case n of\n  900 -> a\n  3 -> b\n  70000 -> c\n"
+                "  12 -> d\n  _ -> z\n");
+  ASSERT_EQ(d.kind, pat::Dispatch::Search);
+  EXPECT_EQ(d.keys, (std::vector<u64>{3, 12, 900, 70000}));
+  EXPECT_EQ(d.cases, (std::vector<u32>{1, 3, 0, 2}));
+}
+
+TEST(LowerTest, fullRange) {
+  // the keys span every u64: the slot count would wrap to 0
+  auto d = root("f n = case n of\n  0 -> a\n  1 -> b\n  2 -> e\n"
+                "  18446744073709551615 -> c\n  k -> k\n");
+  ASSERT_EQ(d.kind, pat::Dispatch::Search);
+  EXPECT_EQ(d.keys, (std::vector<u64>{0, 1, 2, ~u64(0)}));
+}
+
+TEST(LowerTest, constructors) {
+  auto src = string("data Op = Op0");
+  for (u32 k = 1; k < 40; ++k)
+    src += " | Op" + std::to_string(k);
+  src += "\nf o = case o of\n";
+  for (u32 k = 0; k < 40; k += 2)
+    src += "  Op" + std::to_string(k) + " -> a\n";
+  auto d = root(src + "  _ -> b\n");
+  ASSERT_EQ(d.kind, pat::Dispatch::Table);
+  EXPECT_EQ(d.table.size(), 39);
+  EXPECT_EQ(d.table[1], pat::Dispatch::NO_CASE);
+}
+
+TEST(LowerTest, strings) {
+  auto d = root("f s = case s of\n  \"a\" -> a\n  \"b\" -> b\n  \"c\" -> c\n"
+                "  \"d\" -> d\n  _ -> z\n");
+  EXPECT_EQ(d.kind, pat::Dispatch::Chain);
+  EXPECT_TRUE(d.keys.empty());
+}
+
+TEST(LowerTest, mixedLiterals) {
+  // `'a'` and `97` are different cases with the same key
+  auto m   = module_of("f x = case x of\n  'a' -> a\n  97 -> b\n  'b' -> c\n"
+                       "  98 -> d\n  _ -> z\n");
+  auto env = pat::ConEnv::collect(m);
+  auto t   = pat::compile(m, env, last_case(m));
+  ASSERT_TRUE(t.has_value()) << t.error().message;
+  auto& sw = std::get<pat::Switch>((*t)[t->root]);
+  ASSERT_EQ(sw.cases.len, 4);
+  auto d = pat::lower(*t, m)[t->root.i];
+  EXPECT_EQ(d.kind, pat::Dispatch::Chain);
+  EXPECT_TRUE(d.keys.empty());
+}
@@ -0,0 +1,110 @@
+#include <gtest/gtest.h>
+#include <prelude.hpp>
+
+#include "core/match.hpp"
+#include "fixtures.hpp"
+
+using namespace mangekyou;
+using namespace mangekyou::parse;
+using namespace mangekyou::test;
+
+/// no occurrence is switched on twice along any path
+static bool tests_once(const pat::DecisionTree& t, pat::DRef r,
+                       std::vector<u32>& path) {
+  auto* sw = std::get_if<pat::Switch>(&t[r]);
+  if (!sw)
+    return true;
+  if (std::find(path.begin(), path.end(), sw->occ.i) != path.end())
+    return false;
+  path.push_back(sw->occ.i);
+  bool ok = true;
+  for (u32 k = 0; k < sw->cases.len; ++k)
+    ok = ok && tests_once(t, t.at(sw->cases, k).next, path);
+  if (sw->fallback.valid())
+    ok = ok && tests_once(t, sw->fallback, path);
+  path.pop_back();
+  return ok;
+}
+
+TEST(MatchTest, clauses) {
+  auto m   = module_of(std::string(LIST) + "zip Nil ys = Nil\n"
+                                       "zip xs Nil = Nil\n"
+                                       "zip (Cons x xs) (Cons y ys) = x\n");
+  auto env = pat::ConEnv::collect(m);
+  auto cs  = pat::clauses(m, m.items, 1);
+  ASSERT_EQ(cs.size(), 3);
+  auto t = pat::compile(m, env, m.items, 1);
+  ASSERT_TRUE(t.has_value()) << t.error().message;
+  EXPECT_EQ(t->to_string(m, env),
+            "($0 { Nil: #0 {ys=$1}; Cons: ($1 { Nil: #1 {xs=$0}; "
+            "Cons: #2 {x=$0.0, xs=$0.1, y=$1.0, ys=$1.1} }) })");
+  auto path = std::vector<u32>();
+  EXPECT_TRUE(tests_once(*t, t->root, path));
+}
+
+TEST(MatchTest, literalsAndDefaults) {
+  auto m   = module_of("f n = case n of\n  0 -> a\n  1 -> b\n  0 -> c\n"
+                   "  k -> k\n");
+  auto env = pat::ConEnv();
+  auto t   = pat::compile(m, env, last_case(m));
+  ASSERT_TRUE(t.has_value());
+  EXPECT_EQ(t->to_string(m, env), "($0 { 0: #0; 1: #1; _: #3 {k=$0} })");
+}
+
+TEST(MatchTest, nonExhaustive) {
+  auto m   = module_of("data Maybe a = Nothing | Just a\n"
+                   "f m = case m of\n  Just (x, Nothing) -> x\n"
+                   "  Just p@(_, Just y) -> y\n");
+  auto env = pat::ConEnv::collect(m);
+  auto t   = pat::compile(m, env, last_case(m));
+  ASSERT_TRUE(t.has_value()) << t.error().message;
+  EXPECT_EQ(t->to_string(m, env),
+            "($0 { Just: ($0.0 { (,): ($0.0.1 { Nothing: #0 {x=$0.0.0}; "
+            "Just: #1 {p=$0.0, y=$0.0.1.0} }) }); _: fail })");
+}
+
+TEST(MatchTest, eachTestOnce) {
+  // every clause refutes a different column: a clause-by-clause matcher
+  // would test the first columns over and over
+  auto src = std::string(LIST);
+  for (int i = 0; i < 6; ++i) {
+    src += "f";
+    for (int j = 0; j < 6; ++j)
+      src += i == j ? " Nil" : j < i ? " (Cons _ _)" : " _";
+    src += " = " + std::to_string(i) + "\n";
+  }
+  auto m   = module_of(src);
+  auto env = pat::ConEnv::collect(m);
+  auto t   = pat::compile(m, env, m.items, 1);
+  ASSERT_TRUE(t.has_value());
+  auto path = std::vector<u32>();
+  EXPECT_TRUE(tests_once(*t, t->root, path));
+  // the shared `fail`, then a switch and a leaf per column
+  EXPECT_EQ(t->nodes.size(), 1 + 6 + 6);
+}
+
+TEST(MatchTest, errors) {
+  auto m   = module_of(std::string(LIST) + "f Nil = 1\nf (Cons x) = 2\n"
+                                       "g Nil = 1\ng Nothing = 2\n"
+                                       "h Nil = 1\nh x y = 2\n");
+  auto env = pat::ConEnv::collect(m);
+  auto f   = pat::compile(m, env, m.items, 1);
+  ASSERT_FALSE(f.has_value());
+  EXPECT_EQ(f.error().message, "constructor `Cons` takes 2 arguments");
+  auto g = pat::compile(m, env, m.items, 3);
+  ASSERT_FALSE(g.has_value());
+  EXPECT_EQ(g.error().message, "unknown constructor `Nothing`");
+  auto h = pat::compile(m, env, m.items, 5);
+  ASSERT_FALSE(h.has_value());
+  EXPECT_EQ(h.error().at, m.loc(m.items[6]));
+}
+
+TEST(MatchTest, noParameters) {
+  // the clause without parameters has no pattern to report the error at
+  auto m   = module_of("f x = 1\nf = 2\n");
+  auto env = pat::ConEnv::collect(m);
+  auto t   = pat::compile(m, env, m.items, 0);
+  ASSERT_FALSE(t.has_value());
+  EXPECT_EQ(t.error().message, "clauses with 1 and 0 parameters");
+  EXPECT_EQ(t.error().at, m.loc(m.items[1]));
+}
@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+#include <prelude.hpp>
+
+#include "parse/layout.hpp"
+#include "parse/parallel.hpp"
+
+using namespace mangekyou;
+using namespace mangekyou::parse;
+
+static std::vector<std::string> bodies(const ast::Module& m) {
+  auto out = std::vector<std::string>();
+  for (auto item : m.items)
+    if (auto* fn = std::get_if<ast::FnDecl>(&m[item]))
+      out.push_back(fn->id.string() + " = " + m.to_string(fn->body));
+  return out;
+}
+
+static PResult<ast::Module> parse_sequential(std::string_view src) {
+  auto lexer = Lexer(src);
+  auto toks  = Layout::run(lexer);
+  return Parser(toks).parse_module();
+}
+
+/// `n` items of a few lines each, `x <> y` needs the fixity at the end
+static std::string items(usize n) {
+  auto src = std::string();
+  for (usize i = 0; i < n; ++i)
+    src += "f" + std::to_string(i) + " x = case x of\n"
+           + "  Just y -> let z = y <> " + std::to_string(i) + " <> \"s\"\n"
+           + "            in (z, 'c')\n  Nothing -> \\a -> a\n"
+           + "// comment\n";
+  return src + "infixr <> 5\n";
+}
+
+TEST(ParallelTest, splitItems) {
+  auto src  = std::string_view("a = 1\n  + 2\nb = 2\n\n  c\n(+) = d\ne");
+  auto cuts = split_items(src, 4);
+  ASSERT_EQ(cuts.size(), 4);
+  EXPECT_EQ(cuts[0], 0);
+  EXPECT_EQ(src.substr(cuts[1], 1), "b");
+  EXPECT_EQ(src.substr(cuts[2], 1), "(");
+  EXPECT_EQ(src.substr(cuts[3], 1), "e");
+  EXPECT_EQ(split_items("a = 1 +\n  2\n", 3).size(), 1);
+}
+
+TEST(ParallelTest, sameAsSequential) {
+  auto src = items(20000);
+  ASSERT_GT(src.size(), 4 * MIN_CHUNK);
+  ASSERT_GT(split_items(src, 4).size(), 1);
+  auto seq = parse_sequential(src);
+  auto par = parse_parallel(src, 4);
+  ASSERT_TRUE(seq.has_value()) << seq.error().message;
+  ASSERT_TRUE(par.has_value()) << par.error().message;
+  EXPECT_EQ(par->items.size(), seq->items.size());
+  EXPECT_EQ(bodies(*par), bodies(*seq));
+  EXPECT_EQ(par->arena.bytes(), seq->arena.bytes());
+}
+
+TEST(ParallelTest, cutInsideString) {
+  auto src = items(2000) + "s = \"";
+  for (int i = 0; i < 50000; ++i)
+    src += "line\n";
+  src += "\"\n" + items(2000);
+  auto par = parse_parallel(src, 4);
+  ASSERT_TRUE(par.has_value()) << par.error().message;
+  EXPECT_EQ(bodies(*par), bodies(*parse_sequential(src)));
+}
+
+TEST(ParallelTest, errors) {
+  auto src = items(20000);
+  src.insert(src.size() / 2, "\ng x = = 1\n");
+  auto seq = parse_sequential(src);
+  auto par = parse_parallel(src, 4);
+  ASSERT_FALSE(seq.has_value());
+  ASSERT_FALSE(par.has_value());
+  EXPECT_EQ(par.error().offset, seq.error().offset);
+}
+
+TEST(ParallelTest, headerInsideFile) {
+  // a chunk starting with `import` is past the header all the same
+  auto src = items(20000);
+  src.insert(src.find('\n', src.size() / 2) + 1, "import A\n");
+  ASSERT_EQ(src.substr(split_items(src, 2)[1], 6), "import");
+  auto seq = parse_sequential(src);
+  auto par = parse_parallel(src, 2);
+  ASSERT_FALSE(seq.has_value());
+  ASSERT_FALSE(par.has_value());
+  EXPECT_EQ(par.error().message, seq.error().message);
+  EXPECT_EQ(par.error().offset, seq.error().offset);
+}
@@ -0,0 +1,180 @@
+#include <gtest/gtest.h>
+#include <prelude.hpp>
+
+#include "parse/layout.hpp"
+#include "parse/lexer.hpp"
+#include "parse/parser.hpp"
+
+using namespace mangekyou;
+using namespace mangekyou::parse;
+
+static std::string parse_expr(std::string_view src) {
+  auto toks = Lexer(src).lex();
+  auto p    = Parser(toks);
+  auto e    = p.expr();
+  if (!e)
+    return "error: " + e.error().message;
+  return p.module.to_string(*e);
+}
+
+static PResult<ast::Module> parse_module(const TokenBuffer& toks) {
+  return Parser(toks).parse_module();
+}
+
+TEST(ParserTest, defaultFixity) {
+  EXPECT_EQ(parse_expr("a + b + c"), "((a + b) + c)");
+  EXPECT_EQ(parse_expr("f x y + g z"), "(((f x) y) + (g z))");
+  EXPECT_EQ(parse_expr("a `div` b"), "(a div b)");
+}
+
+TEST(ParserTest, declaredFixities) {
+  auto src  = std::string_view("infixl + 6; infixl * 7; infixr ^ 8;"
+                               "infix == 4;"
+                               "x = a + b * c ^ d ^ e == f * g + h");
+  auto toks = Lexer(src).lex();
+  auto m    = parse_module(toks);
+  ASSERT_TRUE(m.has_value()) << m.error().message;
+  ASSERT_EQ(m->items.size(), 5);
+  auto& fn = std::get<ast::FnDecl>((*m)[m->items[4]]);
+  EXPECT_EQ(m->to_string(fn.body),
+            "((a + (b * (c ^ (d ^ e)))) == ((f * g) + h))");
+}
+
+TEST(ParserTest, fixityDeclaredAfterUse) {
+  auto toks = Lexer("x = a - b - c; infixr - 6").lex();
+  auto m    = parse_module(toks);
+  ASSERT_TRUE(m.has_value());
+  EXPECT_EQ(m->to_string(std::get<ast::FnDecl>((*m)[m->items[0]]).body),
+            "(a - (b - c))");
+  auto& op = std::get<ast::OpDecl>((*m)[m->items[1]]);
+  EXPECT_EQ(op.assoc, ast::Assoc::Right);
+  EXPECT_EQ(op.prec, 6);
+}
+
+TEST(ParserTest, nonAssociative) {
+  auto toks = Lexer("infix == 4; x = a == b == c").lex();
+  EXPECT_FALSE(parse_module(toks).has_value());
+  auto ok = Lexer("infix == 4; x = (a == b) == c").lex();
+  EXPECT_TRUE(parse_module(ok).has_value());
+}
+
+TEST(ParserTest, mixedAssociativity) {
+  auto fails = [](std::string_view src) {
+    auto toks = Lexer(src).lex();
+    auto m    = parse_module(toks);
+    return !m.has_value();
+  };
+  EXPECT_TRUE(fails("infixl + 6; infixr ^ 6; x = a + b ^ c"));
+  EXPECT_TRUE(fails("infixl + 6; infixr ^ 6; x = a ^ b + c"));
+  EXPECT_TRUE(fails("infixl < 4; infix == 4; x = a < b == c"));
+  EXPECT_TRUE(fails("infixl < 4; infix == 4; x = a == b < c"));
+  EXPECT_FALSE(fails("infixl + 6; infixr ^ 6; x = (a + b) ^ c"));
+  EXPECT_FALSE(fails("infixl + 6; infixl - 6; x = a + b - c"));
+  EXPECT_FALSE(fails("infixl + 6; infixr ^ 8; x = a + b ^ c + d"));
+}
+
+TEST(ParserTest, expressions) {
+  EXPECT_EQ(parse_expr("\\x (y : Int) -> x + y"),
+            "(\\x -> (\\(y : Int) -> (x + y)))");
+  EXPECT_EQ(parse_expr("case m of { Just x -> x; Nothing -> 0 }"),
+            "(case m of { (Just x) -> x; Nothing -> 0 })");
+  EXPECT_EQ(parse_expr("let { y = 1; z = 2 } in y + z"),
+            "(let {2} in (y + z))");
+  EXPECT_EQ(parse_expr("(a, (+), ()) : T"), "((a, +, ()) : T)");
+  EXPECT_EQ(parse_expr("f \"s\\n\" 'c' 1.5 0x10"),
+            "((((f \"s\n\") 'c') 1.5) 16)");
+  EXPECT_EQ(parse_expr("a + \\x -> x + 1"), "(a + (\\x -> (x + 1)))");
+}
+
+TEST(ParserTest, items) {
+  auto toks = Lexer("data Maybe a = Nothing | Just a;"
+                    "type Pair a = (a, a) -> Maybe a;"
+                    "extern puts : String -> ();"
+                    "(<>) : a -> a -> a;"
+                    "f xs@(Cons _ t) 0 = t")
+                  .lex();
+  auto m = parse_module(toks);
+  ASSERT_TRUE(m.has_value()) << m.error().message;
+  auto& data = std::get<ast::DataDecl>((*m)[m->items[0]]);
+  EXPECT_EQ(data.cons.len, 2);
+  EXPECT_EQ(m->names[data.params.start].string(), "a");
+  auto& just = (*m)[m->at<Ref<ast::DataCon>>(data.cons, 1)];
+  EXPECT_EQ(m->to_string(m->at<ast::TypeRef>(just.args, 0)), "a");
+  EXPECT_EQ(m->to_string(std::get<ast::TypeSyn>((*m)[m->items[1]]).rhs),
+            "((a, a) -> (Maybe a))");
+  EXPECT_TRUE((*m)[m->items[2]].is<ast::ExternDecl>());
+  EXPECT_EQ(std::get<ast::TypeSig>((*m)[m->items[3]]).id.string(), "<>");
+  auto& f = std::get<ast::FnDecl>((*m)[m->items[4]]);
+  ASSERT_EQ(f.params.len, 2);
+  EXPECT_EQ(m->to_string(m->at<ast::PatRef>(f.params, 0)), "xs@(Cons _ t)");
+  EXPECT_EQ(m->to_string(m->at<ast::PatRef>(f.params, 1)), "0");
+}
+
+TEST(ParserTest, pools) {
+  auto toks = Lexer("x = 18446744073709551616 + f \"a\\tb\" 1").lex();
+  auto m    = parse_module(toks);
+  ASSERT_TRUE(m.has_value()) << m.error().message;
+  // big integer limbs and escaped strings are copied into the arena
+  EXPECT_EQ(m->lits.size(), 3);
+  auto& big = std::get<pat::BigInt>(m->lits[0]);
+  EXPECT_EQ(big.value().to_string(), "18446744073709551616");
+  EXPECT_EQ(std::get<std::string_view>(m->lits[1]), "a\tb");
+  EXPECT_GE(m->arena.bytes(), 12 + 3);
+}
+
+TEST(ParserTest, errors) {
+  auto toks = Lexer("f x = ").lex();
+  auto m    = parse_module(toks);
+  ASSERT_FALSE(m.has_value());
+  EXPECT_EQ(m.error().offset, 6);
+}
+
+TEST(ParserTest, recovery) {
+  auto src  = std::string_view("a = 1\n"
+                               "b = = 2\n"
+                               "c x = case x of\n"
+                               "  Just -> ) 1\n"
+                               "  Nothing -> 0\n"
+                               "d = (1,\n"
+                               "e = 3\n");
+  auto lx   = Lexer(src);
+  auto toks = Layout::run(lx);
+  auto p    = Parser(toks);
+  auto m    = p.parse_module();
+  ASSERT_FALSE(m.has_value());
+  ASSERT_EQ(p.errors.size(), 3);
+  EXPECT_EQ(p.errors[0].offset, src.find("= 2"));
+  EXPECT_EQ(p.errors[1].offset, src.find(")"));
+  EXPECT_EQ(p.errors[2].offset, src.find("e = 3"));
+  // everything else still parsed, down to the healthy case branch
+  ASSERT_EQ(p.module.items.size(), 3);
+  auto& c = std::get<ast::FnDecl>(p.module[p.module.items[1]]);
+  EXPECT_EQ(p.module.to_string(c.body), "(case x of { Nothing -> 0 })");
+  EXPECT_EQ(p.module.starts[2], src.find("e = 3"));
+}
+
+TEST(ParserTest, recoveryIsLinear) {
+  // nested unclosed brackets on every line: a backtracking parser would
+  // retry each prefix
+  auto src = std::string();
+  for (int i = 0; i < 20000; ++i)
+    src += "f = ((((((( x ->\n  case of of of\n";
+  auto lx   = Lexer(src);
+  auto toks = Layout::run(lx);
+  auto p    = Parser(toks);
+  EXPECT_FALSE(p.parse_module().has_value());
+  EXPECT_EQ(p.errors.size(), 20000);
+}
+
+TEST(ParserTest, moduleHeader) {
+  auto lx   = Lexer("module Data.Map\nimport Data.List\nimport Prelude\n"
+                    "x = 1\n");
+  auto toks = Layout::run(lx);
+  auto m    = Parser(toks).parse_module();
+  ASSERT_TRUE(m.has_value()) << m.error().message;
+  EXPECT_EQ(m->name, mangekyou::name::Id("Data.Map"));
+  ASSERT_EQ(m->imports.size(), 2);
+  EXPECT_EQ(m->imports[0].module, mangekyou::name::Id("Data.List"));
+  EXPECT_EQ(m->imports[1].at.raw, 33);
+  EXPECT_EQ(m->items.size(), 1);
+}
@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+#include <prelude.hpp>
+
+#include "core/demand.hpp"
+#include "core/desugar.hpp"
+#include "core/prim.hpp"
+#include "core/simplify.hpp"
+#include "core/worker.hpp"
+#include "fixtures.hpp"
+
+using namespace mangekyou;
+using namespace mangekyou::parse;
+using namespace mangekyou::test;
+
+TEST(PrimTest, externs) {
+  auto p = core_of("extern add : Int -> Int -> Int\n"
+                   "inc x = add x 1\n");
+  auto s = core::represent(p);
+  EXPECT_EQ(s.literals, 1);
+  EXPECT_EQ(s.calls, 1);
+  // the extern is the machine addition, its call unpacks and boxes
+  EXPECT_EQ(p.to_string(p.externs[0].ty), "(Int# -> (Int# -> Int#))");
+  EXPECT_EQ(p.to_string(),
+            "inc_0 = (\\x_1 -> (case x_1 of { I# x#_2 -> "
+            "(case (I# 1) of { I# x#_3 -> (I# (@add x#_2 x#_3)) }) }))\n");
+  auto& box = p.data[p.data.size() - 4];
+  EXPECT_EQ(box.name, name::Id("Int"));
+  EXPECT_EQ(core::rep(p, box.cons[0].fields[0]), core::Rep::Int);
+  EXPECT_EQ(core::rep(p, p.type(core::TCon{name::Id("Int")})),
+            core::Rep::Boxed);
+}
+
+TEST(PrimTest, cases) {
+  // a `case` on literals switches on the machine value
+  auto p = core_of("extern half : Double -> Double\n"
+                   "f c = case c of\n"
+                   "  'a' -> half 1.5\n"
+                   "  _ -> 0.5\n");
+  auto s = core::represent(p);
+  EXPECT_EQ(s.cases, 1);
+  EXPECT_EQ(p.to_string(),
+            "f_0 = (\\c_1 -> (let x_2 = c_1 in (case x_2 of { "
+            "C# x#_4 -> (case x#_4 of { "
+            "'a' -> (case (D# 1.5) of { D# x#_3 -> (D# (@half x#_3)) }); "
+            "_ -> (D# 0.5) }) })))\n");
+  core::simplify(p);
+  EXPECT_EQ(p.to_string(),
+            "f_0 = (\\c_1 -> (case c_1 of { C# x#_2 -> (case x#_2 of { "
+            "'a' -> (D# (@half 1.5)); _ -> (D# 0.5) }) }))\n");
+}
+
+TEST(PrimTest, loop) {
+  auto p = core_of(std::string(PRIMS)
+                   + "go : Int -> Int -> Int\n"
+                     "go acc n = case n of\n"
+                     "  0 -> acc\n"
+                     "  m -> go (add acc m) (sub m 1)\n");
+  core::represent(p);
+  core::simplify(p);
+  core::strictness(p);
+  EXPECT_EQ(core::worker_wrapper(p).unboxed, 2);
+  core::simplify(p);
+  // the worker loops on machine integers, boxing only its result
+  EXPECT_EQ(p.to_string(),
+            "go_0 = (\\!acc_1 !n_2 -> (case acc_1 of { I# acc#_3 -> "
+            "(case n_2 of { I# n#_4 -> ($wgo_5 acc#_3 n#_4) }) }))\n"
+            "$wgo_5 = (\\!acc#_6 !n#_7 -> (case n#_7 of { "
+            "0 -> (I# acc#_6); "
+            "_ -> ($wgo_5 (@add acc#_6 n#_7) (@sub n#_7 1)) }))\n");
+}
+
+TEST(PrimTest, again) {
+  auto p = core_of("extern add : Int -> Int -> Int\n"
+                   "f x = case add x 1 of\n"
+                   "  2 -> 'a'\n"
+                   "  _ -> 'b'\n");
+  core::represent(p);
+  auto once = p.to_string();
+  auto data = p.data.size();
+  auto s    = core::represent(p);
+  EXPECT_EQ(s.literals + s.cases + s.calls, 0);
+  EXPECT_EQ(p.to_string(), once);
+  EXPECT_EQ(p.data.size(), data);
+}
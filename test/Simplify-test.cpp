@@ -0,0 +1,126 @@
+#include <gtest/gtest.h>
+#include <prelude.hpp>
+
+#include "core/desugar.hpp"
+#include "core/simplify.hpp"
+#include "fixtures.hpp"
+
+using namespace mangekyou;
+using namespace mangekyou::parse;
+using namespace mangekyou::test;
+
+TEST(SimplifyTest, knownConstructor) {
+  auto p = core_of("data Maybe a = Nothing | Just a\n"
+                   "fromMaybe d m = case m of\n"
+                   "  Nothing -> d\n"
+                   "  Just x -> x\n"
+                   "f y = fromMaybe 0 (Just y)\n");
+  auto s = core::simplify(p);
+  EXPECT_EQ(p.to_string(),
+            "fromMaybe_0 = (\\d_1 m_2 -> (case m_2 of { Nothing -> d_1; "
+            "Just x_3 -> x_3 }))\n"
+            "f_4 = (\\y_5 -> y_5)\n");
+  EXPECT_TRUE(s.fixpoint);
+  EXPECT_GT(s.inlined, 0);
+  EXPECT_EQ(s.known, 1);
+}
+
+TEST(SimplifyTest, caseOfCase) {
+  auto p = core_of("data Bool = False | True\n"
+                   "not b = case b of\n"
+                   "  True -> False\n"
+                   "  False -> True\n"
+                   "g b = case not b of\n"
+                   "  True -> 1\n"
+                   "  False -> 2\n");
+  auto s = core::simplify(p);
+  EXPECT_EQ(p.to_string(),
+            "not_0 = (\\b_1 -> (case b_1 of { True -> False; "
+            "False -> True }))\n"
+            "g_2 = (\\b_3 -> (case b_3 of { True -> 2; False -> 1 }))\n");
+  EXPECT_EQ(s.case_of_case, 1);
+  EXPECT_EQ(s.known, 2);
+}
+
+TEST(SimplifyTest, knownConstructorBinder) {
+  auto p = core_of(std::string(PRIMS) + "data Pair = Pair Int Int\n"
+                                      "extern g : Pair -> Int -> Int\n"
+                                      "k x y z = case Pair (add x x) y of\n"
+                                      "  Pair a b -> g z a\n");
+  // no source form binds the scrutinee of a constructor `case`: give the
+  // `case` a binder and use it for `z`
+  auto bndr = core::VarRef();
+  for (auto& e : p.exprs)
+    if (auto* c = std::get_if<core::ECase>(&e)) {
+      bndr    = p.add(core::Var{name::Id("p"), p.type_of(c->scrut), true});
+      c->bndr = bndr;
+    }
+  for (auto& e : p.exprs)
+    if (auto* x = std::get_if<core::EVar>(&e))
+      if (p[x->var].name == name::Id("z"))
+        x->var = bndr;
+  core::simplify(p);
+  // `add x x` is computed once, shared by the binder and the field
+  EXPECT_EQ(p.to_string(), "k_0 = (\\x_1 y_2 z_3 -> (let a_4 = (@add x_1 x_1) "
+                           "in (@g (Pair a_4 y_2) a_4)))\n");
+}
+
+TEST(SimplifyTest, betaAndDead) {
+  auto p = core_of(std::string(PRIMS) + "k x = let\n"
+                                      "  unused = add x x\n"
+                                      "  f = \\y -> add y y\n"
+                                      "  in add (f x) (f 2)\n");
+  auto s = core::simplify(p);
+  EXPECT_EQ(p.to_string(),
+            "k_0 = (\\x_1 -> (@add (@add x_1 x_1) (@add 2 2)))\n");
+  EXPECT_EQ(s.beta, 2);
+  EXPECT_EQ(s.dead, 2);
+}
+
+TEST(SimplifyTest, sharedWork) {
+  // used twice: inlining would compute `add x x` twice
+  auto p = core_of(std::string(PRIMS) + "k x = let\n"
+                                      "  twice = add x x\n"
+                                      "  in add twice twice\n");
+  core::simplify(p);
+  EXPECT_EQ(p.to_string(), "k_0 = (\\x_1 -> (let twice_2 = (@add x_1 x_1) "
+                           "in (@add twice_2 twice_2)))\n");
+}
+
+TEST(SimplifyTest, recursion) {
+  // `go` is its own loop breaker, unrolling it would never end
+  auto p = core_of("data List a = Nil | Cons a (List a)\n"
+                   "k x = let\n"
+                   "  go ys = case ys of\n"
+                   "    Nil -> x\n"
+                   "    Cons z zs -> go zs\n"
+                   "  in go (Cons 1 Nil)\n");
+  auto s = core::simplify(p);
+  EXPECT_TRUE(s.fixpoint);
+  EXPECT_EQ(p.to_string(),
+            "k_0 = (\\x_1 -> (letrec { go_2 = (\\ys_3 -> (case ys_3 of { "
+            "Nil -> x_1; Cons z_4 zs_5 -> (go_2 zs_5) })) } in "
+            "(go_2 (Cons 1 Nil))))\n");
+}
+
+TEST(SimplifyTest, budget) {
+  auto src = "data Maybe a = Nothing | Just a\n"
+             "fromMaybe d m = case m of\n"
+             "  Nothing -> d\n"
+             "  Just x -> x\n"
+             "f y = fromMaybe 0 (Just y)\n";
+  auto p   = core_of(src);
+  auto s   = core::simplify(p, core::Budget{1, 0, 24, 8});
+  EXPECT_EQ(s.rounds, 1);
+  EXPECT_FALSE(s.fixpoint);
+  // no ticks to copy `fromMaybe` in
+  EXPECT_NE(p.to_string().find("(fromMaybe_0 0 (Just y_"), string::npos);
+
+  auto small        = core::Budget();
+  small.inline_size = 0;
+  small.discount    = 0;
+  p                 = core_of(src);
+  s                 = core::simplify(p, small);
+  EXPECT_TRUE(s.fixpoint);
+  EXPECT_NE(p.to_string().find("(fromMaybe_0 0 (Just y_"), string::npos);
+}
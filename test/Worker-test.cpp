@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+#include <prelude.hpp>
+
+#include "core/demand.hpp"
+#include "core/desugar.hpp"
+#include "core/simplify.hpp"
+#include "core/worker.hpp"
+#include "fixtures.hpp"
+
+using namespace mangekyou;
+using namespace mangekyou::parse;
+using namespace mangekyou::test;
+
+TEST(WorkerTest, loop) {
+  auto p = core_of(std::string(PRIMS) + "data Pair = Pair Int Int\n"
+                                        "swap : Pair -> Int -> Int\n"
+                                        "swap p n = case p of\n"
+                                        "  Pair a b -> case n of\n"
+                                        "    0 -> a\n"
+                                        "    _ -> swap (Pair b a) (sub n 1)\n");
+  core::simplify(p);
+  core::strictness(p);
+  auto s = core::worker_wrapper(p);
+  EXPECT_EQ(s.functions, 1);
+  EXPECT_EQ(s.unboxed, 1);
+  core::simplify(p);
+  // the wrapper is inlined into the recursive call, where it meets the
+  // pair built for it: the worker loops on the fields
+  EXPECT_EQ(p.to_string(),
+            "swap_0 = (\\!p_1 !n_2 -> (case p_1 of { "
+            "Pair p_3 p_4 -> ($wswap_5 p_3 p_4 n_2) }))\n"
+            "$wswap_5 = (\\p_6 p_7 !n_8 -> (case n_8 of { 0 -> p_6; "
+            "_ -> (case (@sub n_8 1) as n_9 of { "
+            "_ -> ($wswap_5 p_7 p_6 n_9) }) }))\n");
+}
+
+TEST(WorkerTest, letrec) {
+  auto p = core_of(std::string(PRIMS)
+                   + "data P a = P a Int\n"
+                     "f : Int -> Int\n"
+                     "f m = let go : P Int -> Int -> Int\n"
+                     "          go q n = case q of\n"
+                     "            P s k -> case n of\n"
+                     "              0 -> add s k\n"
+                     "              _ -> go (P (add s n) k) (sub n 1)\n"
+                     "      in go (P 0 m) m\n");
+  core::simplify(p);
+  core::strictness(p);
+  EXPECT_EQ(core::worker_wrapper(p).functions, 1);
+  core::simplify(p);
+  // the wrapper, used once, is gone along with the box
+  EXPECT_EQ(p.to_string(),
+            "f_0 = (\\!m_1 -> (letrec { $wgo_2 = (\\q_3 q_4 !n_5 -> "
+            "(case n_5 of { 0 -> (@add q_3 q_4); "
+            "_ -> (case (@sub n_5 1) as n_6 of { "
+            "_ -> ($wgo_2 (@add q_3 n_5) q_4 n_6) }) })) } in "
+            "($wgo_2 0 m_1 m_1)))\n");
+}
+
+TEST(WorkerTest, rebox) {
+  // the worker rebuilds the pair where it is used whole
+  auto p = core_of(std::string(PRIMS) + "data Pair = Pair Int Int\n"
+                                        "pick : Pair -> Int -> Pair\n"
+                                        "pick p n = case p of\n"
+                                        "  Pair a b -> case n of\n"
+                                        "    0 -> p\n"
+                                        "    _ -> Pair (add a n) b\n");
+  core::simplify(p);
+  core::strictness(p);
+  core::worker_wrapper(p);
+  core::simplify(p);
+  EXPECT_EQ(p.to_string(),
+            "pick_0 = (\\!p_1 !n_2 -> (case p_1 of { "
+            "Pair p_3 p_4 -> ($wpick_5 p_3 p_4 n_2) }))\n"
+            "$wpick_5 = (\\p_6 p_7 !n_8 -> (case n_8 of { "
+            "0 -> (Pair p_6 p_7); _ -> (Pair (@add p_6 n_8) p_7) }))\n");
+}
+
+TEST(WorkerTest, unsplit) {
+  auto p = core_of(std::string(PRIMS)
+                   + "data Pair = Pair Int Int\n"
+                     "data List a = Nil | Cons a (List a)\n"
+                     "len : List Int -> Int\n"
+                     "len xs = case xs of\n"
+                     "  Nil -> 0\n"
+                     "  Cons y ys -> add 1 (len ys)\n"
+                     "konst : Pair -> Int -> Int\n"
+                     "konst p n = n\n"
+                     "fst : Pair -> Int\n"
+                     "fst p = case p of\n"
+                     "  Pair a b -> a\n");
+  core::simplify(p);
+  core::strictness(p);
+  // not a product, not strict; only `fst` is split
+  EXPECT_EQ(core::worker_wrapper(p).functions, 1);
+  // a wrapper is not split again
+  EXPECT_EQ(core::worker_wrapper(p).functions, 0);
+  EXPECT_EQ(p.top.size(), 4);
+}
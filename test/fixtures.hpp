@@ -0,0 +1,39 @@
+#pragma once
+#include <gtest/gtest.h>
+#include <prelude.hpp>
+
+#include "core/desugar.hpp"
+#include "parse/layout.hpp"
+#include "parse/parser.hpp"
+
+/** sources and the steps that take them to what each test looks at */
+namespace mangekyou::test {
+
+static const char* const LIST  = "data List a = Nil | Cons a (List a)\n";
+static const char* const PRIMS = "extern add : Int -> Int -> Int\n"
+                                 "extern sub : Int -> Int -> Int\n";
+
+/// `src` lexed, laid out and parsed, failing the test on a parse error
+inline ast::Module module_of(std::string_view src) {
+  auto lx   = parse::Lexer(src);
+  auto toks = parse::Layout::run(lx);
+  auto m    = parse::Parser(toks).parse_module();
+  EXPECT_TRUE(m.has_value()) << m.error().message;
+  return std::move(*m);
+}
+
+/// the `case` that is the body of the last item
+inline const ast::ECase& last_case(const ast::Module& m) {
+  auto& fn = std::get<ast::FnDecl>(m[m.items.back()]);
+  return std::get<ast::ECase>(m[fn.body]);
+}
+
+/// `src` desugared to Core, failing the test on an error; the passes a
+/// test depends on are run by the test itself
+inline core::Program core_of(std::string_view src) {
+  auto p = core::desugar(module_of(src));
+  EXPECT_TRUE(p.has_value()) << p.error().message;
+  return std::move(*p);
+}
+
+} // namespace mangekyou::test